@@ -2,10 +2,13 @@
 set -e
 
 # solver iterations and flops for case 1 of unfem using CG+AMG and one of
-# three nonlinear strategies:
+# five nonlinear strategies:
 #   Picard (analytical matrix) iteration
 #   -snes_fd_color
 #   -snes_mf_operator with Picard as preconditioner material
+#   Picard iteration which reuses the matrix while a(u) is nearly unchanged
+#   Picard iteration which reuses the GAMG interpolation from the first
+#     iteration (PETSc option -pc_gamg_reuse_interpolation)
 # (note: individual runs will show the very different residual norm histories)
 
 # run as:
@@ -47,4 +50,15 @@ for LEV in 3 4 5 6 7 8 9; do   # LEV=10 generates DIVERGED_ITS error on 4th SNES
 done
 echo
 
+echo "********** Picard with matrix reuse when a(u) changes by less than 1% ***********"
+for LEV in 3 4 5 6 7 8 9 10 11; do
+    run $LEV "-un_lag_tol 0.01"
+    grep "Picard matrix" tmp.txt
+done
+echo
 
+echo "********** Picard with GAMG interpolation reused after first iteration ***********"
+for LEV in 3 4 5 6 7 8 9 10 11; do
+    run $LEV "-pc_gamg_reuse_interpolation"
+done
+echo
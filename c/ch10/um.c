@@ -5,10 +5,13 @@ PetscErrorCode UMInitialize(UM *mesh) {
     mesh->N = 0;
     mesh->K = 0;
     mesh->P = 0;
+    mesh->Nown = 0;
     mesh->loc = NULL;
     mesh->e = NULL;
     mesh->bf = NULL;
     mesh->ns = NULL;
+    mesh->ltog = NULL;
+    mesh->win = MPI_WIN_NULL;
     return 0;
 }
 
@@ -18,6 +21,10 @@ PetscErrorCode UMDestroy(UM *mesh) {
     ierr = ISDestroy(&(mesh->e)); CHKERRQ(ierr);
     ierr = ISDestroy(&(mesh->bf)); CHKERRQ(ierr);
     ierr = ISDestroy(&(mesh->ns)); CHKERRQ(ierr);
+    ierr = ISLocalToGlobalMappingDestroy(&(mesh->ltog)); CHKERRQ(ierr);
+    if (mesh->win != MPI_WIN_NULL) {  // after the Vec and ISs which use it
+        ierr = MPI_Win_free(&(mesh->win)); CHKERRQ(ierr);
+    }
     return 0;
 }
 
@@ -93,6 +100,149 @@ PetscErrorCode UMViewSolutionBinary(UM *mesh, char *filename, Vec u) {
 }
 
 
+// The .vtu file written by UMViewVTKBinary() is a short XML header followed
+// by an <AppendedData> section holding the arrays as raw bytes, each array
+// preceded by its length in bytes as a UInt64.  The arrays are streamed in
+// chunks of UMVTK_CHUNK entries so no full-size copy is ever made.
+#define UMVTK_CHUNK 4096
+
+static PetscErrorCode UMVTKWrite(FILE *fp, const void *data,
+                                 size_t size, size_t count) {
+    if (fwrite(data,size,count,fp) != count) {
+        SETERRQ(PETSC_COMM_SELF,PETSC_ERR_FILE_WRITE,"write to .vtu file failed\n");
+    }
+    return 0;
+}
+
+static PetscErrorCode UMVTKWriteHeader(FILE *fp, PetscInt64 nbytes) {
+    PetscErrorCode ierr;
+    ierr = UMVTKWrite(fp,&nbytes,sizeof(PetscInt64),1); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode UMViewVTKBinary(UM *mesh, char *filename,
+                               PetscInt nf, Vec fields[], const char *names[]) {
+    PetscErrorCode  ierr;
+    FILE            *fp;
+    const Node      *aloc;
+    const PetscInt  *ae;
+    const PetscReal *af;
+    PetscReal       xbuf[3*UMVTK_CHUNK];
+    PetscInt        obuf[UMVTK_CHUNK], i, k, m, start, end, Nf;
+    unsigned char   tbuf[UMVTK_CHUNK];
+    PetscInt64      offset, Rbytes, Ibytes;
+    const char      *realtype = (sizeof(PetscReal) == 8) ? "Float64" : "Float32",
+                    *inttype = (sizeof(PetscInt) == 8) ? "Int64" : "Int32";
+#if defined(PETSC_WORDS_BIGENDIAN)
+    const char      *byteorder = "BigEndian";
+#else
+    const char      *byteorder = "LittleEndian";
+#endif
+
+    if (mesh->ltog) {
+        SETERRQ(PETSC_COMM_SELF,1,"UMViewVTKBinary() needs a whole mesh, not a partitioned one\n");
+    }
+    if ((mesh->N == 0) || (mesh->K == 0) || (!mesh->loc) || (!mesh->e)) {
+        SETERRQ(PETSC_COMM_SELF,2,"mesh not read ... call UMReadNodes() and UMReadISs() first\n");
+    }
+    for (m = 0; m < nf; m++) {
+        ierr = VecGetLocalSize(fields[m],&Nf); CHKERRQ(ierr);
+        if (Nf != mesh->N) {
+            SETERRQ3(PETSC_COMM_SELF,3,
+               "incompatible sizes of field %s (=%d) and number of nodes (=%d)\n",
+               names[m],Nf,mesh->N);
+        }
+    }
+    Rbytes = (PetscInt64)sizeof(PetscReal);
+    Ibytes = (PetscInt64)sizeof(PetscInt);
+
+    // XML header; offsets count the UInt64 byte-count header of each array
+    ierr = PetscFOpen(PETSC_COMM_SELF,filename,"w",&fp); CHKERRQ(ierr);
+    fprintf(fp,"<?xml version=\"1.0\"?>\n"
+               "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" "
+               "byte_order=\"%s\" header_type=\"UInt64\">\n"
+               "  <UnstructuredGrid>\n"
+               "    <Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n",
+               byteorder,mesh->N,mesh->K);
+    offset = 0;
+    fprintf(fp,"      <Points>\n"
+               "        <DataArray type=\"%s\" NumberOfComponents=\"3\" format=\"appended\" offset=\"%lld\"/>\n"
+               "      </Points>\n",
+               realtype,(long long)offset);
+    offset += 8 + 3 * mesh->N * Rbytes;
+    fprintf(fp,"      <Cells>\n"
+               "        <DataArray type=\"%s\" Name=\"connectivity\" format=\"appended\" offset=\"%lld\"/>\n",
+               inttype,(long long)offset);
+    offset += 8 + 3 * mesh->K * Ibytes;
+    fprintf(fp,"        <DataArray type=\"%s\" Name=\"offsets\" format=\"appended\" offset=\"%lld\"/>\n",
+               inttype,(long long)offset);
+    offset += 8 + mesh->K * Ibytes;
+    fprintf(fp,"        <DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"%lld\"/>\n"
+               "      </Cells>\n",
+               (long long)offset);
+    offset += 8 + mesh->K;
+    if (nf > 0) {
+        fprintf(fp,"      <PointData Scalars=\"%s\">\n",names[0]);
+        for (m = 0; m < nf; m++) {
+            fprintf(fp,"        <DataArray type=\"%s\" Name=\"%s\" format=\"appended\" offset=\"%lld\"/>\n",
+                       realtype,names[m],(long long)offset);
+            offset += 8 + mesh->N * Rbytes;
+        }
+        fprintf(fp,"      </PointData>\n");
+    }
+    fprintf(fp,"    </Piece>\n"
+               "  </UnstructuredGrid>\n"
+               "  <AppendedData encoding=\"raw\">\n_");
+
+    // points: pad (x,y) to (x,y,0)
+    ierr = UMGetNodeCoordArrayRead(mesh,&aloc); CHKERRQ(ierr);
+    ierr = UMVTKWriteHeader(fp,3 * mesh->N * Rbytes); CHKERRQ(ierr);
+    for (start = 0; start < mesh->N; start += UMVTK_CHUNK) {
+        end = PetscMin(start + UMVTK_CHUNK, mesh->N);
+        for (i = start; i < end; i++) {
+            xbuf[3*(i-start)+0] = aloc[i].x;
+            xbuf[3*(i-start)+1] = aloc[i].y;
+            xbuf[3*(i-start)+2] = 0.0;
+        }
+        ierr = UMVTKWrite(fp,xbuf,sizeof(PetscReal),3*(end-start)); CHKERRQ(ierr);
+    }
+    ierr = UMRestoreNodeCoordArrayRead(mesh,&aloc); CHKERRQ(ierr);
+
+    // cells: connectivity is e itself; all cells are triangles (VTK type 5)
+    ierr = ISGetIndices(mesh->e,&ae); CHKERRQ(ierr);
+    ierr = UMVTKWriteHeader(fp,3 * mesh->K * Ibytes); CHKERRQ(ierr);
+    ierr = UMVTKWrite(fp,ae,sizeof(PetscInt),3*mesh->K); CHKERRQ(ierr);
+    ierr = ISRestoreIndices(mesh->e,&ae); CHKERRQ(ierr);
+    ierr = UMVTKWriteHeader(fp,mesh->K * Ibytes); CHKERRQ(ierr);
+    for (start = 0; start < mesh->K; start += UMVTK_CHUNK) {
+        end = PetscMin(start + UMVTK_CHUNK, mesh->K);
+        for (k = start; k < end; k++)
+            obuf[k-start] = 3 * (k+1);
+        ierr = UMVTKWrite(fp,obuf,sizeof(PetscInt),end-start); CHKERRQ(ierr);
+    }
+    for (k = 0; k < PetscMin(UMVTK_CHUNK,mesh->K); k++)
+        tbuf[k] = 5;
+    ierr = UMVTKWriteHeader(fp,mesh->K); CHKERRQ(ierr);
+    for (start = 0; start < mesh->K; start += UMVTK_CHUNK) {
+        end = PetscMin(start + UMVTK_CHUNK, mesh->K);
+        ierr = UMVTKWrite(fp,tbuf,1,end-start); CHKERRQ(ierr);
+    }
+
+    // nodal fields are written directly from the Vec arrays
+    for (m = 0; m < nf; m++) {
+        ierr = UMVTKWriteHeader(fp,mesh->N * Rbytes); CHKERRQ(ierr);
+        ierr = VecGetArrayRead(fields[m],&af); CHKERRQ(ierr);
+        ierr = UMVTKWrite(fp,af,sizeof(PetscReal),mesh->N); CHKERRQ(ierr);
+        ierr = VecRestoreArrayRead(fields[m],&af); CHKERRQ(ierr);
+    }
+
+    fprintf(fp,"\n  </AppendedData>\n"
+               "</VTKFile>\n");
+    ierr = PetscFClose(PETSC_COMM_SELF,fp); CHKERRQ(ierr);
+    return 0;
+}
+
+
 PetscErrorCode UMReadNodes(UM *mesh, char *filename) {
     PetscErrorCode ierr;
     PetscInt       twoN;
@@ -100,9 +250,9 @@ PetscErrorCode UMReadNodes(UM *mesh, char *filename) {
     if (mesh->N > 0) {
         SETERRQ(PETSC_COMM_SELF,1,"nodes already created?\n");
     }
-    ierr = VecCreate(PETSC_COMM_WORLD,&mesh->loc); CHKERRQ(ierr);
+    ierr = VecCreate(PETSC_COMM_SELF,&mesh->loc); CHKERRQ(ierr);
     ierr = VecSetFromOptions(mesh->loc); CHKERRQ(ierr);
-    ierr = PetscViewerBinaryOpen(PETSC_COMM_WORLD,filename,FILE_MODE_READ,&viewer); CHKERRQ(ierr);
+    ierr = PetscViewerBinaryOpen(PETSC_COMM_SELF,filename,FILE_MODE_READ,&viewer); CHKERRQ(ierr);
     ierr = VecLoad(mesh->loc,viewer); CHKERRQ(ierr);
     ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
     ierr = VecGetSize(mesh->loc,&twoN); CHKERRQ(ierr);
@@ -110,6 +260,7 @@ PetscErrorCode UMReadNodes(UM *mesh, char *filename) {
         SETERRQ1(PETSC_COMM_SELF,2,"node locations loaded from %s are not N pairs\n",filename);
     }
     mesh->N = twoN / 2;
+    mesh->Nown = mesh->N;
     return 0;
 }
 
@@ -199,9 +350,9 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
         SETERRQ(PETSC_COMM_SELF,1,
                 "elements, boundary flags, Neumann boundary segments already created? ... stopping\n");
     }
-    ierr = PetscViewerBinaryOpen(PETSC_COMM_WORLD,filename,FILE_MODE_READ,&viewer); CHKERRQ(ierr);
+    ierr = PetscViewerBinaryOpen(PETSC_COMM_SELF,filename,FILE_MODE_READ,&viewer); CHKERRQ(ierr);
     // create and load e
-    ierr = ISCreate(PETSC_COMM_WORLD,&(mesh->e)); CHKERRQ(ierr);
+    ierr = ISCreate(PETSC_COMM_SELF,&(mesh->e)); CHKERRQ(ierr);
     ierr = ISLoad(mesh->e,viewer); CHKERRQ(ierr);
     ierr = ISGetSize(mesh->e,&(mesh->K)); CHKERRQ(ierr);
     if (mesh->K % 3 != 0) {
@@ -210,7 +361,7 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
     }
     mesh->K /= 3;
     // create and load bf
-    ierr = ISCreate(PETSC_COMM_WORLD,&(mesh->bf)); CHKERRQ(ierr);
+    ierr = ISCreate(PETSC_COMM_SELF,&(mesh->bf)); CHKERRQ(ierr);
     ierr = ISLoad(mesh->bf,viewer); CHKERRQ(ierr);
     ierr = ISGetSize(mesh->bf,&n_bf); CHKERRQ(ierr);
     if (n_bf != mesh->N) {
@@ -220,7 +371,7 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
     // FIXME  seems there is no way to tell if file is empty at this point
     // create and load ns last ... may *start with a negative value* in which case set P = 0
     const PetscInt *ans;
-    ierr = ISCreate(PETSC_COMM_WORLD,&(mesh->ns)); CHKERRQ(ierr);
+    ierr = ISCreate(PETSC_COMM_SELF,&(mesh->ns)); CHKERRQ(ierr);
     ierr = ISLoad(mesh->ns,viewer); CHKERRQ(ierr);
     ierr = ISGetIndices(mesh->ns,&ans); CHKERRQ(ierr);
     if (ans[0] < 0) {
@@ -244,19 +395,580 @@ PetscErrorCode UMReadISs(UM *mesh, char *filename) {
 }
 
 
+// Helpers for UMReadPartitioned().  An index range [0,n) is split into
+// contiguous blocks, one per process, with the first n % size blocks one
+// longer; UMBlockOwner() inverts this split.
+static void UMBlockRange(PetscInt n, PetscMPIInt size, PetscMPIInt rank,
+                         PetscInt *start, PetscInt *end) {
+    const PetscInt base = n / size, rem = n % size;
+    *start = rank * base + PetscMin(rank,rem);
+    *end = *start + base + ((rank < rem) ? 1 : 0);
+}
+
+static PetscMPIInt UMBlockOwner(PetscInt n, PetscMPIInt size, PetscInt g) {
+    const PetscInt base = n / size, rem = n % size;
+    if (g < rem * (base + 1))
+        return (PetscMPIInt)(g / (base + 1));
+    return (PetscMPIInt)(rem + (g - rem * (base + 1)) / base);
+}
+
+// collective read of count entries at byte offset off from a PETSc binary
+// file, which is always big-endian
+static PetscErrorCode UMFileReadAll(MPI_File fh, MPI_Offset off, void *buf,
+                                    PetscInt count, PetscDataType dtype) {
+    PetscErrorCode ierr;
+    MPI_Status     status;
+    ierr = MPI_File_read_at_all(fh,off,buf,(PetscMPIInt)count,
+                                (dtype == PETSC_INT) ? MPIU_INT : MPIU_REAL,
+                                &status); CHKERRQ(ierr);
+#if !defined(PETSC_WORDS_BIGENDIAN)
+    ierr = PetscByteSwap(buf,dtype,count); CHKERRQ(ierr);
+#endif
+    return 0;
+}
+
+// send each w-tuple of global node indices in tup[] to the owner of its
+// smallest node index; on return *tupout is allocated and holds *nout tuples
+static PetscErrorCode UMSendTuplesToOwner(PetscInt w, PetscInt n,
+                          const PetscInt *tup, PetscInt Ng, PetscInt *nout,
+                          PetscInt **tupout) {
+    PetscErrorCode ierr;
+    PetscMPIInt    size, p, *dest, *scnt, *sdsp, *rcnt, *rdsp;
+    PetscInt       *sbuf, *pos, i, j, gmin, nrecv;
+
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD,&size); CHKERRQ(ierr);
+    ierr = PetscMalloc1(n,&dest); CHKERRQ(ierr);
+    ierr = PetscCalloc1(size,&scnt); CHKERRQ(ierr);
+    ierr = PetscMalloc3(size,&sdsp,size,&rcnt,size,&rdsp); CHKERRQ(ierr);
+    for (i = 0; i < n; i++) {
+        gmin = tup[w*i];
+        for (j = 1; j < w; j++)
+            gmin = PetscMin(gmin,tup[w*i+j]);
+        dest[i] = UMBlockOwner(Ng,size,gmin);
+        scnt[dest[i]] += w;
+    }
+    ierr = MPI_Alltoall(scnt,1,MPI_INT,rcnt,1,MPI_INT,PETSC_COMM_WORLD); CHKERRQ(ierr);
+    sdsp[0] = 0;  rdsp[0] = 0;
+    for (p = 1; p < size; p++) {
+        sdsp[p] = sdsp[p-1] + scnt[p-1];
+        rdsp[p] = rdsp[p-1] + rcnt[p-1];
+    }
+    nrecv = rdsp[size-1] + rcnt[size-1];
+    // counting sort by destination keeps the file order within each process
+    ierr = PetscMalloc1(w*n,&sbuf); CHKERRQ(ierr);
+    ierr = PetscMalloc1(size,&pos); CHKERRQ(ierr);
+    for (p = 0; p < size; p++)
+        pos[p] = sdsp[p];
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < w; j++)
+            sbuf[pos[dest[i]]++] = tup[w*i+j];
+    }
+    ierr = PetscMalloc1(nrecv,tupout); CHKERRQ(ierr);
+    ierr = MPI_Alltoallv(sbuf,scnt,sdsp,MPIU_INT,
+                         *tupout,rcnt,rdsp,MPIU_INT,PETSC_COMM_WORLD); CHKERRQ(ierr);
+    *nout = nrecv / w;
+    ierr = PetscFree(pos); CHKERRQ(ierr);
+    ierr = PetscFree(sbuf); CHKERRQ(ierr);
+    ierr = PetscFree3(sdsp,rcnt,rdsp); CHKERRQ(ierr);
+    ierr = PetscFree(scnt); CHKERRQ(ierr);
+    ierr = PetscFree(dest); CHKERRQ(ierr);
+    return 0;
+}
+
+// list the sorted, distinct nodes outside [nstart,nend) referenced by the
+// local elements and segments; *ghost is allocated
+static PetscErrorCode UMFindGhosts(PetscInt nstart, PetscInt nend,
+                          PetscInt Kloc, const PetscInt *eloc,
+                          PetscInt Ploc, const PetscInt *nsloc,
+                          PetscInt *Nghost, PetscInt **ghost) {
+    PetscErrorCode ierr;
+    PetscInt       i;
+    ierr = PetscMalloc1(3*Kloc+2*Ploc,ghost); CHKERRQ(ierr);
+    *Nghost = 0;
+    for (i = 0; i < 3*Kloc; i++) {
+        if ((eloc[i] < nstart) || (eloc[i] >= nend))
+            (*ghost)[(*Nghost)++] = eloc[i];
+    }
+    for (i = 0; i < 2*Ploc; i++) {
+        if ((nsloc[i] < nstart) || (nsloc[i] >= nend))
+            (*ghost)[(*Nghost)++] = nsloc[i];
+    }
+    ierr = PetscSortRemoveDupsInt(Nghost,*ghost); CHKERRQ(ierr);
+    return 0;
+}
+
+// fill a partitioned mesh from the owned nodes [nstart,nstart+Nown), the
+// ghosts, and the local elements and segments in global numbering; local
+// numbering is owned nodes in global order, then ghosts in global order;
+// eloc and nsloc are renumbered in place and then belong to the mesh
+static PetscErrorCode UMSetLocal(UM *mesh, PetscInt nstart, PetscInt Nown,
+                          const PetscInt *bfown, const PetscReal *xyown,
+                          PetscInt Nghost, const PetscInt *ghost,
+                          const PetscInt *bfghost, const PetscReal *xyghost,
+                          PetscInt Kloc, PetscInt *eloc,
+                          PetscInt Ploc, PetscInt *nsloc) {
+    PetscErrorCode ierr;
+    PetscInt       Nloc = Nown + Nghost, i, j, g, *l2g, *bfloc;
+    PetscReal      *axy;
+
+    ierr = PetscMalloc1(Nloc,&l2g); CHKERRQ(ierr);
+    ierr = PetscMalloc1(Nloc,&bfloc); CHKERRQ(ierr);
+    ierr = VecCreateSeq(PETSC_COMM_SELF,2*Nloc,&(mesh->loc)); CHKERRQ(ierr);
+    ierr = VecGetArray(mesh->loc,&axy); CHKERRQ(ierr);
+    for (i = 0; i < Nown; i++) {
+        l2g[i] = nstart + i;
+        bfloc[i] = bfown[i];
+        axy[2*i+0] = xyown[2*i+0];
+        axy[2*i+1] = xyown[2*i+1];
+    }
+    for (i = 0; i < Nghost; i++) {
+        l2g[Nown+i] = ghost[i];
+        bfloc[Nown+i] = bfghost[i];
+        axy[2*(Nown+i)+0] = xyghost[2*i+0];
+        axy[2*(Nown+i)+1] = xyghost[2*i+1];
+    }
+    ierr = VecRestoreArray(mesh->loc,&axy); CHKERRQ(ierr);
+    for (i = 0; i < 3*Kloc + 2*Ploc; i++) {
+        PetscInt *t = (i < 3*Kloc) ? &eloc[i] : &nsloc[i-3*Kloc];
+        g = *t;
+        if ((g >= nstart) && (g < nstart + Nown)) {
+            *t = g - nstart;
+        } else {
+            ierr = PetscFindInt(g,Nghost,ghost,&j); CHKERRQ(ierr);
+            *t = Nown + j;
+        }
+    }
+
+    mesh->N = Nloc;
+    mesh->Nown = Nown;
+    mesh->K = Kloc;
+    mesh->P = Ploc;
+    ierr = ISCreateGeneral(PETSC_COMM_SELF,3*Kloc,eloc,PETSC_OWN_POINTER,
+                           &(mesh->e)); CHKERRQ(ierr);
+    ierr = ISCreateGeneral(PETSC_COMM_SELF,Nloc,bfloc,PETSC_OWN_POINTER,
+                           &(mesh->bf)); CHKERRQ(ierr);
+    if (Ploc > 0) {
+        ierr = ISCreateGeneral(PETSC_COMM_SELF,2*Ploc,nsloc,PETSC_OWN_POINTER,
+                               &(mesh->ns)); CHKERRQ(ierr);
+    } else {
+        ierr = PetscFree(nsloc); CHKERRQ(ierr);
+    }
+    ierr = ISLocalToGlobalMappingCreate(PETSC_COMM_WORLD,1,Nloc,l2g,
+                                        PETSC_OWN_POINTER,&(mesh->ltog)); CHKERRQ(ierr);
+
+    // check that local mesh is complete
+    if (Kloc > 0) {
+        ierr = UMCheckElements(mesh); CHKERRQ(ierr);
+    }
+    if (Nloc > 0) {
+        ierr = UMCheckBoundaryData(mesh); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+/* Two-phase parallel read.  In phase one each process reads, by MPI-IO, a
+contiguous slice of the nodes (coordinates and boundary flags), of the
+elements, and of the Neumann segments.  Nodes are owned by the process which
+read them.  In phase two each element and segment is sent to the owner of its
+lowest-numbered node, and then coordinates and flags of the ghost nodes
+(referenced but not owned) are fetched from their owners.  No process ever
+holds more than its slices plus its ghosts.  For one process the result is
+identical to UMReadNodes() followed by UMReadISs(). */
+PetscErrorCode UMReadPartitioned(UM *mesh, char *nodesname, char *issname) {
+    PetscErrorCode ierr;
+    PetscMPIInt    size, rank, p, *scnt, *sdsp, *rcnt, *rdsp;
+    MPI_File       fh;
+    MPI_Offset     off;
+    const PetscInt I = sizeof(PetscInt);
+    PetscInt       hdr[2], Ng, Kg, twoPg, nstart, nend, kstart, kend,
+                   pstart, pend, Kloc, Ploc, Nown, Nghost, nreq,
+                   i, loc, ns0,
+                   *eslice, *nsslice = NULL, *eloc, *nsloc = NULL, *bfown,
+                   *ghost, *req, *bfsend, *bfrecv;
+    PetscReal      *xyown, *xysend, *xyrecv;
+
+    if ((mesh->N > 0) || (mesh->K > 0) || (mesh->loc != NULL) || (mesh->e != NULL)) {
+        SETERRQ(PETSC_COMM_SELF,1,"mesh already created? ... stopping\n");
+    }
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD,&size); CHKERRQ(ierr);
+    ierr = MPI_Comm_rank(PETSC_COMM_WORLD,&rank); CHKERRQ(ierr);
+
+    // phase one, nodes: Vec header is (classid,2N), then 2N reals
+    ierr = MPI_File_open(PETSC_COMM_WORLD,nodesname,MPI_MODE_RDONLY,
+                         MPI_INFO_NULL,&fh); CHKERRQ(ierr);
+    ierr = UMFileReadAll(fh,0,hdr,2,PETSC_INT); CHKERRQ(ierr);
+    if ((hdr[0] != VEC_FILE_CLASSID) || (hdr[1] % 2 != 0)) {
+        SETERRQ1(PETSC_COMM_SELF,2,"file %s does not contain a Vec of N pairs\n",nodesname);
+    }
+    Ng = hdr[1] / 2;
+    UMBlockRange(Ng,size,rank,&nstart,&nend);
+    Nown = nend - nstart;
+    ierr = PetscMalloc1(2*Nown,&xyown); CHKERRQ(ierr);
+    off = 2 * I + (MPI_Offset)(2 * nstart) * sizeof(PetscReal);
+    ierr = UMFileReadAll(fh,off,xyown,2*Nown,PETSC_REAL); CHKERRQ(ierr);
+    ierr = MPI_File_close(&fh); CHKERRQ(ierr);
+
+    // phase one, ISs: e (classid,3K,...), bf (classid,N,...), ns (classid,2P,...)
+    ierr = MPI_File_open(PETSC_COMM_WORLD,issname,MPI_MODE_RDONLY,
+                         MPI_INFO_NULL,&fh); CHKERRQ(ierr);
+    ierr = UMFileReadAll(fh,0,hdr,2,PETSC_INT); CHKERRQ(ierr);
+    if ((hdr[0] != IS_FILE_CLASSID) || (hdr[1] % 3 != 0)) {
+        SETERRQ1(PETSC_COMM_SELF,3,
+                 "IS e in %s is wrong size for list of element triples\n",issname);
+    }
+    Kg = hdr[1] / 3;
+    UMBlockRange(Kg,size,rank,&kstart,&kend);
+    ierr = PetscMalloc1(3*(kend-kstart),&eslice); CHKERRQ(ierr);
+    off = 2 * I + (MPI_Offset)(3 * kstart) * I;
+    ierr = UMFileReadAll(fh,off,eslice,3*(kend-kstart),PETSC_INT); CHKERRQ(ierr);
+    off = 2 * I + (MPI_Offset)(3 * Kg) * I;
+    ierr = UMFileReadAll(fh,off,hdr,2,PETSC_INT); CHKERRQ(ierr);
+    if ((hdr[0] != IS_FILE_CLASSID) || (hdr[1] != Ng)) {
+        SETERRQ1(PETSC_COMM_SELF,4,
+                 "IS bf in %s is wrong size for list of boundary flags\n",issname);
+    }
+    ierr = PetscMalloc1(Nown,&bfown); CHKERRQ(ierr);
+    off += 2 * I + (MPI_Offset)nstart * I;
+    ierr = UMFileReadAll(fh,off,bfown,Nown,PETSC_INT); CHKERRQ(ierr);
+    off = 4 * I + (MPI_Offset)(3 * Kg + Ng) * I;
+    ierr = UMFileReadAll(fh,off,hdr,2,PETSC_INT); CHKERRQ(ierr);
+    // ns may *start with a negative value* in which case P = 0
+    ierr = UMFileReadAll(fh,off + 2 * I,&ns0,1,PETSC_INT); CHKERRQ(ierr);
+    twoPg = (ns0 < 0) ? 0 : hdr[1];
+    if ((hdr[0] != IS_FILE_CLASSID) || (twoPg % 2 != 0)) {
+        SETERRQ1(PETSC_COMM_SELF,5,
+                 "IS s in %s is wrong size for list of Neumann boundary segment pairs\n",issname);
+    }
+    UMBlockRange(twoPg/2,size,rank,&pstart,&pend);
+    ierr = PetscMalloc1(2*(pend-pstart),&nsslice); CHKERRQ(ierr);
+    off += 2 * I + (MPI_Offset)(2 * pstart) * I;
+    ierr = UMFileReadAll(fh,off,nsslice,2*(pend-pstart),PETSC_INT); CHKERRQ(ierr);
+    ierr = MPI_File_close(&fh); CHKERRQ(ierr);
+    for (i = 0; i < 3*(kend-kstart); i++) {
+        if ((eslice[i] < 0) || (eslice[i] >= Ng)) {
+            SETERRQ3(PETSC_COMM_SELF,6,
+               "index e[%d]=%d invalid: not between 0 and N-1=%d\n",
+               3*kstart+i,eslice[i],Ng-1);
+        }
+    }
+    for (i = 0; i < 2*(pend-pstart); i++) {
+        if ((nsslice[i] < 0) || (nsslice[i] >= Ng)) {
+            SETERRQ3(PETSC_COMM_SELF,7,
+               "index ns[%d]=%d invalid: not between 0 and N-1=%d\n",
+               2*pstart+i,nsslice[i],Ng-1);
+        }
+    }
+
+    // phase two: move elements and segments to owners of their nodes
+    ierr = UMSendTuplesToOwner(3,kend-kstart,eslice,Ng,&Kloc,&eloc); CHKERRQ(ierr);
+    ierr = PetscFree(eslice); CHKERRQ(ierr);
+    ierr = UMSendTuplesToOwner(2,pend-pstart,nsslice,Ng,&Ploc,&nsloc); CHKERRQ(ierr);
+    ierr = PetscFree(nsslice); CHKERRQ(ierr);
+
+    // ghosts, sorted so they are grouped by owner
+    ierr = UMFindGhosts(nstart,nend,Kloc,eloc,Ploc,nsloc,&Nghost,&ghost); CHKERRQ(ierr);
+
+    // ask owners for ghost coordinates and flags
+    ierr = PetscCalloc1(size,&scnt); CHKERRQ(ierr);
+    ierr = PetscMalloc3(size,&sdsp,size,&rcnt,size,&rdsp); CHKERRQ(ierr);
+    for (i = 0; i < Nghost; i++)
+        scnt[UMBlockOwner(Ng,size,ghost[i])] += 1;
+    ierr = MPI_Alltoall(scnt,1,MPI_INT,rcnt,1,MPI_INT,PETSC_COMM_WORLD); CHKERRQ(ierr);
+    sdsp[0] = 0;  rdsp[0] = 0;
+    for (p = 1; p < size; p++) {
+        sdsp[p] = sdsp[p-1] + scnt[p-1];
+        rdsp[p] = rdsp[p-1] + rcnt[p-1];
+    }
+    nreq = rdsp[size-1] + rcnt[size-1];
+    ierr = PetscMalloc1(nreq,&req); CHKERRQ(ierr);
+    ierr = MPI_Alltoallv(ghost,scnt,sdsp,MPIU_INT,
+                         req,rcnt,rdsp,MPIU_INT,PETSC_COMM_WORLD); CHKERRQ(ierr);
+    // answer requests: first flags, then coordinates (as pairs)
+    ierr = PetscMalloc2(nreq,&bfsend,2*nreq,&xysend); CHKERRQ(ierr);
+    for (i = 0; i < nreq; i++) {
+        loc = req[i] - nstart;
+        bfsend[i] = bfown[loc];
+        xysend[2*i+0] = xyown[2*loc+0];
+        xysend[2*i+1] = xyown[2*loc+1];
+    }
+    ierr = PetscMalloc2(Nghost,&bfrecv,2*Nghost,&xyrecv); CHKERRQ(ierr);
+    ierr = MPI_Alltoallv(bfsend,rcnt,rdsp,MPIU_INT,
+                         bfrecv,scnt,sdsp,MPIU_INT,PETSC_COMM_WORLD); CHKERRQ(ierr);
+    for (p = 0; p < size; p++) {
+        scnt[p] *= 2;  sdsp[p] *= 2;  rcnt[p] *= 2;  rdsp[p] *= 2;
+    }
+    ierr = MPI_Alltoallv(xysend,rcnt,rdsp,MPIU_REAL,
+                         xyrecv,scnt,sdsp,MPIU_REAL,PETSC_COMM_WORLD); CHKERRQ(ierr);
+    ierr = PetscFree2(bfsend,xysend); CHKERRQ(ierr);
+    ierr = PetscFree(req); CHKERRQ(ierr);
+    ierr = PetscFree3(sdsp,rcnt,rdsp); CHKERRQ(ierr);
+    ierr = PetscFree(scnt); CHKERRQ(ierr);
+
+    ierr = UMSetLocal(mesh,nstart,Nown,bfown,xyown,Nghost,ghost,bfrecv,xyrecv,
+                      Kloc,eloc,Ploc,nsloc); CHKERRQ(ierr);
+    ierr = PetscFree2(bfrecv,xyrecv); CHKERRQ(ierr);
+    ierr = PetscFree(bfown); CHKERRQ(ierr);
+    ierr = PetscFree(xyown); CHKERRQ(ierr);
+    ierr = PetscFree(ghost); CHKERRQ(ierr);
+    return 0;
+}
+
+// FNV-1a hash of bytes, continuing from h
+static unsigned long long UMHash(unsigned long long h, const void *data,
+                                 size_t bytes) {
+    const unsigned char *c = (const unsigned char*)data;
+    size_t              i;
+    for (i = 0; i < bytes; i++) {
+        h ^= c[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// hash of the arrays of a whole mesh, or of the shared copy (loc,e,bf,ns)
+static unsigned long long UMHashArrays(PetscInt N, PetscInt K, PetscInt P,
+                          const PetscReal *loc, const PetscInt *e,
+                          const PetscInt *bf, const PetscInt *ns) {
+    unsigned long long h = 14695981039346656037ULL;
+    h = UMHash(h,loc,2 * N * sizeof(PetscReal));
+    h = UMHash(h,e,3 * K * sizeof(PetscInt));
+    h = UMHash(h,bf,N * sizeof(PetscInt));
+    if (P > 0)
+        h = UMHash(h,ns,2 * P * sizeof(PetscInt));
+    return h;
+}
+
+/* Only rank 0 needs to have read the mesh, by UMReadNodes() and UMReadISs();
+other processes may pass an empty UM (after UMInitialize()) or one holding the
+same mesh.  The window is allocated by the first process on each
+shared-memory node, with layout  loc (2N reals), e (3K ints), bf (N ints),
+ns (2P ints).  Rank 0 copies its arrays into its window and then broadcasts
+them into the windows of the other shared-memory nodes.  Every process then
+replaces any private Vec and ISs by ones which wrap the shared memory.
+Finally a hash of the arrays, reduced over all processes, checks that every
+window holds rank 0's mesh and that every process which came with its own copy
+had the same mesh. */
+PetscErrorCode UMShareReadOnly(UM *mesh) {
+    PetscErrorCode ierr;
+    MPI_Comm       nodecomm, leadcomm;
+    PetscMPIInt    rank, noderank, dispunit;
+    MPI_Aint       bytes, qbytes;
+    PetscInt       nloc, NKP[3];
+    PetscBool      own, same;
+    void           *base;
+    PetscReal      *sloc;
+    PetscInt       *se, *sbf, *sns;
+    const PetscReal *aloc;
+    const PetscInt *ae, *abf, *ans = NULL;
+    unsigned long long hown = 0, hash[4];
+
+    if (mesh->win != MPI_WIN_NULL) {
+        SETERRQ(PETSC_COMM_SELF,1,"mesh arrays already in shared memory\n");
+    }
+    if (mesh->ltog != NULL) {
+        SETERRQ(PETSC_COMM_SELF,3,
+                "shared mesh arrays require the whole mesh, not a partitioned one\n");
+    }
+    ierr = MPI_Comm_rank(PETSC_COMM_WORLD,&rank); CHKERRQ(ierr);
+    own = (mesh->N > 0) ? PETSC_TRUE : PETSC_FALSE;
+    if ((rank == 0) && ((!own) || (!mesh->loc) || (!mesh->e) || (!mesh->bf) || (mesh->K == 0))) {
+        SETERRQ(PETSC_COMM_SELF,2,
+                "mesh not read on rank 0 ... call UMReadNodes() and UMReadISs() first\n");
+    }
+    if (own) {
+        ierr = VecGetLocalSize(mesh->loc,&nloc); CHKERRQ(ierr);
+        if (nloc != 2 * mesh->N) {
+            SETERRQ(PETSC_COMM_SELF,3,
+                    "shared mesh arrays require the whole mesh on each process which holds one\n");
+        }
+        ierr = VecGetArrayRead(mesh->loc,&aloc); CHKERRQ(ierr);
+        ierr = ISGetIndices(mesh->e,&ae); CHKERRQ(ierr);
+        ierr = ISGetIndices(mesh->bf,&abf); CHKERRQ(ierr);
+        if (mesh->P > 0) {
+            ierr = ISGetIndices(mesh->ns,&ans); CHKERRQ(ierr);
+        }
+        hown = UMHashArrays(mesh->N,mesh->K,mesh->P,aloc,ae,abf,ans);
+        NKP[0] = mesh->N;  NKP[1] = mesh->K;  NKP[2] = mesh->P;
+    }
+    ierr = MPI_Bcast(NKP,3,MPIU_INT,0,PETSC_COMM_WORLD); CHKERRQ(ierr);
+    same = (!own || ((NKP[0] == mesh->N) && (NKP[1] == mesh->K)
+                     && (NKP[2] == mesh->P))) ? PETSC_TRUE : PETSC_FALSE;
+    mesh->N = NKP[0];  mesh->K = NKP[1];  mesh->P = NKP[2];
+    mesh->Nown = mesh->N;
+
+    ierr = MPI_Comm_split_type(PETSC_COMM_WORLD,MPI_COMM_TYPE_SHARED,0,
+                               MPI_INFO_NULL,&nodecomm); CHKERRQ(ierr);
+    ierr = MPI_Comm_rank(nodecomm,&noderank); CHKERRQ(ierr);
+    bytes = 0;
+    if (noderank == 0) {
+        bytes = 2 * mesh->N * sizeof(PetscReal)
+                + (3 * mesh->K + mesh->N + 2 * mesh->P) * sizeof(PetscInt);
+    }
+    ierr = MPI_Win_allocate_shared(bytes,1,MPI_INFO_NULL,nodecomm,
+                                   &base,&(mesh->win)); CHKERRQ(ierr);
+    ierr = MPI_Win_shared_query(mesh->win,0,&qbytes,&dispunit,&base); CHKERRQ(ierr);
+    ierr = MPI_Comm_free(&nodecomm); CHKERRQ(ierr);
+    sloc = (PetscReal*)base;
+    se   = (PetscInt*)(sloc + 2 * mesh->N);
+    sbf  = se + 3 * mesh->K;
+    sns  = sbf + mesh->N;
+
+    // rank 0 is first on its node, so it is rank 0 among the first processes
+    ierr = MPI_Win_fence(0,mesh->win); CHKERRQ(ierr);
+    if (rank == 0) {
+        ierr = PetscArraycpy(sloc,aloc,2*mesh->N); CHKERRQ(ierr);
+        ierr = PetscArraycpy(se,ae,3*mesh->K); CHKERRQ(ierr);
+        ierr = PetscArraycpy(sbf,abf,mesh->N); CHKERRQ(ierr);
+        if (mesh->P > 0) {
+            ierr = PetscArraycpy(sns,ans,2*mesh->P); CHKERRQ(ierr);
+        }
+    }
+    ierr = MPI_Comm_split(PETSC_COMM_WORLD,(noderank == 0) ? 0 : MPI_UNDEFINED,
+                          rank,&leadcomm); CHKERRQ(ierr);
+    if (leadcomm != MPI_COMM_NULL) {
+        ierr = MPI_Bcast(sloc,(PetscMPIInt)(2*mesh->N),MPIU_REAL,0,leadcomm); CHKERRQ(ierr);
+        ierr = MPI_Bcast(se,(PetscMPIInt)(3*mesh->K+mesh->N+2*mesh->P),MPIU_INT,
+                         0,leadcomm); CHKERRQ(ierr);
+        ierr = MPI_Comm_free(&leadcomm); CHKERRQ(ierr);
+    }
+    ierr = MPI_Win_fence(0,mesh->win); CHKERRQ(ierr);
+
+    // replace private copies by wrappers around shared memory
+    if (own) {
+        if (mesh->P > 0) {
+            ierr = ISRestoreIndices(mesh->ns,&ans); CHKERRQ(ierr);
+        }
+        ierr = ISRestoreIndices(mesh->bf,&abf); CHKERRQ(ierr);
+        ierr = ISRestoreIndices(mesh->e,&ae); CHKERRQ(ierr);
+        ierr = VecRestoreArrayRead(mesh->loc,&aloc); CHKERRQ(ierr);
+    }
+    ierr = VecDestroy(&(mesh->loc)); CHKERRQ(ierr);
+    ierr = ISDestroy(&(mesh->e)); CHKERRQ(ierr);
+    ierr = ISDestroy(&(mesh->bf)); CHKERRQ(ierr);
+    ierr = ISDestroy(&(mesh->ns)); CHKERRQ(ierr);
+    ierr = VecCreateSeqWithArray(PETSC_COMM_SELF,1,2*mesh->N,sloc,
+                                 &(mesh->loc)); CHKERRQ(ierr);
+    ierr = ISCreateGeneral(PETSC_COMM_SELF,3*mesh->K,se,PETSC_USE_POINTER,
+                           &(mesh->e)); CHKERRQ(ierr);
+    ierr = ISCreateGeneral(PETSC_COMM_SELF,mesh->N,sbf,PETSC_USE_POINTER,
+                           &(mesh->bf)); CHKERRQ(ierr);
+    if (mesh->P > 0) {
+        ierr = ISCreateGeneral(PETSC_COMM_SELF,2*mesh->P,sns,PETSC_USE_POINTER,
+                               &(mesh->ns)); CHKERRQ(ierr);
+    }
+
+    // consistency: the maximum of h equals the minimum, which is ~max(~h)
+    hash[0] = UMHashArrays(mesh->N,mesh->K,mesh->P,sloc,se,sbf,sns);
+    hash[2] = (!same) ? ~hash[0] : (own ? hown : hash[0]);
+    hash[1] = ~hash[0];
+    hash[3] = ~hash[2];
+    ierr = MPI_Allreduce(MPI_IN_PLACE,hash,4,MPI_UNSIGNED_LONG_LONG,MPI_MAX,
+                         PETSC_COMM_WORLD); CHKERRQ(ierr);
+    if ((hash[0] != ~hash[1]) || (hash[2] != ~hash[3]) || (hash[0] != hash[2])) {
+        SETERRQ(PETSC_COMM_SELF,4,"processes do not hold the same mesh\n");
+    }
+    return 0;
+}
+
+/* Each process takes the nodes, elements and Neumann segments which
+UMReadPartitioned() would give it, but from a mesh which it already holds
+whole, for example in shared memory from UMShareReadOnly().  Nothing is
+communicated and the result is identical to UMReadPartitioned(). */
+PetscErrorCode UMCreatePartition(UM *mesh, UM *part) {
+    PetscErrorCode ierr;
+    PetscMPIInt    size, rank;
+    const PetscInt *ae, *abf, *ans = NULL;
+    const PetscReal *axy;
+    PetscInt       nstart, nend, Kloc, Ploc, Nghost, k, p, i, gmin,
+                   *eloc, *nsloc, *ghost, *bfghost;
+    PetscReal      *xyghost;
+
+    if ((mesh->ltog != NULL) || (!mesh->loc) || (!mesh->e) || (!mesh->bf) || (mesh->N == 0)) {
+        SETERRQ(PETSC_COMM_SELF,1,"UMCreatePartition() needs a whole mesh\n");
+    }
+    if ((part->N > 0) || (part->K > 0) || (part->loc != NULL) || (part->e != NULL)) {
+        SETERRQ(PETSC_COMM_SELF,2,"partitioned mesh already created? ... stopping\n");
+    }
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD,&size); CHKERRQ(ierr);
+    ierr = MPI_Comm_rank(PETSC_COMM_WORLD,&rank); CHKERRQ(ierr);
+    UMBlockRange(mesh->N,size,rank,&nstart,&nend);
+    ierr = ISGetIndices(mesh->e,&ae); CHKERRQ(ierr);
+    ierr = ISGetIndices(mesh->bf,&abf); CHKERRQ(ierr);
+    if (mesh->P > 0) {
+        ierr = ISGetIndices(mesh->ns,&ans); CHKERRQ(ierr);
+    }
+    ierr = VecGetArrayRead(mesh->loc,&axy); CHKERRQ(ierr);
+
+    // elements and segments go to the owner of their lowest-numbered node
+    Kloc = 0;
+    for (k = 0; k < mesh->K; k++) {
+        gmin = PetscMin(ae[3*k],PetscMin(ae[3*k+1],ae[3*k+2]));
+        if ((gmin >= nstart) && (gmin < nend))
+            Kloc++;
+    }
+    ierr = PetscMalloc1(3*Kloc,&eloc); CHKERRQ(ierr);
+    Kloc = 0;
+    for (k = 0; k < mesh->K; k++) {
+        gmin = PetscMin(ae[3*k],PetscMin(ae[3*k+1],ae[3*k+2]));
+        if ((gmin >= nstart) && (gmin < nend)) {
+            for (i = 0; i < 3; i++)
+                eloc[3*Kloc+i] = ae[3*k+i];
+            Kloc++;
+        }
+    }
+    Ploc = 0;
+    for (p = 0; p < mesh->P; p++) {
+        gmin = PetscMin(ans[2*p],ans[2*p+1]);
+        if ((gmin >= nstart) && (gmin < nend))
+            Ploc++;
+    }
+    ierr = PetscMalloc1(2*Ploc,&nsloc); CHKERRQ(ierr);
+    Ploc = 0;
+    for (p = 0; p < mesh->P; p++) {
+        gmin = PetscMin(ans[2*p],ans[2*p+1]);
+        if ((gmin >= nstart) && (gmin < nend)) {
+            nsloc[2*Ploc+0] = ans[2*p+0];
+            nsloc[2*Ploc+1] = ans[2*p+1];
+            Ploc++;
+        }
+    }
+
+    ierr = UMFindGhosts(nstart,nend,Kloc,eloc,Ploc,nsloc,&Nghost,&ghost); CHKERRQ(ierr);
+    ierr = PetscMalloc2(Nghost,&bfghost,2*Nghost,&xyghost); CHKERRQ(ierr);
+    for (i = 0; i < Nghost; i++) {
+        bfghost[i] = abf[ghost[i]];
+        xyghost[2*i+0] = axy[2*ghost[i]+0];
+        xyghost[2*i+1] = axy[2*ghost[i]+1];
+    }
+    ierr = UMSetLocal(part,nstart,nend-nstart,abf+nstart,axy+2*nstart,
+                      Nghost,ghost,bfghost,xyghost,
+                      Kloc,eloc,Ploc,nsloc); CHKERRQ(ierr);
+    ierr = PetscFree2(bfghost,xyghost); CHKERRQ(ierr);
+    ierr = PetscFree(ghost); CHKERRQ(ierr);
+
+    ierr = VecRestoreArrayRead(mesh->loc,&axy); CHKERRQ(ierr);
+    if (mesh->P > 0) {
+        ierr = ISRestoreIndices(mesh->ns,&ans); CHKERRQ(ierr);
+    }
+    ierr = ISRestoreIndices(mesh->bf,&abf); CHKERRQ(ierr);
+    ierr = ISRestoreIndices(mesh->e,&ae); CHKERRQ(ierr);
+    return 0;
+}
+
 PetscErrorCode UMStats(UM *mesh, PetscReal *maxh, PetscReal *meanh,
                        PetscReal *maxa, PetscReal *meana) {
     PetscErrorCode ierr;
     const PetscInt *ae;
     const Node     *aloc;
-    PetscInt       k;
+    PetscInt       k, K = mesh->K;
     PetscReal      x[3], y[3], ax, ay, bx, by, cx, cy, h, a,
-                   Maxh = 0.0, Maxa = 0.0, Sumh = 0.0, Suma = 0.0;
-    if ((mesh->K == 0) || (mesh->e == NULL)) {
+                   Max[2] = {0.0, 0.0}, Sum[2] = {0.0, 0.0};  // h, a
+    // a partitioned mesh may have no elements on some processes
+    if ((mesh->e == NULL) || ((mesh->K == 0) && (mesh->ltog == NULL))) {
         SETERRQ(PETSC_COMM_SELF,1,
                 "number of elements unknown; call UMReadElements() first\n");
     }
-    if (mesh->N == 0) {
+    if ((mesh->N == 0) && (mesh->ltog == NULL)) {
         SETERRQ(PETSC_COMM_SELF,2,
                 "node size unknown so element check impossible; call UMReadNodes() first\n");
     }
@@ -278,23 +990,35 @@ PetscErrorCode UMStats(UM *mesh, PetscReal *maxh, PetscReal *meanh,
         h = PetscMax(ax*ax+ay*ay, PetscMax(bx*bx+by*by, cx*cx+cy*cy));
         h = sqrt(h);
         a = 0.5 * PetscAbs(ax*by-ay*bx);
-        Maxh = PetscMax(Maxh,h);
-        Sumh += h;
-        Maxa = PetscMax(Maxa,a);
-        Suma += a;
+        Max[0] = PetscMax(Max[0],h);
+        Sum[0] += h;
+        Max[1] = PetscMax(Max[1],a);
+        Sum[1] += a;
     }
     ierr = ISRestoreIndices(mesh->e,&ae); CHKERRQ(ierr);
     ierr = UMRestoreNodeCoordArrayRead(mesh,&aloc); CHKERRQ(ierr);
-    if (maxh)  *maxh = Maxh;
-    if (maxa)  *maxa = Maxa;
-    if (meanh)  *meanh = Sumh / mesh->K;
-    if (meana)  *meana = Suma / mesh->K;
+    // each element of a partitioned mesh is on exactly one process
+    if (mesh->ltog) {
+        ierr = MPI_Allreduce(MPI_IN_PLACE,Max,2,MPIU_REAL,MPIU_MAX,
+                             PETSC_COMM_WORLD); CHKERRQ(ierr);
+        ierr = MPI_Allreduce(MPI_IN_PLACE,Sum,2,MPIU_REAL,MPIU_SUM,
+                             PETSC_COMM_WORLD); CHKERRQ(ierr);
+        ierr = MPI_Allreduce(MPI_IN_PLACE,&K,1,MPIU_INT,MPIU_SUM,
+                             PETSC_COMM_WORLD); CHKERRQ(ierr);
+        if (K == 0) {
+            SETERRQ(PETSC_COMM_SELF,1,"partitioned mesh has no elements\n");
+        }
+    }
+    if (maxh)  *maxh = Max[0];
+    if (maxa)  *maxa = Max[1];
+    if (meanh)  *meanh = Sum[0] / K;
+    if (meana)  *meana = Sum[1] / K;
     return 0;
 }
 
 PetscErrorCode UMGetNodeCoordArrayRead(UM *mesh, const Node **xy) {
     PetscErrorCode ierr;
-    if ((!mesh->loc) || (mesh->N == 0)) {
+    if (!mesh->loc) {
         SETERRQ(PETSC_COMM_SELF,1,"node coordinates not created ... stopping\n");
     }
     ierr = VecGetArrayRead(mesh->loc,(const PetscReal **)xy); CHKERRQ(ierr);
@@ -304,7 +1028,7 @@ PetscErrorCode UMGetNodeCoordArrayRead(UM *mesh, const Node **xy) {
 
 PetscErrorCode UMRestoreNodeCoordArrayRead(UM *mesh, const Node **xy) {
     PetscErrorCode ierr;
-    if ((!mesh->loc) || (mesh->N == 0)) {
+    if (!mesh->loc) {
         SETERRQ(PETSC_COMM_SELF,1,"node coordinates not created ... stopping\n");
     }
     ierr = VecRestoreArrayRead(mesh->loc,(const PetscReal **)xy); CHKERRQ(ierr);
@@ -11,7 +11,11 @@ typedef struct {
 typedef struct {
     PetscInt N,     // number of nodes
              K,     // number of elements
-             P;     // number of Neumann boundary segments; may be 0
+             P,     // number of Neumann boundary segments; may be 0
+             Nown;  // number of owned nodes; Nown = N unless created by
+                    //     UMReadPartitioned() or UMCreatePartition(), in
+                    //     which case the first Nown of the N local nodes
+                    //     are owned
     Vec      loc;   // nodal locations; length N, dof=2 Vec
     IS       e,     // element triples; length 3K
                     //     values e[3*k+0],e[3*k+1],e[3*k+2]
@@ -22,6 +26,10 @@ typedef struct {
              ns;    // Neumann boundary segment pairs; length 2P;
                     //     may be a null ptr; values s[2*p+0],s[2*p+1]
                     //     are indices into node-based Vecs
+    ISLocalToGlobalMapping ltog; // local-to-global node numbering; NULL
+                                 //     for a whole mesh
+    MPI_Win  win;   // shared memory holding loc,e,bf,ns; MPI_WIN_NULL
+                    //     unless UMShareReadOnly() was called
 } UM;
 //ENDSTRUCT
 
@@ -29,21 +37,44 @@ typedef struct {
 
 //STARTDECLARE
 PetscErrorCode UMInitialize(UM *mesh);  // call first
-PetscErrorCode UMDestroy(UM *mesh);     // call last
+PetscErrorCode UMDestroy(UM *mesh);     // call last; collective if
+                                        //   UMShareReadOnly() was called
 
-// create Vec and then read node coordinates from file into it
+// create Vec and then read node coordinates from file into it; the whole
+//   mesh is read by the calling process alone
 PetscErrorCode UMReadNodes(UM *mesh, char *filename);
 
 // create ISs and then read element triples, Neumann boundary segments,
 //   and boundary flags into them; call UMReadNodes() first
 PetscErrorCode UMReadISs(UM *mesh, char *filename);
 
+// read, in parallel, only the part of the mesh owned by this process plus
+//   its ghost nodes; collective
+PetscErrorCode UMReadPartitioned(UM *mesh, char *nodesname, char *issname);
+
+// give every process the whole mesh read on rank 0, by putting the
+//   (read-only) arrays loc,e,bf,ns into one MPI-3 shared memory window per
+//   shared-memory node; other processes pass an empty mesh or the same one;
+//   checks that all processes then hold the same mesh; collective
+PetscErrorCode UMShareReadOnly(UM *mesh);
+
+// from a whole mesh held by every process create the same partitioned
+//   mesh as UMReadPartitioned(); collective
+PetscErrorCode UMCreatePartition(UM *mesh, UM *part);
+
 // view all fields in UM to the viewer
 PetscErrorCode UMViewASCII(UM *mesh, PetscViewer viewer);
 PetscErrorCode UMViewSolutionBinary(UM *mesh, char *filename, Vec u);
 
+// write whole mesh and nf nodal fields (length N sequential Vecs, with given
+//   names) to a VTK unstructured grid (.vtu) file with raw appended binary
+//   data; call on one process
+PetscErrorCode UMViewVTKBinary(UM *mesh, char *filename,
+                               PetscInt nf, Vec fields[], const char *names[]);
+
 // compute statistics for mesh:  maxh,meanh are for triangle side
-//   lengths; maxa,meana are for areas
+//   lengths; maxa,meana are for areas; for a partitioned mesh these are over
+//   the whole mesh, so the call is collective
 PetscErrorCode UMStats(UM *mesh, PetscReal *maxh, PetscReal *meanh,
                        PetscReal *maxa, PetscReal *meana);
 
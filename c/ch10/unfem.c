@@ -23,6 +23,12 @@ typedef struct {
     PetscReal (*gD_fcn)(PetscReal, PetscReal);
     PetscReal (*gN_fcn)(PetscReal, PetscReal);
     PetscReal (*uexact_fcn)(PetscReal, PetscReal);
+    PetscReal lagtol;     // reuse Picard matrix while relative change in
+                          //   a() at owned nodes is below lagtol
+    PetscReal *anodelast; // a() at owned nodes at last assembly
+    PetscInt  assemblecount, reusecount;
+    VecScatter scatter;   // on a partitioned mesh, from global Vecs to
+    Vec       uloc, Floc; //   local Vecs over owned and ghost nodes
     PetscLogStage readstage, setupstage, solverstage, resstage, jacstage;  //STRIP
 } unfemCtx;
 //ENDCTX
@@ -48,20 +54,29 @@ PetscReal eval(const PetscReal v[3], PetscReal xi, PetscReal eta) {
 extern PetscErrorCode FillExact(Vec, unfemCtx*);
 extern PetscErrorCode FormFunction(SNES, Vec, Vec, void*);
 extern PetscErrorCode FormPicard(SNES, Vec, Mat, Mat, void*);
+extern PetscErrorCode CoefficientChange(Vec, unfemCtx*, PetscReal*);
 extern PetscErrorCode PreallocateAndSetNonzeros(Mat, unfemCtx*);
+extern PetscErrorCode CreateLocalVecs(Vec, unfemCtx*);
+extern PetscErrorCode FormFunctionPartitioned(SNES, Vec, Vec, void*);
+extern PetscErrorCode FormPicardPartitioned(SNES, Vec, Mat, Mat, void*);
+extern PetscErrorCode PreallocatePartitioned(Mat, unfemCtx*);
 
 int main(int argc,char **argv) {
     PetscErrorCode ierr;
-    PetscMPIInt size;
+    PetscMPIInt size, rank;
     PetscBool   viewmesh = PETSC_FALSE,
                 viewsoln = PETSC_FALSE,
+                viewvtu = PETSC_FALSE,
                 noprealloc = PETSC_FALSE,
+                readpartitioned = PETSC_FALSE,
+                sharedmesh = PETSC_FALSE,
                 savepintbinary = PETSC_FALSE,
                 savepintmatlab = PETSC_FALSE;
     char        root[256] = "", nodesname[256], issname[256], solnname[256],
+                vtuname[256],
                 pintname[256] = "";
-    PetscInt    savepintlevel = -1, levels;
-    UM          mesh;
+    PetscInt    savepintlevel = -1, levels, Nglobal;
+    UM          mesh, wholemesh, *whole;
     unfemCtx    user;
     SNES        snes;
     KSP         ksp;
@@ -74,9 +89,7 @@ int main(int argc,char **argv) {
     ierr = PetscInitialize(&argc,&argv,NULL,help); if (ierr) return ierr;
 
     ierr = MPI_Comm_size(PETSC_COMM_WORLD,&size); CHKERRQ(ierr);
-    if (size != 1) {
-        SETERRQ(PETSC_COMM_SELF,1,"unfem only works on one MPI process");
-    }
+    ierr = MPI_Comm_rank(PETSC_COMM_WORLD,&rank); CHKERRQ(ierr);
 
     ierr = PetscLogStageRegister("Read mesh      ", &user.readstage); CHKERRQ(ierr);  //STRIP
     ierr = PetscLogStageRegister("Set-up         ", &user.setupstage); CHKERRQ(ierr);  //STRIP
@@ -86,6 +99,13 @@ int main(int argc,char **argv) {
 
     user.quaddegree = 1;
     user.solncase = 0;
+    user.lagtol = 0.0;
+    user.anodelast = NULL;
+    user.assemblecount = 0;
+    user.reusecount = 0;
+    user.scatter = NULL;
+    user.uloc = NULL;
+    user.Floc = NULL;
     ierr = PetscOptionsBegin(PETSC_COMM_WORLD, "un_", "options for unfem", ""); CHKERRQ(ierr);
     ierr = PetscOptionsInt("-case",
            "exact solution cases: 0=linear, 1=nonlinear, 2=nonhomoNeumann, 3=chapter3, 4=koch",
@@ -99,6 +119,9 @@ int main(int argc,char **argv) {
     ierr = PetscOptionsInt("-gamg_save_pint_level",
            "saved interpolation operator is between L-1 and L where this option sets L; defaults to finest levels",
            "unfem.c",savepintlevel,&savepintlevel,NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsReal("-lag_tol",
+           "reuse Picard matrix and preconditioner while the relative change in a(u,x,y) at the nodes, since last assembly, is below this; 0 means always reassemble",
+           "unfem.c",user.lagtol,&(user.lagtol),NULL); CHKERRQ(ierr);
     ierr = PetscOptionsString("-mesh",
            "file name root of mesh stored in PETSc binary with .vec,.is extensions",
            "unfem.c",root,root,sizeof(root),NULL); CHKERRQ(ierr);
@@ -108,18 +131,38 @@ int main(int argc,char **argv) {
     ierr = PetscOptionsInt("-quaddegree",
            "quadrature degree (1,2,3)",
            "unfem.c",user.quaddegree,&(user.quaddegree),NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-read_partitioned",
+           "read mesh in parallel slices using MPI-IO (see UMReadPartitioned()); always used on more than one process",
+           "unfem.c",readpartitioned,&readpartitioned,NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-shared_mesh",
+           "read whole mesh on rank 0 and share it in MPI-3 shared memory (see UMShareReadOnly()), then partition it; allows -un_view_solution and -un_view_vtu on more than one process",
+           "unfem.c",sharedmesh,&sharedmesh,NULL); CHKERRQ(ierr);
     ierr = PetscOptionsBool("-view_mesh",
            "view loaded mesh (nodes and elements) at stdout",
            "unfem.c",viewmesh,&viewmesh,NULL); CHKERRQ(ierr);
     ierr = PetscOptionsBool("-view_solution",
            "view solution u(x,y) to binary file; uses root name of mesh plus .soln\nsee petsc2tricontour.py to view graphically",
            "unfem.c",viewsoln,&viewsoln,NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-view_vtu",
+           "view mesh and solution u(x,y), plus exact solution if available, to VTK file with binary data; uses root name of mesh plus .vtu",
+           "unfem.c",viewvtu,&viewvtu,NULL); CHKERRQ(ierr);
     ierr = PetscOptionsEnd(); CHKERRQ(ierr);
 
     // determine filenames
     if (strlen(root) == 0) {
         SETERRQ(PETSC_COMM_SELF,2,"no mesh name root given; rerun with '-un_mesh foo'");
     }
+    if (readpartitioned && sharedmesh) {
+        SETERRQ(PETSC_COMM_SELF,8,"use only one of -un_read_partitioned and -un_shared_mesh");
+    }
+    // on more than one process each process holds only its part of the mesh;
+    //   the whole mesh is also kept, in shared memory, if -un_shared_mesh
+    if (size > 1 && !sharedmesh)
+        readpartitioned = PETSC_TRUE;
+    whole = sharedmesh ? &wholemesh : ((size == 1 && !readpartitioned) ? &mesh : NULL);
+    if ((viewsoln || viewvtu) && !whole) {
+        SETERRQ(PETSC_COMM_SELF,9,"options -un_view_solution and -un_view_vtu need the whole mesh; on more than one process add -un_shared_mesh");
+    }
     strcpy(nodesname, root);
     strncat(nodesname, ".vec", 5);
     strcpy(issname, root);
@@ -162,8 +205,20 @@ int main(int argc,char **argv) {
     PetscLogStagePush(user.readstage);
     // read mesh object of type UM
     ierr = UMInitialize(&mesh); CHKERRQ(ierr);
-    ierr = UMReadNodes(&mesh,nodesname); CHKERRQ(ierr);
-    ierr = UMReadISs(&mesh,issname); CHKERRQ(ierr);
+    ierr = UMInitialize(&wholemesh); CHKERRQ(ierr);
+    if (readpartitioned) {
+        ierr = UMReadPartitioned(&mesh,nodesname,issname); CHKERRQ(ierr);
+    } else if (sharedmesh) {
+        if (rank == 0) {
+            ierr = UMReadNodes(&wholemesh,nodesname); CHKERRQ(ierr);
+            ierr = UMReadISs(&wholemesh,issname); CHKERRQ(ierr);
+        }
+        ierr = UMShareReadOnly(&wholemesh); CHKERRQ(ierr);
+        ierr = UMCreatePartition(&wholemesh,&mesh); CHKERRQ(ierr);
+    } else {
+        ierr = UMReadNodes(&mesh,nodesname); CHKERRQ(ierr);
+        ierr = UMReadISs(&mesh,issname); CHKERRQ(ierr);
+    }
     ierr = UMStats(&mesh, &h_max, NULL, NULL, NULL); CHKERRQ(ierr);
     user.mesh = &mesh;
     PetscLogStagePop();
@@ -178,22 +233,27 @@ int main(int argc,char **argv) {
 //STARTMAININITIAL
     // configure Vecs
     ierr = VecCreate(PETSC_COMM_WORLD,&r); CHKERRQ(ierr);
-    ierr = VecSetSizes(r,PETSC_DECIDE,mesh.N); CHKERRQ(ierr);
+    ierr = VecSetSizes(r,mesh.Nown,PETSC_DETERMINE); CHKERRQ(ierr);
     ierr = VecSetFromOptions(r); CHKERRQ(ierr);
     ierr = VecDuplicate(r,&u); CHKERRQ(ierr);
     ierr = VecSet(u,0.0); CHKERRQ(ierr);
 
     // configure SNES: reset default KSP and PC
     ierr = SNESCreate(PETSC_COMM_WORLD,&snes); CHKERRQ(ierr);
-    ierr = SNESSetFunction(snes,r,FormFunction,&user); CHKERRQ(ierr);
+    if (mesh.ltog) {
+        ierr = CreateLocalVecs(r,&user); CHKERRQ(ierr);
+        ierr = SNESSetFunction(snes,r,FormFunctionPartitioned,&user); CHKERRQ(ierr);
+    } else {
+        ierr = SNESSetFunction(snes,r,FormFunction,&user); CHKERRQ(ierr);
+    }
     ierr = SNESGetKSP(snes,&ksp); CHKERRQ(ierr);
     ierr = KSPSetType(ksp,KSPCG); CHKERRQ(ierr);
     ierr = KSPGetPC(ksp,&pc); CHKERRQ(ierr);
-    ierr = PCSetType(pc,PCICC); CHKERRQ(ierr);
+    ierr = PCSetType(pc,(size > 1) ? PCBJACOBI : PCICC); CHKERRQ(ierr);
 
     // setup matrix for Picard iteration, including preallocation
     ierr = MatCreate(PETSC_COMM_WORLD,&A); CHKERRQ(ierr);
-    ierr = MatSetSizes(A,PETSC_DECIDE,PETSC_DECIDE,mesh.N,mesh.N); CHKERRQ(ierr);
+    ierr = MatSetSizes(A,mesh.Nown,mesh.Nown,PETSC_DETERMINE,PETSC_DETERMINE); CHKERRQ(ierr);
     ierr = MatSetFromOptions(A); CHKERRQ(ierr);
     ierr = MatSetOption(A,MAT_SYMMETRIC,PETSC_TRUE); CHKERRQ(ierr);
     // Preallocation and setting the nonzero (sparsity) pattern is
@@ -202,12 +262,31 @@ int main(int argc,char **argv) {
     //   -un_noprealloc reveals the poor performance otherwise.
     if (noprealloc) {
         ierr = MatSetUp(A); CHKERRQ(ierr);
+    } else if (mesh.ltog) {
+        ierr = PreallocatePartitioned(A,&user); CHKERRQ(ierr);
     } else {
         ierr = PreallocateAndSetNonzeros(A,&user); CHKERRQ(ierr);
     }
+    // FormPicard() sets entries using the local node numbering of the mesh,
+    //   which is the global numbering unless the mesh is partitioned
+    if (mesh.ltog) {
+        ierr = MatSetLocalToGlobalMapping(A,mesh.ltog,mesh.ltog); CHKERRQ(ierr);
+    } else {
+        IS                     isid;
+        ISLocalToGlobalMapping ltogid;
+        ierr = ISCreateStride(PETSC_COMM_SELF,mesh.N,0,1,&isid); CHKERRQ(ierr);
+        ierr = ISLocalToGlobalMappingCreateIS(isid,&ltogid); CHKERRQ(ierr);
+        ierr = MatSetLocalToGlobalMapping(A,ltogid,ltogid); CHKERRQ(ierr);
+        ierr = ISLocalToGlobalMappingDestroy(&ltogid); CHKERRQ(ierr);
+        ierr = ISDestroy(&isid); CHKERRQ(ierr);
+    }
     // The following call-back is ignored under option -snes_fd or
     //   -snes_fd_color.
-    ierr = SNESSetJacobian(snes,A,A,FormPicard,&user); CHKERRQ(ierr);
+    if (mesh.ltog) {
+        ierr = SNESSetJacobian(snes,A,A,FormPicardPartitioned,&user); CHKERRQ(ierr);
+    } else {
+        ierr = SNESSetJacobian(snes,A,A,FormPicard,&user); CHKERRQ(ierr);
+    }
     ierr = SNESSetFromOptions(snes); CHKERRQ(ierr);
     PetscLogStagePop();  //STRIP
 
@@ -217,6 +296,13 @@ int main(int argc,char **argv) {
 //ENDMAININITIAL
     PetscLogStagePop();
 
+    // report Picard matrix reuse if lagging
+    if (user.lagtol > 0.0) {
+        ierr = PetscPrintf(PETSC_COMM_WORLD,
+               "  Picard matrix assembled %d times and reused %d times\n",
+               user.assemblecount,user.reusecount); CHKERRQ(ierr);
+    }
+
     // report if PC is GAMG
     ierr = PCGetType(pc,&pctype); CHKERRQ(ierr);
     if (strcmp(pctype,"gamg") == 0) {
@@ -258,7 +344,44 @@ int main(int argc,char **argv) {
         ierr = MatView(pint,viewer); CHKERRQ(ierr);
     }
 
+    // save mesh and solution(s) in VTK format if requested; before error
+    //   computation because that overwrites u
+    //   u is gathered onto rank 0, which writes the file; global node
+    //   numbering is the same as in the whole mesh
+    if (viewvtu) {
+        Vec         fields[2], fields0[2];
+        VecScatter  ctx;
+        const char  *names[2] = {"u", "u_exact"};
+        PetscInt    nf = 1, m;
+        fields[0] = u;
+        if (user.uexact_fcn) {
+            ierr = VecDuplicate(r,&fields[1]); CHKERRQ(ierr);
+            ierr = FillExact(fields[1],&user); CHKERRQ(ierr);
+            nf = 2;
+        }
+        strcpy(vtuname, root);
+        strncat(vtuname, ".vtu", 5);
+        ierr = PetscPrintf(PETSC_COMM_WORLD,
+                   "writing mesh and solution in VTK format to %s ...\n",vtuname); CHKERRQ(ierr);
+        for (m = 0; m < nf; m++) {
+            ierr = VecScatterCreateToZero(fields[m],&ctx,&fields0[m]); CHKERRQ(ierr);
+            ierr = VecScatterBegin(ctx,fields[m],fields0[m],INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+            ierr = VecScatterEnd(ctx,fields[m],fields0[m],INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+            ierr = VecScatterDestroy(&ctx); CHKERRQ(ierr);
+        }
+        if (rank == 0) {
+            ierr = UMViewVTKBinary(whole,vtuname,nf,fields0,names); CHKERRQ(ierr);
+        }
+        for (m = 0; m < nf; m++) {
+            ierr = VecDestroy(&fields0[m]); CHKERRQ(ierr);
+        }
+        if (nf == 2) {
+            ierr = VecDestroy(&fields[1]); CHKERRQ(ierr);
+        }
+    }
+
     // if exact solution available, report numerical error
+    ierr = VecGetSize(u,&Nglobal); CHKERRQ(ierr);
     if (user.uexact_fcn) {
         ierr = VecDuplicate(r,&uexact); CHKERRQ(ierr);
         ierr = FillExact(uexact,&user); CHKERRQ(ierr);
@@ -266,12 +389,12 @@ int main(int argc,char **argv) {
         ierr = VecNorm(u,NORM_INFINITY,&err); CHKERRQ(ierr);
         ierr = PetscPrintf(PETSC_COMM_WORLD,
                    "case %d result for N=%d nodes with h = %.3e: |u-u_ex|_inf = %.2e\n",
-                   user.solncase,mesh.N,h_max,err); CHKERRQ(ierr);
+                   user.solncase,Nglobal,h_max,err); CHKERRQ(ierr);
         VecDestroy(&uexact);
     } else {
         ierr = PetscPrintf(PETSC_COMM_WORLD,
                    "case %d result for N=%d nodes with h = %.3e ... done\n",
-                   user.solncase,mesh.N,h_max); CHKERRQ(ierr);
+                   user.solncase,Nglobal,h_max); CHKERRQ(ierr);
     }
 
     // save solution in PETSc binary if requested
@@ -280,12 +403,17 @@ int main(int argc,char **argv) {
         strncat(solnname, ".soln", 6);
         ierr = PetscPrintf(PETSC_COMM_WORLD,
                    "writing solution in binary format to %s ...\n",solnname); CHKERRQ(ierr);
-        ierr = UMViewSolutionBinary(&mesh,solnname,u); CHKERRQ(ierr);
+        ierr = UMViewSolutionBinary(whole,solnname,u); CHKERRQ(ierr);
     }
 
     // clean-up
     VecDestroy(&u);  VecDestroy(&r);
     MatDestroy(&A);  SNESDestroy(&snes);  UMDestroy(&mesh);
+    ierr = UMDestroy(&wholemesh); CHKERRQ(ierr);  // collective if shared
+    PetscFree(user.anodelast);
+    ierr = VecScatterDestroy(&(user.scatter)); CHKERRQ(ierr);
+    ierr = VecDestroy(&(user.uloc)); CHKERRQ(ierr);
+    ierr = VecDestroy(&(user.Floc)); CHKERRQ(ierr);
     return PetscFinalize();
 }
 
@@ -296,7 +424,7 @@ PetscErrorCode FillExact(Vec uexact, unfemCtx *ctx) {
     PetscInt     i;
     ierr = UMGetNodeCoordArrayRead(ctx->mesh,&aloc); CHKERRQ(ierr);
     ierr = VecGetArray(uexact,&auexact); CHKERRQ(ierr);
-    for (i = 0; i < ctx->mesh->N; i++) {
+    for (i = 0; i < ctx->mesh->Nown; i++) {
         auexact[i] = ctx->uexact_fcn(aloc[i].x,aloc[i].y);
     }
     ierr = VecRestoreArray(uexact,&auexact); CHKERRQ(ierr);
@@ -418,21 +546,45 @@ PetscErrorCode FormPicard(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
     const Node       *aloc;
     const PetscReal  *au;
     PetscReal        unode[3], gradpsi[3][2], uquad[4], aquad[4], v[9],
-                     dx1, dx2, dy1, dy2, detJ, xx, yy, sum;
+                     dx1, dx2, dy1, dy2, detJ, xx, yy, sum, change;
     PetscInt         n, k, l, m, r, cr, cv, row[3];
 
     PetscLogStagePush(user->jacstage);  //STRIP
+    if (user->lagtol > 0.0) {
+        if (user->anodelast == NULL) {
+            ierr = PetscMalloc1(user->mesh->Nown,&(user->anodelast)); CHKERRQ(ierr);
+        } else {
+            ierr = CoefficientChange(u,user,&change); CHKERRQ(ierr);
+            if (change < user->lagtol) {
+                // leaving P unchanged means PCSetUp() keeps the preconditioner
+                user->reusecount++;
+                if (A != P) {
+                    ierr = MatAssemblyBegin(A,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+                    ierr = MatAssemblyEnd(A,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+                }
+                PetscLogStagePop();  //STRIP
+                return 0;
+            }
+        }
+    }
+    user->assemblecount++;
     ierr = MatZeroEntries(P); CHKERRQ(ierr);
     ierr = ISGetIndices(user->mesh->bf,&abf); CHKERRQ(ierr);
-    for (n = 0; n < user->mesh->N; n++) {
+    for (n = 0; n < user->mesh->Nown; n++) {
         if (abf[n] == 2) {
             v[0] = 1.0;
-            ierr = MatSetValues(P,1,&n,1,&n,v,ADD_VALUES); CHKERRQ(ierr);
+            ierr = MatSetValuesLocal(P,1,&n,1,&n,v,ADD_VALUES); CHKERRQ(ierr);
         }
     }
     ierr = ISGetIndices(user->mesh->e,&ae); CHKERRQ(ierr);
     ierr = VecGetArrayRead(u,&au); CHKERRQ(ierr);
     ierr = UMGetNodeCoordArrayRead(user->mesh,&aloc); CHKERRQ(ierr);
+    if (user->anodelast) {
+        for (n = 0; n < user->mesh->Nown; n++) {
+            if (abf[n] != 2)
+                user->anodelast[n] = user->a_fcn(au[n],aloc[n].x,aloc[n].y);
+        }
+    }
     for (k = 0; k < user->mesh->K; k++) {
         en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
         // geometry of element
@@ -474,7 +626,7 @@ PetscErrorCode FormPicard(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
                 }
             }
         }
-        ierr = MatSetValues(P,cr,row,cr,row,v,ADD_VALUES); CHKERRQ(ierr);
+        ierr = MatSetValuesLocal(P,cr,row,cr,row,v,ADD_VALUES); CHKERRQ(ierr);
     }
     ierr = ISRestoreIndices(user->mesh->e,&ae); CHKERRQ(ierr);
     ierr = ISRestoreIndices(user->mesh->bf,&abf); CHKERRQ(ierr);
@@ -493,6 +645,40 @@ PetscErrorCode FormPicard(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
 //ENDPICARD
 
 
+// Compute the relative change, in the max norm over owned non-Dirichlet
+// nodes, of a(u,x,y) from the values saved at the last Picard matrix
+// assembly.  Because a() is evaluated once per node, and not at each
+// quadrature point of each element, this costs a small fraction of an
+// assembly.  The maxima are over all processes so that all agree on reuse.
+PetscErrorCode CoefficientChange(Vec u, unfemCtx *user, PetscReal *change) {
+    PetscErrorCode ierr;
+    const PetscInt   *abf;
+    const Node       *aloc;
+    const PetscReal  *au;
+    PetscReal        anode,
+                     max[2] = {0.0, 0.0};  // max |change|, max |a|
+    PetscInt         n;
+
+    ierr = ISGetIndices(user->mesh->bf,&abf); CHKERRQ(ierr);
+    ierr = VecGetArrayRead(u,&au); CHKERRQ(ierr);
+    ierr = UMGetNodeCoordArrayRead(user->mesh,&aloc); CHKERRQ(ierr);
+    for (n = 0; n < user->mesh->Nown; n++) {
+        if (abf[n] != 2) {
+            anode = user->a_fcn(au[n],aloc[n].x,aloc[n].y);
+            max[0] = PetscMax(max[0],PetscAbsReal(anode - user->anodelast[n]));
+            max[1] = PetscMax(max[1],PetscAbsReal(user->anodelast[n]));
+        }
+    }
+    ierr = ISRestoreIndices(user->mesh->bf,&abf); CHKERRQ(ierr);
+    ierr = VecRestoreArrayRead(u,&au); CHKERRQ(ierr);
+    ierr = UMRestoreNodeCoordArrayRead(user->mesh,&aloc); CHKERRQ(ierr);
+    ierr = MPI_Allreduce(MPI_IN_PLACE,max,2,MPIU_REAL,MPIU_MAX,
+                         PETSC_COMM_WORLD); CHKERRQ(ierr);
+    *change = (max[1] > 0.0) ? max[0] / max[1] : max[0];
+    return 0;
+}
+
+
 /* The following procedure is accomplishes essentially the same actions
 as DMCreateMatrix() when a DM is present.  It first preallocates storage
 for the sparse matrix by providing a count of the entries.  Then it
@@ -554,3 +740,115 @@ PetscErrorCode PreallocateAndSetNonzeros(Mat J, unfemCtx *user) {
 }
 //ENDPREALLOC
 
+
+
+/* On a partitioned mesh (see UMReadPartitioned()) each process holds its
+owned nodes, then its ghost nodes, and only its own elements.  The residual
+and Picard matrix are computed by FormFunction() and FormPicard() on this
+local mesh, using local Vecs which include ghost values.  Residual
+contributions at ghost nodes are then added into their owners.  A process
+with no elements is allowed. */
+PetscErrorCode CreateLocalVecs(Vec r, unfemCtx *user) {
+    PetscErrorCode ierr;
+    const PetscInt *l2g;
+    IS             isg;
+    ierr = VecCreateSeq(PETSC_COMM_SELF,user->mesh->N,&(user->uloc)); CHKERRQ(ierr);
+    ierr = VecDuplicate(user->uloc,&(user->Floc)); CHKERRQ(ierr);
+    ierr = ISLocalToGlobalMappingGetIndices(user->mesh->ltog,&l2g); CHKERRQ(ierr);
+    ierr = ISCreateGeneral(PETSC_COMM_SELF,user->mesh->N,l2g,PETSC_COPY_VALUES,
+                           &isg); CHKERRQ(ierr);
+    ierr = ISLocalToGlobalMappingRestoreIndices(user->mesh->ltog,&l2g); CHKERRQ(ierr);
+    ierr = VecScatterCreate(r,isg,user->uloc,NULL,&(user->scatter)); CHKERRQ(ierr);
+    ierr = ISDestroy(&isg); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode FormFunctionPartitioned(SNES snes, Vec u, Vec F, void *ctx) {
+    PetscErrorCode ierr;
+    unfemCtx         *user = (unfemCtx*)ctx;
+    const PetscInt   *abf;
+    const Node       *aloc;
+    const PetscReal  *au;
+    PetscReal        *aF;
+    PetscInt         n;
+
+    ierr = VecScatterBegin(user->scatter,u,user->uloc,INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+    ierr = VecScatterEnd(user->scatter,u,user->uloc,INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+    ierr = FormFunction(snes,user->uloc,user->Floc,ctx); CHKERRQ(ierr);
+    // Dirichlet residuals are set, not summed, so only the owner keeps them;
+    //   the owner may hold none of the elements at the node
+    ierr = ISGetIndices(user->mesh->bf,&abf); CHKERRQ(ierr);
+    ierr = UMGetNodeCoordArrayRead(user->mesh,&aloc); CHKERRQ(ierr);
+    ierr = VecGetArrayRead(user->uloc,&au); CHKERRQ(ierr);
+    ierr = VecGetArray(user->Floc,&aF); CHKERRQ(ierr);
+    for (n = 0; n < user->mesh->N; n++) {
+        if (abf[n] == 2) {
+            if (n < user->mesh->Nown)
+                aF[n] = au[n] - user->gD_fcn(aloc[n].x,aloc[n].y);
+            else
+                aF[n] = 0.0;
+        }
+    }
+    ierr = VecRestoreArray(user->Floc,&aF); CHKERRQ(ierr);
+    ierr = VecRestoreArrayRead(user->uloc,&au); CHKERRQ(ierr);
+    ierr = UMRestoreNodeCoordArrayRead(user->mesh,&aloc); CHKERRQ(ierr);
+    ierr = ISRestoreIndices(user->mesh->bf,&abf); CHKERRQ(ierr);
+    ierr = VecSet(F,0.0); CHKERRQ(ierr);
+    ierr = VecScatterBegin(user->scatter,user->Floc,F,ADD_VALUES,SCATTER_REVERSE); CHKERRQ(ierr);
+    ierr = VecScatterEnd(user->scatter,user->Floc,F,ADD_VALUES,SCATTER_REVERSE); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode FormPicardPartitioned(SNES snes, Vec u, Mat A, Mat P, void *ctx) {
+    PetscErrorCode ierr;
+    unfemCtx  *user = (unfemCtx*)ctx;
+    ierr = VecScatterBegin(user->scatter,u,user->uloc,INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+    ierr = VecScatterEnd(user->scatter,u,user->uloc,INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+    ierr = FormPicard(snes,user->uloc,A,P,ctx); CHKERRQ(ierr);
+    return 0;
+}
+
+// Same pattern as PreallocateAndSetNonzeros(), but rows of ghost nodes are
+// completed by other processes, so a MATPREALLOCATOR collects the pattern.
+PetscErrorCode PreallocatePartitioned(Mat J, unfemCtx *user) {
+    PetscErrorCode ierr;
+    Mat             preall;
+    const PetscInt  *ae, *abf, *en;
+    PetscInt        m, n, M, N, k, l, cr, row[3];
+    PetscReal       zero = 0.0,
+                    v[9] = {0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0};
+
+    ierr = MatGetLocalSize(J,&m,&n); CHKERRQ(ierr);
+    ierr = MatGetSize(J,&M,&N); CHKERRQ(ierr);
+    ierr = MatCreate(PETSC_COMM_WORLD,&preall); CHKERRQ(ierr);
+    ierr = MatSetType(preall,MATPREALLOCATOR); CHKERRQ(ierr);
+    ierr = MatSetSizes(preall,m,n,M,N); CHKERRQ(ierr);
+    ierr = MatSetLocalToGlobalMapping(preall,user->mesh->ltog,user->mesh->ltog); CHKERRQ(ierr);
+    ierr = MatSetUp(preall); CHKERRQ(ierr);
+    ierr = ISGetIndices(user->mesh->bf,&abf); CHKERRQ(ierr);
+    ierr = ISGetIndices(user->mesh->e,&ae); CHKERRQ(ierr);
+    for (n = 0; n < user->mesh->Nown; n++) {
+        if (abf[n] == 2) {
+            ierr = MatSetValuesLocal(preall,1,&n,1,&n,&zero,INSERT_VALUES); CHKERRQ(ierr);
+        }
+    }
+    for (k = 0; k < user->mesh->K; k++) {
+        en = ae + 3*k;  // en[0], en[1], en[2] are nodes of element k
+        cr = 0;  // cr = count rows
+        for (l = 0; l < 3; l++) {
+            if (abf[en[l]] != 2) {
+                row[cr++] = en[l];
+            }
+        }
+        ierr = MatSetValuesLocal(preall,cr,row,cr,row,v,INSERT_VALUES); CHKERRQ(ierr);
+    }
+    ierr = ISRestoreIndices(user->mesh->e,&ae); CHKERRQ(ierr);
+    ierr = ISRestoreIndices(user->mesh->bf,&abf); CHKERRQ(ierr);
+    ierr = MatAssemblyBegin(preall,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(preall,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    // preallocates J and inserts zeros in the pattern, then assembles J
+    ierr = MatPreallocatorPreallocate(preall,PETSC_TRUE,J); CHKERRQ(ierr);
+    ierr = MatDestroy(&preall); CHKERRQ(ierr);
+    ierr = MatSetOption(J,MAT_NEW_NONZERO_LOCATION_ERR,PETSC_TRUE); CHKERRQ(ierr);
+    return 0;
+}
@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+#
+# (C) 2020 Ed Bueler
+
+import sys, argparse, re
+import numpy as np
+
+parser = argparse.ArgumentParser(description=
+'''Read a .vtu file written by UMViewVTKBinary() (unfem option -un_view_vtu)
+and report its sizes.  If the file has point fields u and u_exact then also
+report the numerical error, formatted as unfem does.  Decodes the raw
+appended binary data directly, so it checks every array offset.''')
+parser.add_argument('vtufile', metavar='FILE',
+                    help='input .vtu file')
+args = parser.parse_args()
+
+dtypes = {'Float64': 'f8', 'Float32': 'f4', 'Int64': 'i8', 'Int32': 'i4',
+          'UInt8': 'u1'}
+
+data = open(args.vtufile,'rb').read()
+start = data.index(b'<AppendedData encoding="raw">')
+start = data.index(b'_', start) + 1
+header = data[:start].decode('ascii')
+endian = '>' if 'byte_order="BigEndian"' in header else '<'
+
+def readarray(dtype, offset):
+    nbytes = np.frombuffer(data, dtype=endian+'u8', count=1,
+                           offset=start+offset)[0]
+    dt = np.dtype(endian + dtypes[dtype])
+    return np.frombuffer(data, dtype=dt, count=int(nbytes) // dt.itemsize,
+                         offset=start+offset+8)
+
+piece = re.search(r'NumberOfPoints="(\d+)" NumberOfCells="(\d+)"', header)
+N, K = int(piece.group(1)), int(piece.group(2))
+arrays = {}
+for m in re.finditer(r'<DataArray type="(\w+)"( Name="(\w+)")?[^>]*offset="(\d+)"', header):
+    name = m.group(3) if m.group(3) else 'Points'
+    arrays[name] = readarray(m.group(1), int(m.group(4)))
+
+if len(arrays['Points']) != 3*N or len(arrays['connectivity']) != 3*K \
+   or len(arrays['offsets']) != K or len(arrays['types']) != K:
+    print('ERROR: array lengths in %s do not match N=%d, K=%d' % (args.vtufile,N,K))
+    sys.exit(1)
+if arrays['connectivity'].min() < 0 or arrays['connectivity'].max() >= N:
+    print('ERROR: connectivity in %s has invalid node indices' % args.vtufile)
+    sys.exit(1)
+print('%s: N=%d nodes, K=%d triangles' % (args.vtufile,N,K))
+if 'u' in arrays and 'u_exact' in arrays:
+    err = np.abs(arrays['u'] - arrays['u_exact']).max()
+    print('|u-u_ex|_inf = %.2e' % err)
@@ -14,9 +14,14 @@ static char help[] =
 "  straight   Figure 6.2, page 303, in Hundsdorfer & Verwer (2003) [default]\n"
 "  rotation   Figure 20.5, page 461, in LeVeque (2002).\n"
 "For straight, if final time is an integer and velocities are kept at default\n"
-"values, then exact solution is known and L1,L2 errors are reported.\n\n";
+"values, then exact solution is known and L1,L2 errors are reported.\n"
+"Option -adv_dumpto writes initial and final states; for frames every N\n"
+"steps, written in the background, see -adv_snapshot in snapshot.h.\n\n";
 
 #include <petsc.h>
+#include "../interlude/stencilcsr.h"
+#include "../interlude/checkpoint.h"
+#include "../interlude/snapshot.h"
 
 //STARTCTX
 typedef enum {STRAIGHT, ROTATION} ProblemType;
@@ -229,6 +234,8 @@ int main(int argc,char **argv) {
     ierr = DMCreateGlobalVector(da,&u); CHKERRQ(ierr);
     ierr = FormInitial(&info,u,&user); CHKERRQ(ierr);
     ierr = DumpBinary(fileroot,"_initial",u); CHKERRQ(ierr);
+    ierr = TSCheckpointSetUp(ts,u,"adv_"); CHKERRQ(ierr);
+    ierr = TSSnapshotSetUp(ts,u,"adv_"); CHKERRQ(ierr);
     ierr = TSGetTime(ts,&t0); CHKERRQ(ierr);
     ierr = TSGetTimeStep(ts,&dt); CHKERRQ(ierr);
 
@@ -400,8 +407,10 @@ PetscErrorCode FormRHSJacobianLocal(DMDALocalInfo *info, PetscReal t,
     PetscInt        i, j, l, nc;
     PetscReal       hx, hy, halfx, halfy, x, y, a, v[9];
     MatStencil      col[9],row;
+    StencilCSR      *csr;
 
     ierr = MatZeroEntries(P); CHKERRQ(ierr);
+    ierr = StencilCSRBegin(info->da,P,&csr); CHKERRQ(ierr);
     hx = 2.0 / info->mx;  hy = 2.0 / info->my;
     halfx = hx / 2.0;     halfy = hy / 2.0;
     for (j = info->ys; j < info->ys+info->ym; j++) {
@@ -463,9 +472,10 @@ PetscErrorCode FormRHSJacobianLocal(DMDALocalInfo *info, PetscReal t,
                     SETERRQ(PETSC_COMM_SELF,1,"only Jacobian cases none|centered are implemented\n");
                 }
             }
-            ierr = MatSetValuesStencil(P,1,&row,nc,col,v,ADD_VALUES); CHKERRQ(ierr);
+            ierr = StencilCSRSetValues(csr,&row,nc,col,v,ADD_VALUES); CHKERRQ(ierr);
         }
     }
+    ierr = StencilCSREnd(csr); CHKERRQ(ierr);
     ierr = MatAssemblyBegin(P,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     ierr = MatAssemblyEnd(P,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     if (J != P) {
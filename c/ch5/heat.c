@@ -5,9 +5,17 @@ static char help[] =
 "Energy is conserved (for these particular conditions/source) and an extra\n"
 "'monitor' is demonstrated.  Discretization is by centered finite differences.\n"
 "Converts the PDE into a system  X_t = G(t,X) (PETSc type 'nonlinear') by\n"
-"method of lines.  Uses backward Euler time-stepping by default.\n";
+"method of lines.  Uses backward Euler time-stepping by default.  With\n"
+"-ht_constant_jacobian the Laplacian is assembled once, the problem is\n"
+"solved as linear, and the preconditioners for  shift I - J  are cached by\n"
+"shift; set their type by prefix -ht_shift_, e.g. -ht_shift_pc_type ilu.\n"
+"Checkpoint/restart by -ht_checkpoint, -ht_restart; see checkpoint.h.\n"
+"Background movie frames by -ht_snapshot; see snapshot.h.\n";
 
 #include <petsc.h>
+#include "../interlude/stencilcsr.h"
+#include "../interlude/checkpoint.h"
+#include "../interlude/snapshot.h"
 
 typedef struct {
   PetscReal D0;    // conductivity
@@ -29,6 +37,27 @@ extern PetscErrorCode FormRHSFunctionLocal(DMDALocalInfo*, PetscReal, PetscReal*
 extern PetscErrorCode FormRHSJacobianLocal(DMDALocalInfo*, PetscReal, PetscReal**,
                                            Mat, Mat, HeatCtx*);
 
+// for -ht_constant_jacobian; see CachedIJacobian()
+#define MAXSHIFTCACHE 16
+typedef struct {
+  Mat        J;          // RHS Jacobian, assembled once
+  PetscInt   size,       // capacity in use, at most MAXSHIFTCACHE
+             n,          // number of cached shifts
+             next,       // entry to replace when full
+             cur,        // entry for the current step
+             hits, misses;
+  PetscReal  shift[MAXSHIFTCACHE];
+  Mat        A[MAXSHIFTCACHE];    // shift I - J
+  PC         pc[MAXSHIFTCACHE];   // set up on A[k]
+} ShiftCache;
+
+extern PetscErrorCode FormIFunctionLocal(DMDALocalInfo*, PetscReal, PetscReal**,
+                                         PetscReal**, PetscReal**, HeatCtx*);
+extern PetscErrorCode CachedIJacobian(TS, PetscReal, Vec, Vec, PetscReal,
+                                      Mat, Mat, void*);
+extern PetscErrorCode ShiftCacheMult(Mat, Vec, Vec);
+extern PetscErrorCode ShiftCacheApply(PC, Vec, Vec);
+
 int main(int argc,char **argv) {
   PetscErrorCode ierr;
   HeatCtx        user;
@@ -37,17 +66,35 @@ int main(int argc,char **argv) {
   DM             da;
   DMDALocalInfo  info;
   PetscReal      t0, tf;
-  PetscBool      monitorenergy = PETSC_FALSE;
+  PetscBool      monitorenergy = PETSC_FALSE,
+                 constantjac = PETSC_FALSE;
+  ShiftCache     cache;
+  Mat            A;
+  SNES           snes;
+  KSP            ksp;
+  PC             pc;
+  PetscInt       k;
 
   ierr = PetscInitialize(&argc,&argv,NULL,help); if (ierr) return ierr;
 
   user.D0  = 1.0;
+  cache.size = 4;
   ierr = PetscOptionsBegin(PETSC_COMM_WORLD, "ht_", "options for heat", ""); CHKERRQ(ierr);
   ierr = PetscOptionsReal("-D0","constant thermal diffusivity",
            "heat.c",user.D0,&user.D0,NULL);CHKERRQ(ierr);
+  ierr = PetscOptionsBool("-constant_jacobian",
+           "assemble Jacobian once and cache preconditioners by shift",
+           "heat.c",constantjac,&constantjac,NULL);CHKERRQ(ierr);
   ierr = PetscOptionsBool("-monitor","also display total heat energy at each step",
            "heat.c",monitorenergy,&monitorenergy,NULL);CHKERRQ(ierr);
+  ierr = PetscOptionsInt("-shift_cache_size",
+           "with -ht_constant_jacobian, number of cached preconditioners",
+           "heat.c",cache.size,&cache.size,NULL);CHKERRQ(ierr);
   ierr = PetscOptionsEnd(); CHKERRQ(ierr);
+  if (cache.size < 1 || cache.size > MAXSHIFTCACHE) {
+      SETERRQ1(PETSC_COMM_SELF,1,"-ht_shift_cache_size must be in 1,...,%d\n",
+               MAXSHIFTCACHE);
+  }
 
 //STARTDMDASETUP
   ierr = DMDACreate2d(PETSC_COMM_WORLD,
@@ -62,13 +109,31 @@ int main(int argc,char **argv) {
 
 //STARTTSSETUP
   ierr = TSCreate(PETSC_COMM_WORLD,&ts); CHKERRQ(ierr);
-  ierr = TSSetProblemType(ts,TS_NONLINEAR); CHKERRQ(ierr);
+  ierr = TSSetProblemType(ts,constantjac ? TS_LINEAR : TS_NONLINEAR); CHKERRQ(ierr);
   ierr = TSSetDM(ts,da); CHKERRQ(ierr);
   ierr = TSSetApplicationContext(ts,&user); CHKERRQ(ierr);
-  ierr = DMDATSSetRHSFunctionLocal(da,INSERT_VALUES,
-           (DMDATSRHSFunctionLocal)FormRHSFunctionLocal,&user); CHKERRQ(ierr);
-  ierr = DMDATSSetRHSJacobianLocal(da,
-           (DMDATSRHSJacobianLocal)FormRHSJacobianLocal,&user); CHKERRQ(ierr);
+  if (constantjac) {
+      // F(t,u,u_t) = u_t - G(t,u) so that IJacobian() sees the shift
+      ierr = DMDATSSetIFunctionLocal(da,INSERT_VALUES,
+               (DMDATSIFunctionLocal)FormIFunctionLocal,&user); CHKERRQ(ierr);
+      ierr = DMCreateMatrix(da,&(cache.J)); CHKERRQ(ierr);
+      ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+      ierr = FormRHSJacobianLocal(&info,0.0,NULL,cache.J,cache.J,&user); CHKERRQ(ierr);
+      cache.n = 0;
+      cache.next = 0;
+      cache.cur = -1;
+      cache.hits = 0;
+      cache.misses = 0;
+      ierr = MatCreateShell(PETSC_COMM_WORLD,info.xm*info.ym,info.xm*info.ym,
+                            info.mx*info.my,info.mx*info.my,&cache,&A); CHKERRQ(ierr);
+      ierr = MatShellSetOperation(A,MATOP_MULT,(void(*)(void))ShiftCacheMult); CHKERRQ(ierr);
+      ierr = TSSetIJacobian(ts,A,A,CachedIJacobian,&cache); CHKERRQ(ierr);
+  } else {
+      ierr = DMDATSSetRHSFunctionLocal(da,INSERT_VALUES,
+               (DMDATSRHSFunctionLocal)FormRHSFunctionLocal,&user); CHKERRQ(ierr);
+      ierr = DMDATSSetRHSJacobianLocal(da,
+               (DMDATSRHSJacobianLocal)FormRHSJacobianLocal,&user); CHKERRQ(ierr);
+  }
   if (monitorenergy) {
       ierr = TSMonitorSet(ts,EnergyMonitor,&user,NULL); CHKERRQ(ierr);
   }
@@ -79,6 +144,16 @@ int main(int argc,char **argv) {
   ierr = TSSetExactFinalTime(ts,TS_EXACTFINALTIME_MATCHSTEP); CHKERRQ(ierr);
   ierr = TSSetFromOptions(ts);CHKERRQ(ierr);
 //ENDTSSETUP
+  if (constantjac) {
+      // the outer PC only forwards to the cached PC for the current shift
+      ierr = TSGetSNES(ts,&snes); CHKERRQ(ierr);
+      ierr = SNESGetKSP(snes,&ksp); CHKERRQ(ierr);
+      ierr = KSPGetPC(ksp,&pc); CHKERRQ(ierr);
+      ierr = PCSetType(pc,PCSHELL); CHKERRQ(ierr);
+      ierr = PCShellSetContext(pc,&cache); CHKERRQ(ierr);
+      ierr = PCShellSetApply(pc,ShiftCacheApply); CHKERRQ(ierr);
+      ierr = PCShellSetName(pc,"preconditioner cached by shift"); CHKERRQ(ierr);
+  }
 
   // report on set up
   ierr = TSGetTime(ts,&t0); CHKERRQ(ierr);
@@ -90,8 +165,19 @@ int main(int argc,char **argv) {
 
   // solve
   ierr = VecSet(u,0.0); CHKERRQ(ierr);   // initial condition
+  ierr = TSCheckpointSetUp(ts,u,"ht_"); CHKERRQ(ierr);
+  ierr = TSSnapshotSetUp(ts,u,"ht_"); CHKERRQ(ierr);
   ierr = TSSolve(ts,u); CHKERRQ(ierr);
 
+  if (constantjac) {
+      ierr = PetscPrintf(PETSC_COMM_WORLD,
+               "shift cache: %d preconditioner setups, %d reuses\n",
+               cache.misses,cache.hits); CHKERRQ(ierr);
+      for (k = 0; k < cache.n; k++) {
+          MatDestroy(&(cache.A[k]));  PCDestroy(&(cache.pc[k]));
+      }
+      MatDestroy(&(cache.J));  MatDestroy(&A);
+  }
   VecDestroy(&u);  TSDestroy(&ts);  DMDestroy(&da);
   return PetscFinalize();
 }
@@ -172,9 +258,11 @@ PetscErrorCode FormRHSJacobianLocal(DMDALocalInfo *info,
     const PetscReal  D = user->D0;
     PetscReal        hx, hy, hx2, hy2, v[5];
     MatStencil       col[5],row;
+    StencilCSR       *csr;
 
     ierr = Spacings(info,&hx,&hy); CHKERRQ(ierr);
     hx2 = hx * hx;  hy2 = hy * hy;
+    ierr = StencilCSRBegin(info->da,P,&csr); CHKERRQ(ierr);
     for (j = info->ys; j < info->ys+info->ym; j++) {
         row.j = j;  col[0].j = j;
         for (i = info->xs; i < info->xs+info->xm; i++) {
@@ -195,10 +283,11 @@ PetscErrorCode FormRHSJacobianLocal(DMDALocalInfo *info,
                 ncols = 4;
                 col[3].j = j;  col[3].i = i-1;  v[3] = 2.0 * D / hx2;
             }
-            ierr = MatSetValuesStencil(P,1,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
+            ierr = StencilCSRSetValues(csr,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
         }
     }
 
+    ierr = StencilCSREnd(csr); CHKERRQ(ierr);
     ierr = MatAssemblyBegin(P,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     ierr = MatAssemblyEnd(P,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     if (J != P) {
@@ -209,3 +298,88 @@ PetscErrorCode FormRHSJacobianLocal(DMDALocalInfo *info,
 }
 //ENDRHSJACOBIAN
 
+
+PetscErrorCode FormIFunctionLocal(DMDALocalInfo *info, PetscReal t,
+                                  PetscReal **au, PetscReal **audot,
+                                  PetscReal **aF, HeatCtx *user) {
+  PetscErrorCode ierr;
+  PetscInt   i, j;
+
+  ierr = FormRHSFunctionLocal(info,t,au,aF,user); CHKERRQ(ierr);
+  for (j = info->ys; j < info->ys + info->ym; j++) {
+      for (i = info->xs; i < info->xs + info->xm; i++) {
+          aF[j][i] = audot[j][i] - aF[j][i];
+      }
+  }
+  return 0;
+}
+
+/* With -ht_constant_jacobian the Jacobian  shift I - J  of the IFunction
+depends only on the shift, which is a function of dt (and of the order,
+for BDF).  On a new shift the matrix is formed from the stored J and a PC,
+of the type given by options with prefix -ht_shift_, is set up for it.  A
+repeated shift just selects the cached pair, so no assembly or
+factorization is done.  When the cache is full the oldest entry is
+replaced.  The operators given to TS are a MATSHELL and a PCSHELL which
+forward to the current entry.                                            */
+PetscErrorCode CachedIJacobian(TS ts, PetscReal t, Vec u, Vec udot,
+                               PetscReal shift, Mat A, Mat P, void *ctx) {
+  PetscErrorCode ierr;
+  ShiftCache     *cache = (ShiftCache*)ctx;
+  DM             da;
+  PetscInt       k;
+
+  for (k = 0; k < cache->n; k++) {
+      if (PetscAbsReal(shift - cache->shift[k]) <= 1.0e-12 * PetscAbsReal(shift))
+          break;
+  }
+  if (k < cache->n) {
+      cache->hits++;
+  } else {
+      if (cache->n < cache->size) {
+          k = cache->n++;
+      } else {
+          k = cache->next;
+          cache->next = (cache->next + 1) % cache->size;
+          ierr = MatDestroy(&(cache->A[k])); CHKERRQ(ierr);
+          ierr = PCDestroy(&(cache->pc[k])); CHKERRQ(ierr);
+      }
+      cache->shift[k] = shift;
+      ierr = MatDuplicate(cache->J,MAT_COPY_VALUES,&(cache->A[k])); CHKERRQ(ierr);
+      ierr = MatScale(cache->A[k],-1.0); CHKERRQ(ierr);
+      ierr = MatShift(cache->A[k],shift); CHKERRQ(ierr);
+      ierr = TSGetDM(ts,&da); CHKERRQ(ierr);
+      ierr = PCCreate(PetscObjectComm((PetscObject)ts),&(cache->pc[k])); CHKERRQ(ierr);
+      ierr = PCSetOptionsPrefix(cache->pc[k],"ht_shift_"); CHKERRQ(ierr);
+      ierr = PCSetDM(cache->pc[k],da); CHKERRQ(ierr);
+      ierr = PCSetOperators(cache->pc[k],cache->A[k],cache->A[k]); CHKERRQ(ierr);
+      ierr = PCSetFromOptions(cache->pc[k]); CHKERRQ(ierr);
+      ierr = PCSetUp(cache->pc[k]); CHKERRQ(ierr);
+      cache->misses++;
+  }
+  cache->cur = k;
+  // the shells have changed, so KSP will call the (trivial) PCSHELL setup
+  ierr = MatAssemblyBegin(P,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+  ierr = MatAssemblyEnd(P,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+  if (A != P) {
+      ierr = MatAssemblyBegin(A,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+      ierr = MatAssemblyEnd(A,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+  }
+  return 0;
+}
+
+PetscErrorCode ShiftCacheMult(Mat A, Vec x, Vec y) {
+  PetscErrorCode ierr;
+  ShiftCache     *cache;
+  ierr = MatShellGetContext(A,&cache); CHKERRQ(ierr);
+  ierr = MatMult(cache->A[cache->cur],x,y); CHKERRQ(ierr);
+  return 0;
+}
+
+PetscErrorCode ShiftCacheApply(PC pc, Vec x, Vec y) {
+  PetscErrorCode ierr;
+  ShiftCache     *cache;
+  ierr = PCShellGetContext(pc,(void**)&cache); CHKERRQ(ierr);
+  ierr = PCApply(cache->pc[cache->cur],x,y); CHKERRQ(ierr);
+  return 0;
+}
@@ -2,9 +2,18 @@ static char help[] =
 "Coupled reaction-diffusion equations (Pearson 1993).  Option prefix -ptn_.\n"
 "Demonstrates form  F(t,Y,dot Y) = G(t,Y)  where F() is IFunction and G() is\n"
 "RHSFunction().  Implements IJacobian() and RHSJacobian().  Defaults to\n"
-"ARKIMEX (= adaptive Runge-Kutta implicit-explicit) TS type.\n\n";
+"ARKIMEX (= adaptive Runge-Kutta implicit-explicit) TS type.  Option\n"
+"-ptn_soa evaluates IFunction() and RHSFunction() on structure-of-arrays\n"
+"copies of the local arrays, so that the loops are unit-stride.  Option\n"
+"-ptn_strang replaces the TS solver by Strang splitting, with pointwise RK4\n"
+"for the reactions and separate scalar implicit solves for the diffusions;\n"
+"TS still supplies -ts_dt, -ts_max_time, -ts_max_steps and the monitors.\n"
+"Checkpoint/restart by -ptn_checkpoint, -ptn_restart; see checkpoint.h.\n"
+"Background movie frames by -ptn_snapshot; see snapshot.h.\n\n";
 
 #include <petsc.h>
+#include "../interlude/checkpoint.h"
+#include "../interlude/snapshot.h"
 
 typedef struct {
   PetscReal u, v;
@@ -17,6 +26,7 @@ typedef struct {
              phi,   // "dimensionless feed rate" (F in Pearson 1993)
              kappa; // "dimensionless rate constant" (k in Pearson 1993)
   PetscBool  IFcn_called, IJac_called, RHSFcn_called, RHSJac_called;
+  PetscReal  *soa;  // row buffers for -ptn_soa; see FormIFunctionSoA()
 } PatternCtx;
 
 extern PetscErrorCode InitialState(DM, Vec, PetscReal, PatternCtx*);
@@ -28,6 +38,23 @@ extern PetscErrorCode FormIFunctionLocal(DMDALocalInfo*, PetscReal, Field**, Fie
                                          Field **, PatternCtx*);
 extern PetscErrorCode FormIJacobianLocal(DMDALocalInfo*, PetscReal, Field**, Field**,
                                          PetscReal, Mat, Mat, PatternCtx*);
+extern PetscErrorCode FormRHSFunctionSoA(TS, PetscReal, Vec, Vec, void*);
+extern PetscErrorCode FormIFunctionSoA(TS, PetscReal, Vec, Vec, Vec, void*);
+
+// for -ptn_strang; see StrangSolve()
+typedef struct {
+  DM         da1;     // scalar DMDA with the same layout as the DMDA
+  Mat        L,       // 9-point Laplacian on da1
+             A[2];    // I - theta dt D L for u, v
+  KSP        ksp[2];  // diffusion solvers for u, v; prefixes ptn_diff_u_, ptn_diff_v_
+  Vec        w, b;    // one component; right-hand side
+  PetscReal  dt,      // step for which A[] is built
+             theta,   // 1/2 = Crank-Nicolson, 1 = backward Euler
+             reactdt; // maximum RK4 step for the reactions
+} StrangCtx;
+
+extern PetscErrorCode StrangSolve(TS, Vec, StrangCtx*, PatternCtx*);
+extern PetscErrorCode StrangDestroy(StrangCtx*);
 
 int main(int argc,char **argv)
 {
@@ -40,7 +67,10 @@ int main(int argc,char **argv)
   PetscReal      noiselevel = -1.0;  // negative value means no initial noise
   PetscBool      no_rhsjacobian = PETSC_FALSE,
                  no_ijacobian = PETSC_FALSE,
-                 call_back_report = PETSC_FALSE;
+                 call_back_report = PETSC_FALSE,
+                 soa = PETSC_FALSE,
+                 strang = PETSC_FALSE;
+  StrangCtx      sctx;
   TSType         type;
 
   ierr = PetscInitialize(&argc,&argv,NULL,help); if (ierr) return ierr;
@@ -55,6 +85,9 @@ int main(int argc,char **argv)
   user.IJac_called   = PETSC_FALSE;
   user.RHSFcn_called = PETSC_FALSE;
   user.RHSJac_called = PETSC_FALSE;
+  user.soa = NULL;
+  sctx.theta = 0.5;
+  sctx.reactdt = 0.5;
   ierr = PetscOptionsBegin(PETSC_COMM_WORLD, "ptn_", "options for patterns", ""); CHKERRQ(ierr);
   ierr = PetscOptionsBool("-call_back_report","report on which user-supplied call-backs were actually called",
            "pattern.c",call_back_report,&(call_back_report),NULL);CHKERRQ(ierr);
@@ -75,6 +108,15 @@ int main(int argc,char **argv)
            "pattern.c",noiselevel,&noiselevel,NULL);CHKERRQ(ierr);
   ierr = PetscOptionsReal("-phi","dimensionless feed rate (=F in (Pearson, 1993))",
            "pattern.c",user.phi,&user.phi,NULL);CHKERRQ(ierr);
+  ierr = PetscOptionsBool("-soa","evaluate residuals on structure-of-arrays copies of u,v",
+           "pattern.c",soa,&soa,NULL);CHKERRQ(ierr);
+  ierr = PetscOptionsBool("-strang","time-step by Strang splitting of reaction and diffusion",
+           "pattern.c",strang,&strang,NULL);CHKERRQ(ierr);
+  ierr = PetscOptionsReal("-strang_react_dt","with -ptn_strang, maximum RK4 step for reactions",
+           "pattern.c",sctx.reactdt,&sctx.reactdt,NULL);CHKERRQ(ierr);
+  ierr = PetscOptionsReal("-strang_theta",
+           "with -ptn_strang, diffusion theta-method parameter (1/2 = Crank-Nicolson)",
+           "pattern.c",sctx.theta,&sctx.theta,NULL);CHKERRQ(ierr);
   ierr = PetscOptionsEnd(); CHKERRQ(ierr);
 
   ierr = DMDACreate2d(PETSC_COMM_WORLD,
@@ -101,14 +143,25 @@ int main(int argc,char **argv)
   ierr = TSSetProblemType(ts,TS_NONLINEAR); CHKERRQ(ierr);
   ierr = TSSetDM(ts,da); CHKERRQ(ierr);
   ierr = TSSetApplicationContext(ts,&user); CHKERRQ(ierr);
-  ierr = DMDATSSetRHSFunctionLocal(da,INSERT_VALUES,
-           (DMDATSRHSFunctionLocal)FormRHSFunctionLocal,&user); CHKERRQ(ierr);
+  if (soa) {
+      // u and v buffers for three rows of the ghosted local array, plus
+      // the u and v Laplacians of one row
+      ierr = PetscMalloc1(8*info.gxm,&(user.soa)); CHKERRQ(ierr);
+      ierr = TSSetRHSFunction(ts,NULL,FormRHSFunctionSoA,&user); CHKERRQ(ierr);
+  } else {
+      ierr = DMDATSSetRHSFunctionLocal(da,INSERT_VALUES,
+               (DMDATSRHSFunctionLocal)FormRHSFunctionLocal,&user); CHKERRQ(ierr);
+  }
   if (!no_rhsjacobian) {
       ierr = DMDATSSetRHSJacobianLocal(da,
                (DMDATSRHSJacobianLocal)FormRHSJacobianLocal,&user); CHKERRQ(ierr);
   }
-  ierr = DMDATSSetIFunctionLocal(da,INSERT_VALUES,
-           (DMDATSIFunctionLocal)FormIFunctionLocal,&user); CHKERRQ(ierr);
+  if (soa) {
+      ierr = TSSetIFunction(ts,NULL,FormIFunctionSoA,&user); CHKERRQ(ierr);
+  } else {
+      ierr = DMDATSSetIFunctionLocal(da,INSERT_VALUES,
+               (DMDATSIFunctionLocal)FormIFunctionLocal,&user); CHKERRQ(ierr);
+  }
   if (!no_ijacobian) {
       ierr = DMDATSSetIJacobianLocal(da,
                (DMDATSIJacobianLocal)FormIJacobianLocal,&user); CHKERRQ(ierr);
@@ -123,7 +176,13 @@ int main(int argc,char **argv)
 
   ierr = DMCreateGlobalVector(da,&x); CHKERRQ(ierr);
   ierr = InitialState(da,x,noiselevel,&user); CHKERRQ(ierr);
-  ierr = TSSolve(ts,x); CHKERRQ(ierr);
+  ierr = TSCheckpointSetUp(ts,x,"ptn_"); CHKERRQ(ierr);
+  ierr = TSSnapshotSetUp(ts,x,"ptn_"); CHKERRQ(ierr);
+  if (strang) {
+      ierr = StrangSolve(ts,x,&sctx,&user); CHKERRQ(ierr);
+  } else {
+      ierr = TSSolve(ts,x); CHKERRQ(ierr);
+  }
 
   // optionally report on call-backs
   if (call_back_report) {
@@ -135,6 +194,10 @@ int main(int argc,char **argv)
                                           (int)user.RHSFcn_called,(int)user.RHSJac_called); CHKERRQ(ierr);
   }
 
+  if (strang) {
+      ierr = StrangDestroy(&sctx); CHKERRQ(ierr);
+  }
+  PetscFree(user.soa);
   VecDestroy(&x);  TSDestroy(&ts);  DMDestroy(&da);
   return PetscFinalize();
 }
@@ -319,3 +382,316 @@ PetscErrorCode FormIJacobianLocal(DMDALocalInfo *info,
 }
 //ENDIJACOBIAN
 
+
+/* With -ptn_soa these replace FormRHSFunctionLocal() and FormIFunctionLocal().
+Rows of the interleaved (Field) local array are copied into separate u and v
+row buffers, each unit-stride in x, and the kernels run along those buffers,
+where they vectorize.  Results are interleaved again only when written.  The
+copy is done one row at a time, just ahead of its use, so the buffers stay
+in cache and the array is still read from memory only once.  For the
+9-point stencil three rows are kept, in rotation.  The buffers are stored in
+user->soa, which is allocated in main() with 8 rows of the ghosted width.  */
+
+// copy n interleaved (u,v) pairs into rows pu, pv
+static void SoAGather(PetscInt n, const PetscReal *aos,
+                      PetscReal *pu, PetscReal *pv) {
+  PetscInt k;
+  PetscPragmaSIMD
+  for (k = 0; k < n; k++) {
+      pu[k] = aos[2*k];
+      pv[k] = aos[2*k+1];
+  }
+}
+
+PetscErrorCode FormRHSFunctionSoA(TS ts, PetscReal t, Vec Y, Vec G,
+                                  void *ctx) {
+  PetscErrorCode   ierr;
+  PatternCtx       *user = (PatternCtx*)ctx;
+  DM               da;
+  DMDALocalInfo    info;
+  const PetscReal  phi = user->phi, phikappa = user->phi + user->kappa;
+  const PetscReal  *ay;
+  PetscReal        *ag, *pu, *pv, uv2;
+  PetscInt         i, j, k;
+
+  user->RHSFcn_called = PETSC_TRUE;
+  ierr = TSGetDM(ts,&da); CHKERRQ(ierr);
+  ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+  pu = user->soa;
+  pv = user->soa + info.gxm;
+  ierr = VecGetArrayRead(Y,&ay); CHKERRQ(ierr);
+  ierr = VecGetArray(G,&ag); CHKERRQ(ierr);
+  for (j = 0; j < info.ym; j++) {
+      k = 2 * j * info.xm;
+      SoAGather(info.xm,ay+k,pu,pv);
+      PetscPragmaSIMD
+      for (i = 0; i < info.xm; i++) {
+          uv2 = pu[i] * pv[i] * pv[i];
+          ag[k+2*i]   = - uv2 + phi * (1.0 - pu[i]);
+          ag[k+2*i+1] = + uv2 - phikappa * pv[i];
+      }
+  }
+  ierr = VecRestoreArray(G,&ag); CHKERRQ(ierr);
+  ierr = VecRestoreArrayRead(Y,&ay); CHKERRQ(ierr);
+  ierr = PetscLogFlops(9.0*info.xm*info.ym); CHKERRQ(ierr);
+  return 0;
+}
+
+PetscErrorCode FormIFunctionSoA(TS ts, PetscReal t, Vec Y, Vec Ydot, Vec F,
+                                void *ctx) {
+  PetscErrorCode   ierr;
+  PatternCtx       *user = (PatternCtx*)ctx;
+  DM               da;
+  DMDALocalInfo    info;
+  Vec              Yloc;
+  const PetscReal  *ay, *aydot;
+  PetscReal        *af, *pu[3], *pv[3], *lapu, *lapv, *tmp, Cu, Cv, h;
+  const PetscReal  *un, *u0, *us, *vn, *v0, *vs;
+  PetscInt         i, j, k, r, ioff;
+
+  user->IFcn_called = PETSC_TRUE;
+  ierr = TSGetDM(ts,&da); CHKERRQ(ierr);
+  ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+  h = user->L / (PetscReal)(info.mx);
+  Cu = user->Du / (6.0 * h * h);
+  Cv = user->Dv / (6.0 * h * h);
+  for (r = 0; r < 3; r++) {
+      pu[r] = user->soa + 2 * r * info.gxm;
+      pv[r] = pu[r] + info.gxm;
+  }
+  lapu = user->soa + 6 * info.gxm;
+  lapv = lapu + info.gxm;
+  ioff = info.xs - info.gxs;  // so that index ioff is i = info.xs
+
+  ierr = DMGetLocalVector(da,&Yloc); CHKERRQ(ierr);
+  ierr = DMGlobalToLocalBegin(da,Y,INSERT_VALUES,Yloc); CHKERRQ(ierr);
+  ierr = DMGlobalToLocalEnd(da,Y,INSERT_VALUES,Yloc); CHKERRQ(ierr);
+  ierr = VecGetArrayRead(Yloc,&ay); CHKERRQ(ierr);
+  ierr = VecGetArrayRead(Ydot,&aydot); CHKERRQ(ierr);
+  ierr = VecGetArray(F,&af); CHKERRQ(ierr);
+  // rows j-1 and j of the ghosted array, for the first j = info.ys
+  k = info.ys - info.gys;
+  SoAGather(info.gxm,ay+2*(k-1)*info.gxm,pu[0],pv[0]);
+  SoAGather(info.gxm,ay+2*k*info.gxm,pu[1],pv[1]);
+  for (j = info.ys; j < info.ys + info.ym; j++) {
+      k = j + 1 - info.gys;
+      SoAGather(info.gxm,ay+2*k*info.gxm,pu[2],pv[2]);
+      us = pu[0] + ioff;  u0 = pu[1] + ioff;  un = pu[2] + ioff;
+      vs = pv[0] + ioff;  v0 = pv[1] + ioff;  vn = pv[2] + ioff;
+      PetscPragmaSIMD
+      for (i = 0; i < info.xm; i++) {
+          lapu[i] =     un[i-1] + 4.0*un[i] +   un[i+1]
+                    + 4.0*u0[i-1] - 20.0*u0[i] + 4.0*u0[i+1]
+                    +   us[i-1] + 4.0*us[i] +   us[i+1];
+          lapv[i] =     vn[i-1] + 4.0*vn[i] +   vn[i+1]
+                    + 4.0*v0[i-1] - 20.0*v0[i] + 4.0*v0[i+1]
+                    +   vs[i-1] + 4.0*vs[i] +   vs[i+1];
+      }
+      k = 2 * (j - info.ys) * info.xm;
+      PetscPragmaSIMD
+      for (i = 0; i < info.xm; i++) {
+          af[k+2*i]   = aydot[k+2*i]   - Cu * lapu[i];
+          af[k+2*i+1] = aydot[k+2*i+1] - Cv * lapv[i];
+      }
+      // rotate:  rows j, j+1 become rows j-1, j
+      tmp = pu[0];  pu[0] = pu[1];  pu[1] = pu[2];  pu[2] = tmp;
+      tmp = pv[0];  pv[0] = pv[1];  pv[1] = pv[2];  pv[2] = tmp;
+  }
+  ierr = VecRestoreArray(F,&af); CHKERRQ(ierr);
+  ierr = VecRestoreArrayRead(Ydot,&aydot); CHKERRQ(ierr);
+  ierr = VecRestoreArrayRead(Yloc,&ay); CHKERRQ(ierr);
+  ierr = DMRestoreLocalVector(da,&Yloc); CHKERRQ(ierr);
+  ierr = PetscLogFlops(30.0*info.xm*info.ym); CHKERRQ(ierr);
+  return 0;
+}
+
+/* With -ptn_strang each step of length dt is
+    R(dt/2)  D(dt)  R(dt/2)
+where R integrates the reactions, i.e. the ODEs  Y_t = G(Y)  from
+FormRHSFunctionLocal(), independently at each grid point, and D integrates
+the uncoupled diffusions  u_t = D_u Laplacian u,  v_t = D_v Laplacian v.
+R is classical RK4 with substeps of at most -ptn_strang_react_dt, done in
+a loop over points which vectorizes and needs no communication.  D is the
+theta-method, with the same 9-point Laplacian as FormIFunctionLocal(), so
+each component needs one solve with  I - theta dt D L  on a scalar DMDA.
+These matrices, and their KSPs (default CG + Galerkin multigrid, option
+prefixes -ptn_diff_u_, -ptn_diff_v_), are built once and reused while dt is unchanged.
+Monitors set by -ts_monitor* are called after each step.                */
+
+static void ReactionRHS(PetscReal phi, PetscReal kappa,
+                        PetscReal u, PetscReal v, PetscReal *gu, PetscReal *gv) {
+  const PetscReal uv2 = u * v * v;
+  *gu = - uv2 + phi * (1.0 - u);
+  *gv = + uv2 - (phi + kappa) * v;
+}
+
+// R(tau) on n interleaved (u,v) pairs
+static PetscErrorCode ReactionStep(PetscInt n, PetscReal *y, PetscReal tau,
+                                   PetscReal reactdt, PatternCtx *user) {
+  PetscErrorCode   ierr;
+  const PetscInt   nsub = (PetscInt)PetscCeilReal(tau / reactdt);
+  const PetscReal  s = tau / nsub, phi = user->phi, kappa = user->kappa;
+  PetscInt         k;
+
+  PetscPragmaSIMD
+  for (k = 0; k < n; k++) {
+      PetscInt   l;
+      PetscReal  u = y[2*k], v = y[2*k+1], ku[4], kv[4];
+      for (l = 0; l < nsub; l++) {
+          ReactionRHS(phi,kappa,u,v,&ku[0],&kv[0]);
+          ReactionRHS(phi,kappa,u+0.5*s*ku[0],v+0.5*s*kv[0],&ku[1],&kv[1]);
+          ReactionRHS(phi,kappa,u+0.5*s*ku[1],v+0.5*s*kv[1],&ku[2],&kv[2]);
+          ReactionRHS(phi,kappa,u+s*ku[2],v+s*kv[2],&ku[3],&kv[3]);
+          u += (s / 6.0) * (ku[0] + 2.0 * ku[1] + 2.0 * ku[2] + ku[3]);
+          v += (s / 6.0) * (kv[0] + 2.0 * kv[1] + 2.0 * kv[2] + kv[3]);
+      }
+      y[2*k] = u;
+      y[2*k+1] = v;
+  }
+  ierr = PetscLogFlops(56.0*nsub*n); CHKERRQ(ierr);
+  return 0;
+}
+
+// the 9-point Laplacian of FormIFunctionLocal(), on the scalar DMDA
+static PetscErrorCode AssembleLaplacian(DM da1, PetscReal L, Mat A) {
+  PetscErrorCode ierr;
+  DMDALocalInfo  info;
+  PetscInt       i, j;
+  PetscReal      h, C, val[9];
+  MatStencil     col[9], row;
+
+  ierr = DMDAGetLocalInfo(da1,&info); CHKERRQ(ierr);
+  h = L / (PetscReal)(info.mx);
+  C = 1.0 / (6.0 * h * h);
+  for (j = info.ys; j < info.ys + info.ym; j++) {
+      row.j = j;
+      for (i = info.xs; i < info.xs + info.xm; i++) {
+          row.i = i;
+          col[0].i = i;   col[0].j = j;    val[0] = - 20.0 * C;
+          col[1].i = i-1; col[1].j = j;    val[1] = 4.0 * C;
+          col[2].i = i+1; col[2].j = j;    val[2] = 4.0 * C;
+          col[3].i = i;   col[3].j = j-1;  val[3] = 4.0 * C;
+          col[4].i = i;   col[4].j = j+1;  val[4] = 4.0 * C;
+          col[5].i = i-1; col[5].j = j-1;  val[5] = C;
+          col[6].i = i-1; col[6].j = j+1;  val[6] = C;
+          col[7].i = i+1; col[7].j = j-1;  val[7] = C;
+          col[8].i = i+1; col[8].j = j+1;  val[8] = C;
+          ierr = MatSetValuesStencil(A,1,&row,9,col,val,INSERT_VALUES); CHKERRQ(ierr);
+      }
+  }
+  ierr = MatAssemblyBegin(A,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+  ierr = MatAssemblyEnd(A,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+  return 0;
+}
+
+static PetscErrorCode StrangSetUp(DM da, StrangCtx *sctx, PatternCtx *user) {
+  PetscErrorCode ierr;
+  PetscInt       mx, my, px, py, m, nlevels, c;
+  const PetscInt *lx, *ly;
+  const char     *prefix[2] = {"ptn_diff_u_", "ptn_diff_v_"};
+  PC             pc;
+
+  ierr = DMDAGetInfo(da,NULL,&mx,&my,NULL,&px,&py,NULL,
+                     NULL,NULL,NULL,NULL,NULL,NULL); CHKERRQ(ierr);
+  ierr = DMDAGetOwnershipRanges(da,&lx,&ly,NULL); CHKERRQ(ierr);
+  ierr = DMDACreate2d(PetscObjectComm((PetscObject)da),
+               DM_BOUNDARY_PERIODIC, DM_BOUNDARY_PERIODIC, DMDA_STENCIL_BOX,
+               mx,my,px,py,1,1,lx,ly,&(sctx->da1)); CHKERRQ(ierr);
+  ierr = DMSetUp(sctx->da1); CHKERRQ(ierr);
+  ierr = DMCreateMatrix(sctx->da1,&(sctx->L)); CHKERRQ(ierr);
+  ierr = AssembleLaplacian(sctx->da1,user->L,sctx->L); CHKERRQ(ierr);
+  ierr = DMCreateGlobalVector(sctx->da1,&(sctx->w)); CHKERRQ(ierr);
+  ierr = VecDuplicate(sctx->w,&(sctx->b)); CHKERRQ(ierr);
+  // periodic grids coarsen by halving
+  nlevels = 1;
+  for (m = mx; m % 2 == 0 && m / 2 >= 3; m /= 2)
+      nlevels++;
+  for (c = 0; c < 2; c++) {
+      ierr = MatDuplicate(sctx->L,MAT_DO_NOT_COPY_VALUES,&(sctx->A[c])); CHKERRQ(ierr);
+      ierr = KSPCreate(PetscObjectComm((PetscObject)da),&(sctx->ksp[c])); CHKERRQ(ierr);
+      ierr = KSPSetOptionsPrefix(sctx->ksp[c],prefix[c]); CHKERRQ(ierr);
+      ierr = KSPSetDM(sctx->ksp[c],sctx->da1); CHKERRQ(ierr);
+      ierr = KSPSetDMActive(sctx->ksp[c],PETSC_FALSE); CHKERRQ(ierr);
+      ierr = KSPSetType(sctx->ksp[c],KSPCG); CHKERRQ(ierr);
+      ierr = KSPSetInitialGuessNonzero(sctx->ksp[c],PETSC_TRUE); CHKERRQ(ierr);
+      ierr = KSPGetPC(sctx->ksp[c],&pc); CHKERRQ(ierr);
+      ierr = PCSetType(pc,PCMG); CHKERRQ(ierr);
+      ierr = PCMGSetLevels(pc,nlevels,NULL); CHKERRQ(ierr);
+      ierr = PCMGSetGalerkin(pc,PC_MG_GALERKIN_BOTH); CHKERRQ(ierr);
+      ierr = KSPSetFromOptions(sctx->ksp[c]); CHKERRQ(ierr);
+  }
+  sctx->dt = -1.0;  // A[] not yet built
+  return 0;
+}
+
+// D(dt) on component c of Y
+static PetscErrorCode DiffusionStep(Vec Y, PetscInt c, PetscReal dt,
+                                    StrangCtx *sctx, PatternCtx *user) {
+  PetscErrorCode   ierr;
+  const PetscReal  D = (c == 0) ? user->Du : user->Dv;
+
+  if (dt != sctx->dt) {
+      // rebuilding the operator makes the next KSPSolve() set up the PC again
+      ierr = MatCopy(sctx->L,sctx->A[c],SAME_NONZERO_PATTERN); CHKERRQ(ierr);
+      ierr = MatScale(sctx->A[c],- sctx->theta * dt * D); CHKERRQ(ierr);
+      ierr = MatShift(sctx->A[c],1.0); CHKERRQ(ierr);
+      ierr = KSPSetOperators(sctx->ksp[c],sctx->A[c],sctx->A[c]); CHKERRQ(ierr);
+  }
+  ierr = VecStrideGather(Y,c,sctx->w,INSERT_VALUES); CHKERRQ(ierr);
+  // b = w + (1-theta) dt D L w
+  ierr = MatMult(sctx->L,sctx->w,sctx->b); CHKERRQ(ierr);
+  ierr = VecAYPX(sctx->b,(1.0 - sctx->theta) * dt * D,sctx->w); CHKERRQ(ierr);
+  ierr = KSPSolve(sctx->ksp[c],sctx->b,sctx->w); CHKERRQ(ierr);
+  ierr = VecStrideScatter(sctx->w,c,Y,INSERT_VALUES); CHKERRQ(ierr);
+  return 0;
+}
+
+PetscErrorCode StrangSolve(TS ts, Vec Y, StrangCtx *sctx, PatternCtx *user) {
+  PetscErrorCode ierr;
+  DM             da;
+  PetscInt       n, step, maxsteps;
+  PetscReal      t = 0.0, tf, dt, h, *ay;
+
+  ierr = TSGetDM(ts,&da); CHKERRQ(ierr);
+  ierr = StrangSetUp(da,sctx,user); CHKERRQ(ierr);
+  ierr = TSGetTime(ts,&t); CHKERRQ(ierr);
+  ierr = TSGetStepNumber(ts,&step); CHKERRQ(ierr);
+  ierr = TSGetMaxTime(ts,&tf); CHKERRQ(ierr);
+  ierr = TSGetMaxSteps(ts,&maxsteps); CHKERRQ(ierr);
+  ierr = TSGetTimeStep(ts,&dt); CHKERRQ(ierr);
+  ierr = VecGetLocalSize(Y,&n); CHKERRQ(ierr);
+  n /= 2;
+  ierr = TSMonitor(ts,step,t,Y); CHKERRQ(ierr);
+  while (t < tf * (1.0 - 1.0e-12) && step < maxsteps) {
+      h = PetscMin(dt,tf - t);
+      ierr = VecGetArray(Y,&ay); CHKERRQ(ierr);
+      ierr = ReactionStep(n,ay,0.5*h,sctx->reactdt,user); CHKERRQ(ierr);
+      ierr = VecRestoreArray(Y,&ay); CHKERRQ(ierr);
+      ierr = DiffusionStep(Y,0,h,sctx,user); CHKERRQ(ierr);
+      ierr = DiffusionStep(Y,1,h,sctx,user); CHKERRQ(ierr);
+      sctx->dt = h;
+      ierr = VecGetArray(Y,&ay); CHKERRQ(ierr);
+      ierr = ReactionStep(n,ay,0.5*h,sctx->reactdt,user); CHKERRQ(ierr);
+      ierr = VecRestoreArray(Y,&ay); CHKERRQ(ierr);
+      t += h;
+      step++;
+      ierr = TSSetTime(ts,t); CHKERRQ(ierr);
+      ierr = TSSetStepNumber(ts,step); CHKERRQ(ierr);
+      ierr = TSMonitor(ts,step,t,Y); CHKERRQ(ierr);
+  }
+  return 0;
+}
+
+PetscErrorCode StrangDestroy(StrangCtx *sctx) {
+  PetscErrorCode ierr;
+  PetscInt c;
+  for (c = 0; c < 2; c++) {
+      ierr = KSPDestroy(&(sctx->ksp[c])); CHKERRQ(ierr);
+      ierr = MatDestroy(&(sctx->A[c])); CHKERRQ(ierr);
+  }
+  ierr = MatDestroy(&(sctx->L)); CHKERRQ(ierr);
+  ierr = VecDestroy(&(sctx->w)); CHKERRQ(ierr);
+  ierr = VecDestroy(&(sctx->b)); CHKERRQ(ierr);
+  ierr = DMDestroy(&(sctx->da1)); CHKERRQ(ierr);
+  return 0;
+}
@@ -6,11 +6,11 @@ Plot trajectory, or frames if solution has two spatial dimensions, generated by
 running a PETSc TS program.  Reads output from
    -ts_monitor binary:TDATA -ts_monitor_solution binary:UDATA
 Requires copies or sym-links to $PETSC_DIR/lib/petsc/bin/PetscBinaryIO.py and
-$PETSC_DIR/lib/petsc/bin/petsc_conf.py.
+$PETSC_DIR/lib/petsc/bin/petsc_conf.py.  Alternatively reads the files from
+   -X_snapshot ROOT
+(see c/interlude/snapshot.h) using -snapshot ROOT, with no TDATA and UDATA.
 '''
 
-import PetscBinaryIO
-
 from sys import exit, stdout
 from time import sleep
 from argparse import ArgumentParser, RawTextHelpFormatter
@@ -19,10 +19,12 @@ import matplotlib.pyplot as plt
 
 parser = ArgumentParser(description=help,
                         formatter_class=RawTextHelpFormatter)
-parser.add_argument('tfile',metavar='TDATA',
+parser.add_argument('tfile',metavar='TDATA',nargs='?',
                     help='from -ts_monitor binary:TDATA')
-parser.add_argument('ufile',metavar='UDATA',
+parser.add_argument('ufile',metavar='UDATA',nargs='?',
                     help='from -ts_monitor_solution binary:UDATA')
+parser.add_argument('-snapshot',metavar='ROOT',
+                    help='read ROOT.0,ROOT.1,... from -X_snapshot ROOT instead')
 parser.add_argument('-mx',metavar='MX', type=int, default=-1,
                     help='spatial grid with MX points in x direction')
 parser.add_argument('-my',metavar='MY', type=int, default=-1,
@@ -41,9 +43,17 @@ if args.mx > 0 and args.my < 1:
     args.my = args.mx
 frames = (args.mx > 0)
 
-io = PetscBinaryIO.PetscBinaryIO()
-t = np.array(io.readBinaryFile(args.tfile)).flatten()
-U = np.array(io.readBinaryFile(args.ufile)).transpose()
+if args.snapshot:
+    from snapshots import readsnapshots
+    t, U = readsnapshots(args.snapshot)
+else:
+    if not (args.tfile and args.ufile):
+        print('TDATA and UDATA are required without -snapshot')
+        exit(4)
+    import PetscBinaryIO
+    io = PetscBinaryIO.PetscBinaryIO()
+    t = np.array(io.readBinaryFile(args.tfile)).flatten()
+    U = np.array(io.readBinaryFile(args.ufile)).transpose()
 dims = np.shape(U)
 
 if len(t) != dims[1]:
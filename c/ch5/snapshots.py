@@ -0,0 +1,59 @@
+'''
+Reader for the snapshot files ROOT.0, ROOT.1, ... written by the TS monitor
+in c/interlude/snapshot.h (options -X_snapshot ROOT).  Each process wrote
+its own part of the grid, so readsnapshots() reassembles the frames.  It
+returns (t, U) like reading the -ts_monitor binary:TDATA and
+-ts_monitor_solution binary:UDATA files in plotTS.py:  t has one entry per
+frame and U has shape (mx*my*dof, number of frames), in natural ordering.
+A frame which was being written when a run stopped is ignored.  The files
+must hold the same steps, frame by frame.  Run as a script,
+    python3 snapshots.py ROOT
+it reports the number of frames and their times.
+'''
+
+import glob
+import numpy as np
+
+MAGIC = 0x54414e5344503450
+
+def readsnapshots(root):
+    files = glob.glob(root + '.[0-9]*')
+    if len(files) == 0:
+        raise IOError('no snapshot files %s.*' % root)
+    parts = []
+    for name in files:
+        hdr = np.fromfile(name, dtype=np.int64, count=10)
+        if len(hdr) < 10 or hdr[0] != MAGIC:
+            raise IOError('%s is not a snapshot file' % name)
+        mx, my, dof, xs, ys, xm, ym, nbytes, size = [int(h) for h in hdr[1:]]
+        if size != len(files):
+            raise IOError('found %d files but %d processes wrote %s.*' \
+                          % (len(files), size, root))
+        vtype = np.float32 if nbytes == 4 else np.float64
+        frame = np.dtype([('step', np.int64), ('time', np.float64),
+                          ('u', vtype, (ym, xm, dof))])
+        with open(name, 'rb') as f:
+            f.seek(10 * 8)
+            frames = np.frombuffer(f.read(), dtype=np.uint8)
+        nframes = len(frames) // frame.itemsize
+        frames = frames[:nframes * frame.itemsize].view(frame)
+        parts.append((xs, ys, xm, ym, frames))
+    nframes = min([len(p[4]) for p in parts])
+    steps = parts[0][4]['step'][:nframes]
+    for p in parts[1:]:
+        if not np.array_equal(p[4]['step'][:nframes], steps):
+            raise IOError('files %s.* do not hold the same steps' % root)
+    t = parts[0][4]['time'][:nframes].copy()
+    U = np.zeros((nframes, my, mx, dof))
+    for xs, ys, xm, ym, frames in parts:
+        U[:, ys:ys+ym, xs:xs+xm, :] = frames['u'][:nframes]
+    return t, U.reshape((nframes, my * mx * dof)).transpose()
+
+if __name__ == "__main__":
+    import sys
+    if len(sys.argv) != 2:
+        print('usage: python3 snapshots.py ROOT')
+        sys.exit(1)
+    t, U = readsnapshots(sys.argv[1])
+    print('%s: %d frames at times %s' \
+          % (sys.argv[1], len(t), ' '.join(['%g' % tt for tt in t])))
@@ -0,0 +1,25 @@
+#!/bin/bash
+set -e
+
+# compares the interleaved (default) and structure-of-arrays (-ptn_soa)
+# evaluation of the IFunction and RHSFunction in pattern.c, by the times of
+# the TSFunctionEval and TSStep events on refined 2D grids
+
+# run as:
+#   ./patternsoa.sh &> patternsoa.txt
+# use PETSC_ARCH with --with-debugging=0
+
+function runcase() {
+    CMD="../pattern -da_refine $1 -ts_max_time 10 -log_view $2"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "running on" tmp.txt
+    grep "TSFunctionEval\|TSStep \|Time (sec):" tmp.txt
+}
+
+for LEV in 6 7 8; do
+    runcase $LEV ""
+    runcase $LEV "-ptn_soa"
+done
+rm -rf tmp.txt
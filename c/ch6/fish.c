@@ -99,6 +99,23 @@ static DMDASNESJacobian jacobian_ptr[3]
        (DMDASNESJacobian)&Poisson2DJacobianLocal,
        (DMDASNESJacobian)&Poisson3DJacobianLocal};
 
+// for -fsh_split; there is no split in 1D
+static DMDASNESFunction residualsplit_ptr[3]
+    = {(DMDASNESFunction)&Poisson1DFunctionLocal,
+       (DMDASNESFunction)&Poisson2DFunctionLocalSplit,
+       (DMDASNESFunction)&Poisson3DFunctionLocalSplit};
+
+// for -fsh_order 4
+static DMDASNESFunction residual4_ptr[3]
+    = {(DMDASNESFunction)&Poisson1DCompactFunctionLocal,
+       (DMDASNESFunction)&Poisson2DCompactFunctionLocal,
+       (DMDASNESFunction)&Poisson3DCompactFunctionLocal};
+
+static DMDASNESJacobian jacobian4_ptr[3]
+    = {(DMDASNESJacobian)&Poisson1DJacobianLocal,
+       (DMDASNESJacobian)&Poisson2DCompactJacobianLocal,
+       (DMDASNESJacobian)&Poisson3DCompactJacobianLocal};
+
 typedef PetscErrorCode (*ExactFcnVec)(DMDALocalInfo*,Vec,PoissonCtx*);
 
 static ExactFcnVec getuexact_ptr[3]
@@ -125,11 +142,23 @@ static PointwiseFcn f_rhs_ptr[3][3]
 static const char* InitialTypes[] = {"zeros","random",
                                      "InitialType", "", NULL};
 
+static const char* SweepTypes[] = {"jacobi","redblack",
+                                   "PoissonSweepType", "", NULL};
+
+// for -fsh_matfree; see CreateMatrixMF() and JacobianMF()
+static PetscErrorCode CreateMatrixMF(DM, Mat*);
+static PetscErrorCode JacobianMF(DMDALocalInfo*, void*, Mat, Mat, PoissonCtx*);
+
+// for -pc_type shell, -mg_coarse_pc_type shell, -mg_levels_pc_type shell
+static PetscErrorCode SetShellPCs(PC, PetscInt, PoissonSweepType, PetscInt, PetscReal, PetscInt);
+
 int main(int argc,char **argv) {
     PetscErrorCode ierr;
     DM             da, da_after;
     SNES           snes;
     KSP            ksp;
+    PC             pc;
+    PetscBool      ismg;
     Vec            u_initial, u, u_exact;
     PoissonCtx     user;
     DMDALocalInfo  info;
@@ -138,10 +167,24 @@ int main(int argc,char **argv) {
     ExactFcnVec    getuexact;
 
     // fish defaults:
-    PetscInt       dim = 2;                  // 2D
+    PetscInt       dim = 2,                  // 2D
+                   order = 2;                // 5/7-point stencils
+    DMDAStencilType stencil;
     ProblemType    problem = MANUEXP;        // manufactured problem using exp()
     InitialType    initial = ZEROS;          // set u=0 for initial iterate
     PetscBool      gonboundary = PETSC_TRUE; // initial iterate has u=g on boundary
+    PetscBool      cache = PETSC_FALSE,      // evaluate g_bdry(), f_rhs() at each call
+                   matfree = PETSC_FALSE,    // assemble Jacobian on all grids
+                   split = PETSC_FALSE;      // residual by pointwise loops
+    PetscInt       coarselevel = 0;          // see CreateMatrixMF()
+    PoissonSweepType blktype = SWEEP_JACOBI; // for -mg_levels_pc_type shell
+    PetscInt       blksweeps = 2,
+                   blktile = 16;
+    PetscReal      blkomega = 2.0 / 3.0;
+    PetscBool      spmg = PETSC_FALSE;       // for single-precision MG PC
+    PetscInt       spmglevels = 20,
+                   spmgsweeps = 2;
+    PetscReal      spmgomega = 2.0 / 3.0;
 
     ierr = PetscInitialize(&argc,&argv,NULL,help); if (ierr) return ierr;
 
@@ -153,6 +196,21 @@ int main(int argc,char **argv) {
     user.cy = 1.0;
     user.cz = 1.0;
     ierr = PetscOptionsBegin(PETSC_COMM_WORLD,"fsh_", "options for fish.c", ""); CHKERRQ(ierr);
+    ierr = PetscOptionsReal("-blk_omega",
+         "weight for Jacobi sweeps in -mg_levels_pc_type shell smoother",
+         "fish.c",blkomega,&blkomega,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsInt("-blk_sweeps",
+         "number of sweeps in -mg_levels_pc_type shell smoother",
+         "fish.c",blksweeps,&blksweeps,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsInt("-blk_tile",
+         "tile size in y and z directions in -mg_levels_pc_type shell smoother",
+         "fish.c",blktile,&blktile,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsEnum("-blk_type",
+         "type of sweeps in -mg_levels_pc_type shell smoother",
+         "fish.c",SweepTypes,(PetscEnum)blktype,(PetscEnum*)&blktype,NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-cache",
+         "precompute g_bdry() and f_rhs() on each grid; see PoissonCacheCreate()",
+         "fish.c",cache,&cache,NULL);CHKERRQ(ierr);
     ierr = PetscOptionsReal("-cx",
          "set coefficient of x term u_xx in equation",
          "fish.c",user.cx,&user.cx,NULL);CHKERRQ(ierr);
@@ -171,6 +229,9 @@ int main(int argc,char **argv) {
     ierr = PetscOptionsEnum("-initial_type",
          "type of initial iterate",
          "fish.c",InitialTypes,(PetscEnum)initial,(PetscEnum*)&initial,NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-matfree",
+         "apply operator without assembly, except on coarsest multigrid level; requires -pc_type mg; see PoissonMatCreateShell()",
+         "fish.c",matfree,&matfree,NULL);CHKERRQ(ierr);
     ierr = PetscOptionsReal("-Lx",
          "set Lx in domain ([0,Lx] x [0,Ly] x [0,Lz], etc.)",
          "fish.c",user.Lx,&user.Lx,NULL);CHKERRQ(ierr);
@@ -180,9 +241,27 @@ int main(int argc,char **argv) {
     ierr = PetscOptionsReal("-Lz",
          "set Ly in domain ([0,Lx] x [0,Ly] x [0,Lz], etc.)",
          "fish.c",user.Lz,&user.Lz,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsInt("-order",
+         "order of accuracy of discretization (=2,4 only); 4 uses compact 9/19-point stencils",
+         "fish.c",order,&order,NULL);CHKERRQ(ierr);
     ierr = PetscOptionsEnum("-problem",
          "problem type; determines exact solution and RHS",
          "fish.c",ProblemTypes,(PetscEnum)problem,(PetscEnum*)&problem,NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-split",
+         "compute 2D,3D residuals by vectorizable interior rows plus boundary strips; see Poisson2DFunctionLocalSplit()",
+         "fish.c",split,&split,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-spmg",
+         "precondition by single-precision MG V-cycle; see PoissonPCShellSetSinglePrecisionMG()",
+         "fish.c",spmg,&spmg,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsInt("-spmg_levels",
+         "maximum number of levels in -fsh_spmg preconditioner",
+         "fish.c",spmglevels,&spmglevels,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsReal("-spmg_omega",
+         "weight for Jacobi sweeps in -fsh_spmg preconditioner",
+         "fish.c",spmgomega,&spmgomega,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsInt("-spmg_sweeps",
+         "number of Jacobi sweeps before and after coarse correction in -fsh_spmg preconditioner",
+         "fish.c",spmgsweeps,&spmgsweeps,NULL);CHKERRQ(ierr);
     ierr = PetscOptionsEnd(); CHKERRQ(ierr);
     user.g_bdry = g_bdry_ptr[dim-1][problem];
     user.f_rhs = f_rhs_ptr[dim-1][problem];
@@ -192,6 +271,17 @@ int main(int argc,char **argv) {
     if ((problem == MANUEXP) && ( user.cx != 1.0 || user.cy != 1.0 || user.cz != 1.0)) {
         SETERRQ(PETSC_COMM_SELF,3,"cx=cy=cz=1 required for problem MANUEXP\n");
     }
+    if (order != 2 && order != 4) {
+        SETERRQ(PETSC_COMM_SELF,6,"only orders 2 and 4 are implemented\n");
+    }
+    if (order == 4 && matfree) {
+        SETERRQ(PETSC_COMM_SELF,7,"-fsh_matfree applies only the second-order operator\n");
+    }
+    if (order == 4 && split) {
+        SETERRQ(PETSC_COMM_SELF,9,"-fsh_split applies only to the second-order residual\n");
+    }
+    // the compact stencils need diagonal neighbors
+    stencil = (order == 4) ? DMDA_STENCIL_BOX : DMDA_STENCIL_STAR;
 
 //STARTCREATE
     // create DMDA in chosen dimension
@@ -202,13 +292,13 @@ int main(int argc,char **argv) {
             break;
         case 2:
             ierr = DMDACreate2d(PETSC_COMM_WORLD,
-                DM_BOUNDARY_NONE,DM_BOUNDARY_NONE,DMDA_STENCIL_STAR,
+                DM_BOUNDARY_NONE,DM_BOUNDARY_NONE,stencil,
                 3,3,PETSC_DECIDE,PETSC_DECIDE,1,1,NULL,NULL,&da); CHKERRQ(ierr);
             break;
         case 3:
             ierr = DMDACreate3d(PETSC_COMM_WORLD,
                 DM_BOUNDARY_NONE, DM_BOUNDARY_NONE, DM_BOUNDARY_NONE,
-                DMDA_STENCIL_STAR,
+                stencil,
                 3,3,3,PETSC_DECIDE,PETSC_DECIDE,PETSC_DECIDE,
                 1,1,NULL,NULL,NULL,&da); CHKERRQ(ierr);
             break;
@@ -219,20 +309,56 @@ int main(int argc,char **argv) {
     ierr = DMSetFromOptions(da); CHKERRQ(ierr);
     ierr = DMSetUp(da); CHKERRQ(ierr);  // call BEFORE SetUniformCoordinates
     ierr = DMDASetUniformCoordinates(da,0.0,user.Lx,0.0,user.Ly,0.0,user.Lz); CHKERRQ(ierr);
+    if (cache) {
+        ierr = PoissonCacheCreate(da,&user); CHKERRQ(ierr);
+    }
 
     // set SNES call-backs
     ierr = SNESCreate(PETSC_COMM_WORLD,&snes); CHKERRQ(ierr);
     ierr = SNESSetDM(snes,da); CHKERRQ(ierr);
     ierr = DMDASNESSetFunctionLocal(da,INSERT_VALUES,
-             (DMDASNESFunction)(residual_ptr[dim-1]),&user); CHKERRQ(ierr);
-    ierr = DMDASNESSetJacobianLocal(da,
-             (DMDASNESJacobian)(jacobian_ptr[dim-1]),&user); CHKERRQ(ierr);
+             (order == 4) ? residual4_ptr[dim-1]
+                          : (split ? residualsplit_ptr[dim-1] : residual_ptr[dim-1]),
+             &user); CHKERRQ(ierr);
+    if (matfree) {
+        user.addctx = &coarselevel;
+        ierr = DMDASetGetMatrix(da,CreateMatrixMF); CHKERRQ(ierr);
+        ierr = DMDASNESSetJacobianLocal(da,
+                 (DMDASNESJacobian)JacobianMF,&user); CHKERRQ(ierr);
+    } else {
+        ierr = DMDASNESSetJacobianLocal(da,
+                 (order == 4) ? jacobian4_ptr[dim-1] : jacobian_ptr[dim-1],
+                 &user); CHKERRQ(ierr);
+    }
 
     // default to KSPONLY+CG because problem is linear and SPD
     ierr = SNESSetType(snes,SNESKSPONLY); CHKERRQ(ierr);
     ierr = SNESGetKSP(snes,&ksp); CHKERRQ(ierr);
     ierr = KSPSetType(ksp,KSPCG); CHKERRQ(ierr);
     ierr = SNESSetFromOptions(snes); CHKERRQ(ierr);
+    ierr = KSPGetPC(ksp,&pc); CHKERRQ(ierr);
+    ierr = PetscObjectTypeCompare((PetscObject)pc,PCMG,&ismg); CHKERRQ(ierr);
+    if (matfree && !ismg) {
+        // otherwise CreateMatrixMF() would assemble the only level
+        SETERRQ(PETSC_COMM_SELF,10,"-fsh_matfree requires -pc_type mg\n");
+    }
+    if (matfree) {
+        // only the coarsest PCMG level gets assembled
+        PCMGGalerkinType gtype;
+        ierr = PCMGGetGalerkin(pc,&gtype); CHKERRQ(ierr);
+        if (gtype != PC_MG_GALERKIN_NONE) {
+            SETERRQ(PETSC_COMM_SELF,5,"-fsh_matfree requires rediscretized coarse grids; do not use -pc_mg_galerkin\n");
+        }
+        ierr = PCMGGetLevels(pc,&coarselevel); CHKERRQ(ierr);
+        coarselevel -= 1;
+    }
+    if (spmg) {
+        // the outer KSP, in double precision, corrects the float V-cycle
+        ierr = PoissonPCShellSetSinglePrecisionMG(pc,spmglevels,
+                   spmgsweeps,spmgomega); CHKERRQ(ierr);
+    } else {
+        ierr = SetShellPCs(pc,order,blktype,blksweeps,blkomega,blktile); CHKERRQ(ierr);
+    }
 
     // set initial iterate and then solve
     ierr = DMGetGlobalVector(da,&u_initial); CHKERRQ(ierr);
@@ -285,6 +411,128 @@ int main(int argc,char **argv) {
     return PetscFinalize();
 }
 
+/* For -fsh_matfree this replaces DMCreateMatrix() for the DMDA; it is
+inherited by the grids coarsened from it.  The coarsest multigrid level
+(DMGetCoarsenLevel() equal to *addctx) gets an AIJ matrix, preallocated
+and set up for MatSetValuesStencil() as a DMDA would do.  All other levels
+get a MATSHELL from PoissonMatCreateShell().                              */
+static PetscErrorCode CreateMatrixMF(DM da, Mat *A) {
+    PetscErrorCode ierr;
+    PoissonCtx     *user;
+    DMDALocalInfo  info;
+    ISLocalToGlobalMapping ltog;
+    PetscInt       level, n, N, dims[3], starts[3];
+
+    ierr = DMGetApplicationContext(da,&user); CHKERRQ(ierr);
+    ierr = DMGetCoarsenLevel(da,&level); CHKERRQ(ierr);
+    if (level < *(PetscInt*)(user->addctx)) {
+        ierr = PoissonMatCreateShell(da,A); CHKERRQ(ierr);
+        return 0;
+    }
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    n = info.xm;  N = info.mx;
+    dims[0] = info.gxm;  starts[0] = info.gxs;
+    if (info.dim > 1) {
+        n *= info.ym;  N *= info.my;
+        dims[1] = info.gym;  starts[1] = info.gys;
+    }
+    if (info.dim > 2) {
+        n *= info.zm;  N *= info.mz;
+        dims[2] = info.gzm;  starts[2] = info.gzs;
+    }
+    ierr = MatCreate(PetscObjectComm((PetscObject)da),A); CHKERRQ(ierr);
+    ierr = MatSetSizes(*A,n,n,N,N); CHKERRQ(ierr);
+    ierr = MatSetType(*A,MATAIJ); CHKERRQ(ierr);
+    ierr = MatSetFromOptions(*A); CHKERRQ(ierr);
+    // at most 2 dim + 1 nonzeros per row, at most 2 dim off-process
+    ierr = MatSeqAIJSetPreallocation(*A,2*info.dim+1,NULL); CHKERRQ(ierr);
+    ierr = MatMPIAIJSetPreallocation(*A,2*info.dim+1,NULL,2*info.dim,NULL); CHKERRQ(ierr);
+    ierr = DMGetLocalToGlobalMapping(da,&ltog); CHKERRQ(ierr);
+    ierr = MatSetLocalToGlobalMapping(*A,ltog,ltog); CHKERRQ(ierr);
+    ierr = MatSetStencil(*A,info.dim,dims,starts,1); CHKERRQ(ierr);
+    ierr = MatSetDM(*A,da); CHKERRQ(ierr);
+    return 0;
+}
+
+// a MATSHELL needs no filling because the problem is linear
+static PetscErrorCode JacobianMF(DMDALocalInfo *info, void *au,
+                                 Mat J, Mat Jpre, PoissonCtx *user) {
+    PetscErrorCode ierr;
+    PetscBool      isshell;
+    ierr = PetscObjectTypeCompare((PetscObject)Jpre,MATSHELL,&isshell); CHKERRQ(ierr);
+    if (!isshell) {
+        ierr = (*jacobian_ptr[info->dim-1])(info,au,J,Jpre,user); CHKERRQ(ierr);
+        return 0;
+    }
+    ierr = MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    if (J != Jpre) {
+        ierr = MatAssemblyBegin(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+        ierr = MatAssemblyEnd(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+// PCs inside PCMG get their types from options only at PCSetUp(), so check
+// the options database now
+static PetscErrorCode OptionsPCIsShell(PC pc, PetscBool *isshell) {
+    PetscErrorCode ierr;
+    const char     *prefix;
+    char           pctype[64] = "";
+    ierr = PCGetOptionsPrefix(pc,&prefix); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL,prefix,"-pc_type",
+                                 pctype,sizeof(pctype),NULL); CHKERRQ(ierr);
+    ierr = PetscStrcmp(pctype,PCSHELL,isshell); CHKERRQ(ierr);
+    return 0;
+}
+
+/* A PCSHELL is the DST direct solver from PoissonPCShellSetDST() if it is
+the whole preconditioner or the PCMG coarse solver, and it is the smoother
+from PoissonPCShellSetBlockSmoother() on the other PCMG levels.  The DST
+solver is exact only for the second-order operator, so it is rejected for
+-fsh_order 4.  The smoothers, and -fsh_spmg, also act on the second-order
+operator, but they are only preconditioners, so they may be used.          */
+static PetscErrorCode SetShellPCs(PC pc, PetscInt order, PoissonSweepType blktype,
+        PetscInt blksweeps, PetscReal blkomega, PetscInt blktile) {
+    PetscErrorCode ierr;
+    PetscBool      ismg, isshell;
+    PetscInt       l, nlevels;
+    KSP            sksp;
+    PC             spc;
+
+    ierr = OptionsPCIsShell(pc,&isshell); CHKERRQ(ierr);
+    if (isshell) {
+        if (order == 4) {
+            SETERRQ(PETSC_COMM_SELF,8,"-pc_type shell (DST solver) applies only the second-order operator\n");
+        }
+        ierr = PoissonPCShellSetDST(pc); CHKERRQ(ierr);
+        return 0;
+    }
+    ierr = PetscObjectTypeCompare((PetscObject)pc,PCMG,&ismg); CHKERRQ(ierr);
+    if (!ismg)
+        return 0;
+    ierr = PCMGGetCoarseSolve(pc,&sksp); CHKERRQ(ierr);
+    ierr = KSPGetPC(sksp,&spc); CHKERRQ(ierr);
+    ierr = OptionsPCIsShell(spc,&isshell); CHKERRQ(ierr);
+    if (isshell) {
+        if (order == 4) {
+            SETERRQ(PETSC_COMM_SELF,8,"-mg_coarse_pc_type shell (DST solver) applies only the second-order operator\n");
+        }
+        ierr = PoissonPCShellSetDST(spc); CHKERRQ(ierr);
+    }
+    ierr = PCMGGetLevels(pc,&nlevels); CHKERRQ(ierr);
+    for (l = 1; l < nlevels; l++) {
+        ierr = PCMGGetSmoother(pc,l,&sksp); CHKERRQ(ierr);
+        ierr = KSPGetPC(sksp,&spc); CHKERRQ(ierr);
+        ierr = OptionsPCIsShell(spc,&isshell); CHKERRQ(ierr);
+        if (isshell) {
+            ierr = PoissonPCShellSetBlockSmoother(spc,blktype,blksweeps,
+                                                  blkomega,blktile); CHKERRQ(ierr);
+        }
+    }
+    return 0;
+}
+
 PetscErrorCode Form1DUExact(DMDALocalInfo *info, Vec u, PoissonCtx* user) {
   PetscErrorCode ierr;
   PetscInt   i;
@@ -1,27 +1,121 @@
 #include <petsc.h>
 #include "poissonfunctions.h"
+#include "../interlude/stencilcsr.h"
 
+// Caches from PoissonCacheCreate() are composed with the DMDA.  The
+// returned Vecs are NULL if there are no caches.
+static PetscErrorCode PoissonCacheGet(DM da, Vec *gcache, Vec *fcache) {
+    PetscErrorCode ierr;
+    ierr = PetscObjectQuery((PetscObject)da,"Poisson_g_cache",
+                            (PetscObject*)gcache); CHKERRQ(ierr);
+    ierr = PetscObjectQuery((PetscObject)da,"Poisson_f_cache",
+                            (PetscObject*)fcache); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode PoissonCacheCoarsenHook(DM fine, DM coarse, void *ctx) {
+    PetscErrorCode ierr;
+    ierr = PoissonCacheCreate(coarse,(PoissonCtx*)ctx); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode PoissonCacheRefineHook(DM coarse, DM fine, void *ctx) {
+    PetscErrorCode ierr;
+    ierr = PoissonCacheCreate(fine,(PoissonCtx*)ctx); CHKERRQ(ierr);
+    return 0;
+}
+
+// The cache Vecs are sequential, with the size of a local (ghosted) Vec,
+// so DMDAVecGetArray() gives the usual global-index access.  They are not
+// created by the DMDA because then they would hold a reference to it.
+PetscErrorCode PoissonCacheCreate(DM da, PoissonCtx *user) {
+    PetscErrorCode ierr;
+    DMDALocalInfo  info;
+    Vec            gcache, fcache, vloc;
+    PetscInt       nloc, i, j, k, l;
+    PetscReal      xyzmin[3], xyzmax[3], hx, hy = 1.0, hz = 1.0, dvol,
+                   x, y = 0.0, z = 0.0, *ag, *af;
+
+    ierr = PoissonCacheGet(da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {  // already created
+        return 0;
+    }
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = DMGetBoundingBox(da,xyzmin,xyzmax); CHKERRQ(ierr);
+    hx = (xyzmax[0] - xyzmin[0]) / (info.mx - 1);
+    if (info.dim > 1)
+        hy = (xyzmax[1] - xyzmin[1]) / (info.my - 1);
+    if (info.dim > 2)
+        hz = (xyzmax[2] - xyzmin[2]) / (info.mz - 1);
+    dvol = hx * hy * hz;
+    ierr = DMGetLocalVector(da,&vloc); CHKERRQ(ierr);
+    ierr = VecGetLocalSize(vloc,&nloc); CHKERRQ(ierr);
+    ierr = DMRestoreLocalVector(da,&vloc); CHKERRQ(ierr);
+    ierr = VecCreateSeq(PETSC_COMM_SELF,nloc,&gcache); CHKERRQ(ierr);
+    ierr = VecDuplicate(gcache,&fcache); CHKERRQ(ierr);
+    ierr = VecGetArray(gcache,&ag); CHKERRQ(ierr);
+    ierr = VecGetArray(fcache,&af); CHKERRQ(ierr);
+    // for dim < 3 the unused ghosted ranges have length one
+    l = 0;
+    for (k = info.gzs; k < info.gzs + info.gzm; k++) {
+        if (info.dim > 2)
+            z = xyzmin[2] + k * hz;
+        for (j = info.gys; j < info.gys + info.gym; j++) {
+            if (info.dim > 1)
+                y = xyzmin[1] + j * hy;
+            for (i = info.gxs; i < info.gxs + info.gxm; i++) {
+                x = xyzmin[0] + i * hx;
+                ag[l] = user->g_bdry(x,y,z,user);
+                af[l] = dvol * user->f_rhs(x,y,z,user);
+                l++;
+            }
+        }
+    }
+    ierr = VecRestoreArray(gcache,&ag); CHKERRQ(ierr);
+    ierr = VecRestoreArray(fcache,&af); CHKERRQ(ierr);
+    ierr = PetscObjectCompose((PetscObject)da,"Poisson_g_cache",
+                              (PetscObject)gcache); CHKERRQ(ierr);
+    ierr = PetscObjectCompose((PetscObject)da,"Poisson_f_cache",
+                              (PetscObject)fcache); CHKERRQ(ierr);
+    ierr = VecDestroy(&gcache); CHKERRQ(ierr);  // da holds references
+    ierr = VecDestroy(&fcache); CHKERRQ(ierr);
+    ierr = DMCoarsenHookAdd(da,PoissonCacheCoarsenHook,NULL,user); CHKERRQ(ierr);
+    ierr = DMRefineHookAdd(da,PoissonCacheRefineHook,NULL,user); CHKERRQ(ierr);
+    return 0;
+}
+
+// in the functions below, ag and af are arrays from caches, or NULL
 PetscErrorCode Poisson1DFunctionLocal(DMDALocalInfo *info, PetscReal *au,
                                       PetscReal *aF, PoissonCtx *user) {
     PetscErrorCode ierr;
     PetscInt   i;
-    PetscReal  xmax[1], xmin[1], h, x, ue, uw;
+    PetscReal  xmax[1], xmin[1], h, x, ue, uw, *ag = NULL, *af = NULL;
+    Vec        gcache, fcache;
     ierr = DMGetBoundingBox(info->da,xmin,xmax); CHKERRQ(ierr);
     h = (xmax[0] - xmin[0]) / (info->mx - 1);
+    ierr = PoissonCacheGet(info->da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {
+        ierr = DMDAVecGetArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecGetArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
     for (i = info->xs; i < info->xs + info->xm; i++) {
         x = xmin[0] + i * h;
         if (i==0 || i==info->mx-1) {
-            aF[i] = au[i] - user->g_bdry(x,0.0,0.0,user);
+            aF[i] = au[i] - (ag ? ag[i] : user->g_bdry(x,0.0,0.0,user));
             aF[i] *= user->cx * (2.0 / h);
         } else {
-            ue = (i+1 == info->mx-1) ? user->g_bdry(x+h,0.0,0.0,user)
+            ue = (i+1 == info->mx-1) ? (ag ? ag[i+1] : user->g_bdry(x+h,0.0,0.0,user))
                                      : au[i+1];
-            uw = (i-1 == 0)          ? user->g_bdry(x-h,0.0,0.0,user)
+            uw = (i-1 == 0)          ? (ag ? ag[i-1] : user->g_bdry(x-h,0.0,0.0,user))
                                      : au[i-1];
             aF[i] = user->cx * (2.0 * au[i] - uw - ue) / h
-                    - h * user->f_rhs(x,0.0,0.0,user);
+                    - (af ? af[i] : h * user->f_rhs(x,0.0,0.0,user));
         }
     }
+    if (ag) {
+        ierr = DMDAVecRestoreArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecRestoreArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
     ierr = PetscLogFlops(9.0*info->xm);CHKERRQ(ierr);
     return 0;
 }
@@ -32,7 +126,8 @@ PetscErrorCode Poisson2DFunctionLocal(DMDALocalInfo *info, PetscReal **au,
     PetscErrorCode ierr;
     PetscInt   i, j;
     PetscReal  xymin[2], xymax[2], hx, hy, darea, scx, scy, scdiag, x, y,
-               ue, uw, un, us;
+               ue, uw, un, us, **ag = NULL, **af = NULL;
+    Vec        gcache, fcache;
     ierr = DMGetBoundingBox(info->da,xymin,xymax); CHKERRQ(ierr);
     hx = (xymax[0] - xymin[0]) / (info->mx - 1);
     hy = (xymax[1] - xymin[1]) / (info->my - 1);
@@ -40,28 +135,37 @@ PetscErrorCode Poisson2DFunctionLocal(DMDALocalInfo *info, PetscReal **au,
     scx = user->cx * hy / hx;
     scy = user->cy * hx / hy;
     scdiag = 2.0 * (scx + scy);    // diagonal scaling
+    ierr = PoissonCacheGet(info->da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {
+        ierr = DMDAVecGetArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecGetArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
     for (j = info->ys; j < info->ys + info->ym; j++) {
         y = xymin[1] + j * hy;
         for (i = info->xs; i < info->xs + info->xm; i++) {
             x = xymin[0] + i * hx;
             if (i==0 || i==info->mx-1 || j==0 || j==info->my-1) {
-                aF[j][i] = au[j][i] - user->g_bdry(x,y,0.0,user);
+                aF[j][i] = au[j][i] - (ag ? ag[j][i] : user->g_bdry(x,y,0.0,user));
                 aF[j][i] *= scdiag;
             } else {
-                ue = (i+1 == info->mx-1) ? user->g_bdry(x+hx,y,0.0,user)
+                ue = (i+1 == info->mx-1) ? (ag ? ag[j][i+1] : user->g_bdry(x+hx,y,0.0,user))
                                          : au[j][i+1];
-                uw = (i-1 == 0)          ? user->g_bdry(x-hx,y,0.0,user)
+                uw = (i-1 == 0)          ? (ag ? ag[j][i-1] : user->g_bdry(x-hx,y,0.0,user))
                                          : au[j][i-1];
-                un = (j+1 == info->my-1) ? user->g_bdry(x,y+hy,0.0,user)
+                un = (j+1 == info->my-1) ? (ag ? ag[j+1][i] : user->g_bdry(x,y+hy,0.0,user))
                                          : au[j+1][i];
-                us = (j-1 == 0)          ? user->g_bdry(x,y-hy,0.0,user)
+                us = (j-1 == 0)          ? (ag ? ag[j-1][i] : user->g_bdry(x,y-hy,0.0,user))
                                          : au[j-1][i];
                 aF[j][i] = scdiag * au[j][i]
                            - scx * (uw + ue) - scy * (us + un)
-                           - darea * user->f_rhs(x,y,0.0,user);
+                           - (af ? af[j][i] : darea * user->f_rhs(x,y,0.0,user));
             }
         }
     }
+    if (ag) {
+        ierr = DMDAVecRestoreArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecRestoreArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
     ierr = PetscLogFlops(11.0*info->xm*info->ym);CHKERRQ(ierr);
     return 0;
 }
@@ -72,7 +176,8 @@ PetscErrorCode Poisson3DFunctionLocal(DMDALocalInfo *info, PetscReal ***au,
     PetscErrorCode ierr;
     PetscInt   i, j, k;
     PetscReal  xyzmin[3], xyzmax[3], hx, hy, hz, dvol, scx, scy, scz, scdiag,
-               x, y, z, ue, uw, un, us, uu, ud;
+               x, y, z, ue, uw, un, us, uu, ud, ***ag = NULL, ***af = NULL;
+    Vec        gcache, fcache;
     ierr = DMGetBoundingBox(info->da,xyzmin,xyzmax); CHKERRQ(ierr);
     hx = (xyzmax[0] - xyzmin[0]) / (info->mx - 1);
     hy = (xyzmax[1] - xyzmin[1]) / (info->my - 1);
@@ -82,6 +187,11 @@ PetscErrorCode Poisson3DFunctionLocal(DMDALocalInfo *info, PetscReal ***au,
     scy = user->cy * dvol / (hy*hy);
     scz = user->cz * dvol / (hz*hz);
     scdiag = 2.0 * (scx + scy + scz);
+    ierr = PoissonCacheGet(info->da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {
+        ierr = DMDAVecGetArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecGetArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
     for (k = info->zs; k < info->zs + info->zm; k++) {
         z = xyzmin[2] + k * hz;
         for (j = info->ys; j < info->ys + info->ym; j++) {
@@ -91,28 +201,256 @@ PetscErrorCode Poisson3DFunctionLocal(DMDALocalInfo *info, PetscReal ***au,
                 if (   i==0 || i==info->mx-1
                     || j==0 || j==info->my-1
                     || k==0 || k==info->mz-1) {
-                    aF[k][j][i] = au[k][j][i] - user->g_bdry(x,y,z,user);
+                    aF[k][j][i] = au[k][j][i] - (ag ? ag[k][j][i] : user->g_bdry(x,y,z,user));
                     aF[k][j][i] *= scdiag;
                 } else {
-                    ue = (i+1 == info->mx-1) ? user->g_bdry(x+hx,y,z,user)
+                    ue = (i+1 == info->mx-1) ? (ag ? ag[k][j][i+1] : user->g_bdry(x+hx,y,z,user))
                                              : au[k][j][i+1];
-                    uw = (i-1 == 0)          ? user->g_bdry(x-hx,y,z,user)
+                    uw = (i-1 == 0)          ? (ag ? ag[k][j][i-1] : user->g_bdry(x-hx,y,z,user))
                                              : au[k][j][i-1];
-                    un = (j+1 == info->my-1) ? user->g_bdry(x,y+hy,z,user)
+                    un = (j+1 == info->my-1) ? (ag ? ag[k][j+1][i] : user->g_bdry(x,y+hy,z,user))
                                              : au[k][j+1][i];
-                    us = (j-1 == 0)          ? user->g_bdry(x,y-hy,z,user)
+                    us = (j-1 == 0)          ? (ag ? ag[k][j-1][i] : user->g_bdry(x,y-hy,z,user))
                                              : au[k][j-1][i];
-                    uu = (k+1 == info->mz-1) ? user->g_bdry(x,y,z+hz,user)
+                    uu = (k+1 == info->mz-1) ? (ag ? ag[k+1][j][i] : user->g_bdry(x,y,z+hz,user))
                                              : au[k+1][j][i];
-                    ud = (k-1 == 0)          ? user->g_bdry(x,y,z-hz,user)
+                    ud = (k-1 == 0)          ? (ag ? ag[k-1][j][i] : user->g_bdry(x,y,z-hz,user))
                                              : au[k-1][j][i];
                     aF[k][j][i] = scdiag * au[k][j][i]
                         - scx * (uw + ue) - scy * (us + un) - scz * (uu + ud)
-                        - dvol * user->f_rhs(x,y,z,user);
+                        - (af ? af[k][j][i] : dvol * user->f_rhs(x,y,z,user));
+                }
+            }
+        }
+    }
+    if (ag) {
+        ierr = DMDAVecRestoreArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecRestoreArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    ierr = PetscLogFlops(14.0*info->xm*info->ym*info->zm);CHKERRQ(ierr);
+    return 0;
+}
+
+/* Poisson2DFunctionLocalSplit() and Poisson3DFunctionLocalSplit() compute
+the same residuals as Poisson2DFunctionLocal() and Poisson3DFunctionLocal(),
+but in two kinds of passes.  Points in
+the "deep interior", whose stencil neighbors are all interior points, are
+swept along unit-stride rows with no branches, so the compiler can vectorize
+the stencil.  The remaining strips of points, which are either boundary
+points or are next to the boundary so that g_bdry() replaces a neighbor
+value, are handled pointwise by Poisson2DPointResidual() and
+Poisson3DPointResidual().  The range [lo,hi) of deep interior indices owned
+by this process in one direction is from PoissonInteriorRange(); the strips
+are then [s,lo) and [hi,s+m).                                              */
+static void PoissonInteriorRange(PetscInt s, PetscInt m, PetscInt M,
+                                 PetscInt *lo, PetscInt *hi) {
+    *lo = PetscMin(PetscMax(s,2), s+m);
+    *hi = PetscMax(PetscMin(s+m,M-2), *lo);
+}
+
+static PetscReal Poisson2DPointResidual(DMDALocalInfo *info, PetscReal **au,
+        PetscReal **ag, PetscReal **af, PetscInt i, PetscInt j, PetscReal x,
+        PetscReal y, PetscReal hx, PetscReal hy, PetscReal scx, PetscReal scy,
+        PetscReal darea, PoissonCtx *user) {
+    const PetscReal scdiag = 2.0 * (scx + scy);
+    PetscReal  ue, uw, un, us;
+    if (i==0 || i==info->mx-1 || j==0 || j==info->my-1) {
+        return scdiag * (au[j][i] - (ag ? ag[j][i] : user->g_bdry(x,y,0.0,user)));
+    }
+    ue = (i+1 == info->mx-1) ? (ag ? ag[j][i+1] : user->g_bdry(x+hx,y,0.0,user))
+                             : au[j][i+1];
+    uw = (i-1 == 0)          ? (ag ? ag[j][i-1] : user->g_bdry(x-hx,y,0.0,user))
+                             : au[j][i-1];
+    un = (j+1 == info->my-1) ? (ag ? ag[j+1][i] : user->g_bdry(x,y+hy,0.0,user))
+                             : au[j+1][i];
+    us = (j-1 == 0)          ? (ag ? ag[j-1][i] : user->g_bdry(x,y-hy,0.0,user))
+                             : au[j-1][i];
+    return scdiag * au[j][i] - scx * (uw + ue) - scy * (us + un)
+           - (af ? af[j][i] : darea * user->f_rhs(x,y,0.0,user));
+}
+
+PetscErrorCode Poisson2DFunctionLocalSplit(DMDALocalInfo *info, PetscReal **au,
+                                           PetscReal **aF, PoissonCtx *user) {
+    PetscErrorCode ierr;
+    PetscInt   i, j, ilo, ihi, jlo, jhi;
+    PetscReal  xymin[2], xymax[2], hx, hy, darea, scx, scy, scdiag, x, y,
+               **ag = NULL, **af = NULL;
+    Vec        gcache, fcache;
+    ierr = DMGetBoundingBox(info->da,xymin,xymax); CHKERRQ(ierr);
+    hx = (xymax[0] - xymin[0]) / (info->mx - 1);
+    hy = (xymax[1] - xymin[1]) / (info->my - 1);
+    darea = hx * hy;
+    scx = user->cx * hy / hx;
+    scy = user->cy * hx / hy;
+    scdiag = 2.0 * (scx + scy);    // diagonal scaling
+    ierr = PoissonCacheGet(info->da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {
+        ierr = DMDAVecGetArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecGetArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    PoissonInteriorRange(info->xs,info->xm,info->mx,&ilo,&ihi);
+    PoissonInteriorRange(info->ys,info->ym,info->my,&jlo,&jhi);
+    for (j = info->ys; j < info->ys + info->ym; j++) {
+        y = xymin[1] + j * hy;
+        if (j < jlo || j >= jhi) {  // whole row is a strip
+            for (i = info->xs; i < info->xs + info->xm; i++) {
+                x = xymin[0] + i * hx;
+                aF[j][i] = Poisson2DPointResidual(info,au,ag,af,i,j,x,y,
+                                                  hx,hy,scx,scy,darea,user);
+            }
+            continue;
+        }
+        for (i = info->xs; i < ilo; i++) {
+            x = xymin[0] + i * hx;
+            aF[j][i] = Poisson2DPointResidual(info,au,ag,af,i,j,x,y,
+                                              hx,hy,scx,scy,darea,user);
+        }
+        {
+            const PetscReal *PETSC_RESTRICT uc = au[j],
+                            *PETSC_RESTRICT us = au[j-1],
+                            *PETSC_RESTRICT un = au[j+1];
+            PetscReal       *PETSC_RESTRICT F = aF[j];
+            if (af) {
+                const PetscReal *PETSC_RESTRICT fc = af[j];
+                PetscPragmaSIMD
+                for (i = ilo; i < ihi; i++) {
+                    F[i] = scdiag * uc[i] - scx * (uc[i-1] + uc[i+1])
+                                          - scy * (us[i] + un[i]) - fc[i];
+                }
+            } else {
+                for (i = ilo; i < ihi; i++) {
+                    x = xymin[0] + i * hx;
+                    F[i] = - darea * user->f_rhs(x,y,0.0,user);
+                }
+                PetscPragmaSIMD
+                for (i = ilo; i < ihi; i++) {
+                    F[i] += scdiag * uc[i] - scx * (uc[i-1] + uc[i+1])
+                                           - scy * (us[i] + un[i]);
+                }
+            }
+        }
+        for (i = ihi; i < info->xs + info->xm; i++) {
+            x = xymin[0] + i * hx;
+            aF[j][i] = Poisson2DPointResidual(info,au,ag,af,i,j,x,y,
+                                              hx,hy,scx,scy,darea,user);
+        }
+    }
+    if (ag) {
+        ierr = DMDAVecRestoreArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecRestoreArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    ierr = PetscLogFlops(11.0*info->xm*info->ym);CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscReal Poisson3DPointResidual(DMDALocalInfo *info, PetscReal ***au,
+        PetscReal ***ag, PetscReal ***af, PetscInt i, PetscInt j, PetscInt k,
+        PetscReal x, PetscReal y, PetscReal z, PetscReal hx, PetscReal hy,
+        PetscReal hz, PetscReal scx, PetscReal scy, PetscReal scz,
+        PetscReal dvol, PoissonCtx *user) {
+    const PetscReal scdiag = 2.0 * (scx + scy + scz);
+    PetscReal  ue, uw, un, us, uu, ud;
+    if (   i==0 || i==info->mx-1
+        || j==0 || j==info->my-1
+        || k==0 || k==info->mz-1) {
+        return scdiag * (au[k][j][i] - (ag ? ag[k][j][i] : user->g_bdry(x,y,z,user)));
+    }
+    ue = (i+1 == info->mx-1) ? (ag ? ag[k][j][i+1] : user->g_bdry(x+hx,y,z,user))
+                             : au[k][j][i+1];
+    uw = (i-1 == 0)          ? (ag ? ag[k][j][i-1] : user->g_bdry(x-hx,y,z,user))
+                             : au[k][j][i-1];
+    un = (j+1 == info->my-1) ? (ag ? ag[k][j+1][i] : user->g_bdry(x,y+hy,z,user))
+                             : au[k][j+1][i];
+    us = (j-1 == 0)          ? (ag ? ag[k][j-1][i] : user->g_bdry(x,y-hy,z,user))
+                             : au[k][j-1][i];
+    uu = (k+1 == info->mz-1) ? (ag ? ag[k+1][j][i] : user->g_bdry(x,y,z+hz,user))
+                             : au[k+1][j][i];
+    ud = (k-1 == 0)          ? (ag ? ag[k-1][j][i] : user->g_bdry(x,y,z-hz,user))
+                             : au[k-1][j][i];
+    return scdiag * au[k][j][i]
+           - scx * (uw + ue) - scy * (us + un) - scz * (uu + ud)
+           - (af ? af[k][j][i] : dvol * user->f_rhs(x,y,z,user));
+}
+
+PetscErrorCode Poisson3DFunctionLocalSplit(DMDALocalInfo *info, PetscReal ***au,
+                                           PetscReal ***aF, PoissonCtx *user) {
+    PetscErrorCode ierr;
+    PetscInt   i, j, k, ilo, ihi, jlo, jhi, klo, khi;
+    PetscReal  xyzmin[3], xyzmax[3], hx, hy, hz, dvol, scx, scy, scz, scdiag,
+               x, y, z, ***ag = NULL, ***af = NULL;
+    Vec        gcache, fcache;
+    ierr = DMGetBoundingBox(info->da,xyzmin,xyzmax); CHKERRQ(ierr);
+    hx = (xyzmax[0] - xyzmin[0]) / (info->mx - 1);
+    hy = (xyzmax[1] - xyzmin[1]) / (info->my - 1);
+    hz = (xyzmax[2] - xyzmin[2]) / (info->mz - 1);
+    dvol = hx * hy * hz;
+    scx = user->cx * dvol / (hx*hx);
+    scy = user->cy * dvol / (hy*hy);
+    scz = user->cz * dvol / (hz*hz);
+    scdiag = 2.0 * (scx + scy + scz);
+    ierr = PoissonCacheGet(info->da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {
+        ierr = DMDAVecGetArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecGetArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    PoissonInteriorRange(info->xs,info->xm,info->mx,&ilo,&ihi);
+    PoissonInteriorRange(info->ys,info->ym,info->my,&jlo,&jhi);
+    PoissonInteriorRange(info->zs,info->zm,info->mz,&klo,&khi);
+    for (k = info->zs; k < info->zs + info->zm; k++) {
+        z = xyzmin[2] + k * hz;
+        for (j = info->ys; j < info->ys + info->ym; j++) {
+            y = xyzmin[1] + j * hy;
+            if (k < klo || k >= khi || j < jlo || j >= jhi) {
+                for (i = info->xs; i < info->xs + info->xm; i++) {
+                    x = xyzmin[0] + i * hx;
+                    aF[k][j][i] = Poisson3DPointResidual(info,au,ag,af,i,j,k,
+                                      x,y,z,hx,hy,hz,scx,scy,scz,dvol,user);
                 }
+                continue;
+            }
+            for (i = info->xs; i < ilo; i++) {
+                x = xyzmin[0] + i * hx;
+                aF[k][j][i] = Poisson3DPointResidual(info,au,ag,af,i,j,k,
+                                  x,y,z,hx,hy,hz,scx,scy,scz,dvol,user);
+            }
+            {
+                const PetscReal *PETSC_RESTRICT uc = au[k][j],
+                                *PETSC_RESTRICT us = au[k][j-1],
+                                *PETSC_RESTRICT un = au[k][j+1],
+                                *PETSC_RESTRICT ud = au[k-1][j],
+                                *PETSC_RESTRICT uu = au[k+1][j];
+                PetscReal       *PETSC_RESTRICT F = aF[k][j];
+                if (af) {
+                    const PetscReal *PETSC_RESTRICT fc = af[k][j];
+                    PetscPragmaSIMD
+                    for (i = ilo; i < ihi; i++) {
+                        F[i] = scdiag * uc[i] - scx * (uc[i-1] + uc[i+1])
+                               - scy * (us[i] + un[i]) - scz * (ud[i] + uu[i])
+                               - fc[i];
+                    }
+                } else {
+                    for (i = ilo; i < ihi; i++) {
+                        x = xyzmin[0] + i * hx;
+                        F[i] = - dvol * user->f_rhs(x,y,z,user);
+                    }
+                    PetscPragmaSIMD
+                    for (i = ilo; i < ihi; i++) {
+                        F[i] += scdiag * uc[i] - scx * (uc[i-1] + uc[i+1])
+                                - scy * (us[i] + un[i]) - scz * (ud[i] + uu[i]);
+                    }
+                }
+            }
+            for (i = ihi; i < info->xs + info->xm; i++) {
+                x = xyzmin[0] + i * hx;
+                aF[k][j][i] = Poisson3DPointResidual(info,au,ag,af,i,j,k,
+                                  x,y,z,hx,hy,hz,scx,scy,scz,dvol,user);
             }
         }
     }
+    if (ag) {
+        ierr = DMDAVecRestoreArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecRestoreArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
     ierr = PetscLogFlops(14.0*info->xm*info->ym*info->zm);CHKERRQ(ierr);
     return 0;
 }
@@ -123,9 +461,11 @@ PetscErrorCode Poisson1DJacobianLocal(DMDALocalInfo *info, PetscScalar *au,
     PetscInt     i,ncols;
     PetscReal    xmin[1], xmax[1], h, v[3];
     MatStencil   col[3],row;
+    StencilCSR   *csr;
 
     ierr = DMGetBoundingBox(info->da,xmin,xmax); CHKERRQ(ierr);
     h = (xmax[0] - xmin[0]) / (info->mx - 1);
+    ierr = StencilCSRBegin(info->da,Jpre,&csr); CHKERRQ(ierr);
     for (i = info->xs; i < info->xs+info->xm; i++) {
         row.i = i;
         col[0].i = i;
@@ -141,9 +481,10 @@ PetscErrorCode Poisson1DJacobianLocal(DMDALocalInfo *info, PetscScalar *au,
                 col[ncols].i = i+1;  v[ncols++] = - user->cx / h;
             }
         }
-        ierr = MatSetValuesStencil(Jpre,1,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
+        ierr = StencilCSRSetValues(csr,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
     }
 
+    ierr = StencilCSREnd(csr); CHKERRQ(ierr);
     ierr = MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     ierr = MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     if (J != Jpre) {
@@ -159,6 +500,7 @@ PetscErrorCode Poisson2DJacobianLocal(DMDALocalInfo *info, PetscScalar **au,
     PetscReal   xymin[2], xymax[2], hx, hy, scx, scy, scdiag, v[5];
     PetscInt    i,j,ncols;
     MatStencil  col[5],row;
+    StencilCSR  *csr;
 
     ierr = DMGetBoundingBox(info->da,xymin,xymax); CHKERRQ(ierr);
     hx = (xymax[0] - xymin[0]) / (info->mx - 1);
@@ -166,6 +508,7 @@ PetscErrorCode Poisson2DJacobianLocal(DMDALocalInfo *info, PetscScalar **au,
     scx = user->cx * hy / hx;
     scy = user->cy * hx / hy;
     scdiag = 2.0 * (scx + scy);
+    ierr = StencilCSRBegin(info->da,Jpre,&csr); CHKERRQ(ierr);
     for (j = info->ys; j < info->ys+info->ym; j++) {
         row.j = j;
         col[0].j = j;
@@ -184,10 +527,11 @@ PetscErrorCode Poisson2DJacobianLocal(DMDALocalInfo *info, PetscScalar **au,
                 if (j+1 < info->my-1) {
                     col[ncols].j = j+1;  col[ncols].i = i;    v[ncols++] = - scy;  }
             }
-            ierr = MatSetValuesStencil(Jpre,1,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
+            ierr = StencilCSRSetValues(csr,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
         }
     }
 
+    ierr = StencilCSREnd(csr); CHKERRQ(ierr);
     ierr = MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     ierr = MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     if (J != Jpre) {
@@ -203,6 +547,7 @@ PetscErrorCode Poisson3DJacobianLocal(DMDALocalInfo *info, PetscScalar ***au,
     PetscReal   xyzmin[3], xyzmax[3], hx, hy, hz, dvol, scx, scy, scz, scdiag, v[7];
     PetscInt    i,j,k,ncols;
     MatStencil  col[7],row;
+    StencilCSR  *csr;
 
     ierr = DMGetBoundingBox(info->da,xyzmin,xyzmax); CHKERRQ(ierr);
     hx = (xyzmax[0] - xyzmin[0]) / (info->mx - 1);
@@ -213,6 +558,7 @@ PetscErrorCode Poisson3DJacobianLocal(DMDALocalInfo *info, PetscScalar ***au,
     scy = user->cy * dvol / (hy*hy);
     scz = user->cz * dvol / (hz*hz);
     scdiag = 2.0 * (scx + scy + scz);
+    ierr = StencilCSRBegin(info->da,Jpre,&csr); CHKERRQ(ierr);
     for (k = info->zs; k < info->zs+info->zm; k++) {
         row.k = k;
         col[0].k = k;
@@ -250,10 +596,11 @@ PetscErrorCode Poisson3DJacobianLocal(DMDALocalInfo *info, PetscScalar ***au,
                         v[ncols++] = - scz;
                     }
                 }
-                ierr = MatSetValuesStencil(Jpre,1,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
+                ierr = StencilCSRSetValues(csr,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
             }
         }
     }
+    ierr = StencilCSREnd(csr); CHKERRQ(ierr);
     ierr = MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     ierr = MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     if (J != Jpre) {
@@ -263,19 +610,1692 @@ PetscErrorCode Poisson3DJacobianLocal(DMDALocalInfo *info, PetscScalar ***au,
     return 0;
 }
 
+// the stencil coefficients sc[0],...,sc[dim-1] multiply neighbor values
+// in PoissonXDJacobianLocal(); the diagonal entry is 2 (sc[0]+...)
+static PetscErrorCode PoissonStencilScalings(DM da, DMDALocalInfo *info,
+                                             PoissonCtx *user, PetscReal sc[3]) {
+    PetscErrorCode ierr;
+    PetscReal  xyzmin[3], xyzmax[3], hx, hy, hz, dvol;
+    ierr = DMGetBoundingBox(da,xyzmin,xyzmax); CHKERRQ(ierr);
+    hx = (xyzmax[0] - xyzmin[0]) / (info->mx - 1);
+    sc[0] = 0.0;  sc[1] = 0.0;  sc[2] = 0.0;
+    switch (info->dim) {
+        case 1:
+            sc[0] = user->cx / hx;
+            break;
+        case 2:
+            hy = (xyzmax[1] - xyzmin[1]) / (info->my - 1);
+            sc[0] = user->cx * hy / hx;
+            sc[1] = user->cy * hx / hy;
+            break;
+        case 3:
+            hy = (xyzmax[1] - xyzmin[1]) / (info->my - 1);
+            hz = (xyzmax[2] - xyzmin[2]) / (info->mz - 1);
+            dvol = hx * hy * hz;
+            sc[0] = user->cx * dvol / (hx*hx);
+            sc[1] = user->cy * dvol / (hy*hy);
+            sc[2] = user->cz * dvol / (hz*hz);
+            break;
+        default:
+            SETERRQ(PETSC_COMM_SELF,6,"invalid dim from DMDALocalInfo\n");
+    }
+    return 0;
+}
+
+// as in the Jacobian, boundary rows are diagonal and there is no coupling
+// to boundary values
+static PetscReal Poisson2DPointMult(DMDALocalInfo *info, PetscReal **ax,
+        PetscInt i, PetscInt j, PetscReal scx, PetscReal scy) {
+    PetscReal  v = 2.0 * (scx + scy) * ax[j][i];
+    if (i==0 || i==info->mx-1 || j==0 || j==info->my-1)
+        return v;
+    if (i-1 > 0)          v -= scx * ax[j][i-1];
+    if (i+1 < info->mx-1) v -= scx * ax[j][i+1];
+    if (j-1 > 0)          v -= scy * ax[j-1][i];
+    if (j+1 < info->my-1) v -= scy * ax[j+1][i];
+    return v;
+}
+
+static PetscReal Poisson3DPointMult(DMDALocalInfo *info, PetscReal ***ax,
+        PetscInt i, PetscInt j, PetscInt k,
+        PetscReal scx, PetscReal scy, PetscReal scz) {
+    PetscReal  v = 2.0 * (scx + scy + scz) * ax[k][j][i];
+    if (   i==0 || i==info->mx-1
+        || j==0 || j==info->my-1
+        || k==0 || k==info->mz-1)
+        return v;
+    if (i-1 > 0)          v -= scx * ax[k][j][i-1];
+    if (i+1 < info->mx-1) v -= scx * ax[k][j][i+1];
+    if (j-1 > 0)          v -= scy * ax[k][j-1][i];
+    if (j+1 < info->my-1) v -= scy * ax[k][j+1][i];
+    if (k-1 > 0)          v -= scz * ax[k-1][j][i];
+    if (k+1 < info->mz-1) v -= scz * ax[k+1][j][i];
+    return v;
+}
+
+// y = A x for local (ghosted) ax and global ay; see PoissonInteriorRange()
+// for the split into strips and deep interior rows
+static void Poisson1DMultLocal(DMDALocalInfo *info, PetscReal *ax,
+                               PetscReal *ay, const PetscReal sc[3]) {
+    PetscInt  i;
+    for (i = info->xs; i < info->xs + info->xm; i++) {
+        ay[i] = 2.0 * sc[0] * ax[i];
+        if (i==0 || i==info->mx-1)
+            continue;
+        if (i-1 > 0)          ay[i] -= sc[0] * ax[i-1];
+        if (i+1 < info->mx-1) ay[i] -= sc[0] * ax[i+1];
+    }
+}
+
+static void Poisson2DMultLocal(DMDALocalInfo *info, PetscReal **ax,
+                               PetscReal **ay, const PetscReal sc[3]) {
+    const PetscReal scx = sc[0], scy = sc[1], scdiag = 2.0 * (scx + scy);
+    PetscInt  i, j, ilo, ihi, jlo, jhi;
+    PoissonInteriorRange(info->xs,info->xm,info->mx,&ilo,&ihi);
+    PoissonInteriorRange(info->ys,info->ym,info->my,&jlo,&jhi);
+    for (j = info->ys; j < info->ys + info->ym; j++) {
+        if (j < jlo || j >= jhi) {
+            for (i = info->xs; i < info->xs + info->xm; i++)
+                ay[j][i] = Poisson2DPointMult(info,ax,i,j,scx,scy);
+            continue;
+        }
+        for (i = info->xs; i < ilo; i++)
+            ay[j][i] = Poisson2DPointMult(info,ax,i,j,scx,scy);
+        {
+            const PetscReal *PETSC_RESTRICT xc = ax[j],
+                            *PETSC_RESTRICT xs = ax[j-1],
+                            *PETSC_RESTRICT xn = ax[j+1];
+            PetscReal       *PETSC_RESTRICT y = ay[j];
+            PetscPragmaSIMD
+            for (i = ilo; i < ihi; i++) {
+                y[i] = scdiag * xc[i] - scx * (xc[i-1] + xc[i+1])
+                                      - scy * (xs[i] + xn[i]);
+            }
+        }
+        for (i = ihi; i < info->xs + info->xm; i++)
+            ay[j][i] = Poisson2DPointMult(info,ax,i,j,scx,scy);
+    }
+}
+
+static void Poisson3DMultLocal(DMDALocalInfo *info, PetscReal ***ax,
+                               PetscReal ***ay, const PetscReal sc[3]) {
+    const PetscReal scx = sc[0], scy = sc[1], scz = sc[2],
+                    scdiag = 2.0 * (scx + scy + scz);
+    PetscInt  i, j, k, ilo, ihi, jlo, jhi, klo, khi;
+    PoissonInteriorRange(info->xs,info->xm,info->mx,&ilo,&ihi);
+    PoissonInteriorRange(info->ys,info->ym,info->my,&jlo,&jhi);
+    PoissonInteriorRange(info->zs,info->zm,info->mz,&klo,&khi);
+    for (k = info->zs; k < info->zs + info->zm; k++) {
+        for (j = info->ys; j < info->ys + info->ym; j++) {
+            if (k < klo || k >= khi || j < jlo || j >= jhi) {
+                for (i = info->xs; i < info->xs + info->xm; i++)
+                    ay[k][j][i] = Poisson3DPointMult(info,ax,i,j,k,scx,scy,scz);
+                continue;
+            }
+            for (i = info->xs; i < ilo; i++)
+                ay[k][j][i] = Poisson3DPointMult(info,ax,i,j,k,scx,scy,scz);
+            {
+                const PetscReal *PETSC_RESTRICT xc = ax[k][j],
+                                *PETSC_RESTRICT xs = ax[k][j-1],
+                                *PETSC_RESTRICT xn = ax[k][j+1],
+                                *PETSC_RESTRICT xd = ax[k-1][j],
+                                *PETSC_RESTRICT xu = ax[k+1][j];
+                PetscReal       *PETSC_RESTRICT y = ay[k][j];
+                PetscPragmaSIMD
+                for (i = ilo; i < ihi; i++) {
+                    y[i] = scdiag * xc[i] - scx * (xc[i-1] + xc[i+1])
+                           - scy * (xs[i] + xn[i]) - scz * (xd[i] + xu[i]);
+                }
+            }
+            for (i = ihi; i < info->xs + info->xm; i++)
+                ay[k][j][i] = Poisson3DPointMult(info,ax,i,j,k,scx,scy,scz);
+        }
+    }
+}
+
+static PetscErrorCode PoissonMatMult(Mat A, Vec x, Vec y) {
+    PetscErrorCode ierr;
+    DM             da;
+    DMDALocalInfo  info;
+    PoissonCtx     *user;
+    Vec            xloc;
+    PetscReal      sc[3];
+    void           *ax, *ay;
+
+    ierr = MatGetDM(A,&da); CHKERRQ(ierr);
+    ierr = MatShellGetContext(A,&user); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = PoissonStencilScalings(da,&info,user,sc); CHKERRQ(ierr);
+    ierr = DMGetLocalVector(da,&xloc); CHKERRQ(ierr);
+    ierr = DMGlobalToLocalBegin(da,x,INSERT_VALUES,xloc); CHKERRQ(ierr);
+    ierr = DMGlobalToLocalEnd(da,x,INSERT_VALUES,xloc); CHKERRQ(ierr);
+    ierr = DMDAVecGetArrayRead(da,xloc,&ax); CHKERRQ(ierr);
+    ierr = DMDAVecGetArray(da,y,&ay); CHKERRQ(ierr);
+    switch (info.dim) {
+        case 1:
+            Poisson1DMultLocal(&info,(PetscReal*)ax,(PetscReal*)ay,sc);
+            ierr = PetscLogFlops(4.0*info.xm); CHKERRQ(ierr);
+            break;
+        case 2:
+            Poisson2DMultLocal(&info,(PetscReal**)ax,(PetscReal**)ay,sc);
+            ierr = PetscLogFlops(7.0*info.xm*info.ym); CHKERRQ(ierr);
+            break;
+        case 3:
+            Poisson3DMultLocal(&info,(PetscReal***)ax,(PetscReal***)ay,sc);
+            ierr = PetscLogFlops(10.0*info.xm*info.ym*info.zm); CHKERRQ(ierr);
+            break;
+        default:
+            SETERRQ(PETSC_COMM_SELF,6,"invalid dim from DMDALocalInfo\n");
+    }
+    ierr = DMDAVecRestoreArrayRead(da,xloc,&ax); CHKERRQ(ierr);
+    ierr = DMDAVecRestoreArray(da,y,&ay); CHKERRQ(ierr);
+    ierr = DMRestoreLocalVector(da,&xloc); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode PoissonMatGetDiagonal(Mat A, Vec d) {
+    PetscErrorCode ierr;
+    DM             da;
+    DMDALocalInfo  info;
+    PoissonCtx     *user;
+    PetscReal      sc[3];
+    ierr = MatGetDM(A,&da); CHKERRQ(ierr);
+    ierr = MatShellGetContext(A,&user); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = PoissonStencilScalings(da,&info,user,sc); CHKERRQ(ierr);
+    ierr = VecSet(d,2.0 * (sc[0] + sc[1] + sc[2])); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode PoissonMatCreateShell(DM da, Mat *A) {
+    PetscErrorCode ierr;
+    PoissonCtx     *user;
+    Vec            v;
+    PetscInt       n, N;
+    ierr = DMGetApplicationContext(da,&user); CHKERRQ(ierr);
+    ierr = DMGetGlobalVector(da,&v); CHKERRQ(ierr);
+    ierr = VecGetLocalSize(v,&n); CHKERRQ(ierr);
+    ierr = VecGetSize(v,&N); CHKERRQ(ierr);
+    ierr = DMRestoreGlobalVector(da,&v); CHKERRQ(ierr);
+    ierr = MatCreateShell(PetscObjectComm((PetscObject)da),n,n,N,N,user,A); CHKERRQ(ierr);
+    ierr = MatSetDM(*A,da); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A,MATOP_MULT,
+                                (void(*)(void))PoissonMatMult); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A,MATOP_MULT_TRANSPOSE,
+                                (void(*)(void))PoissonMatMult); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A,MATOP_GET_DIAGONAL,
+                                (void(*)(void))PoissonMatGetDiagonal); CHKERRQ(ierr);
+    ierr = MatSetOption(*A,MAT_SYMMETRIC,PETSC_TRUE); CHKERRQ(ierr);
+    return 0;
+}
+
+/* Weights w[c][b][a], for neighbor offsets (a-1,b-1,c-1), of the compact
+fourth-order stencil.  Each pair of directions d,e adds the scaled cross
+difference  -(sc[d]+sc[e])/12 hd^2 he^2 D_d^2 D_e^2  to the second-order
+stencil, which is the 9-point (2D) or 19-point (3D) Mehrstellen stencil
+when cells are square.  In 1D it is the usual 3-point stencil.            */
+static void PoissonCompactWeights(PetscInt dim, const PetscReal sc[3],
+                                  PetscReal w[3][3][3]) {
+    PetscInt  d, e, a, b, c, o[3];
+    PetscReal p;
+    for (c = 0; c < 3; c++)
+        for (b = 0; b < 3; b++)
+            for (a = 0; a < 3; a++)
+                w[c][b][a] = 0.0;
+    w[1][1][1] = 2.0 * (sc[0] + sc[1] + sc[2]);
+    for (d = 0; d < dim; d++) {
+        for (a = 0; a < 3; a += 2) {
+            o[0] = 1;  o[1] = 1;  o[2] = 1;  o[d] = a;
+            w[o[2]][o[1]][o[0]] -= sc[d];
+        }
+        for (e = d+1; e < dim; e++) {
+            p = (sc[d] + sc[e]) / 12.0;
+            w[1][1][1] -= 4.0 * p;
+            for (a = 0; a < 3; a += 2) {
+                o[0] = 1;  o[1] = 1;  o[2] = 1;  o[d] = a;
+                w[o[2]][o[1]][o[0]] += 2.0 * p;
+                o[d] = 1;  o[e] = a;
+                w[o[2]][o[1]][o[0]] += 2.0 * p;
+                for (b = 0; b < 3; b += 2) {
+                    o[d] = a;  o[e] = b;
+                    w[o[2]][o[1]][o[0]] -= p;
+                }
+            }
+        }
+    }
+}
+
+// the right side of the compact scheme is  dvol (f + sum_d hd^2 D_d^2 f / 12),
+// i.e. a weighted average of f at the point and its 2 dim face neighbors
+#define COMPACT_FCENTER(dim) (1.0 - (dim) / 6.0)
+#define COMPACT_FFACE        (1.0 / 12.0)
+
+PetscErrorCode Poisson1DCompactFunctionLocal(DMDALocalInfo *info, PetscReal *au,
+                                             PetscReal *aF, PoissonCtx *user) {
+    PetscErrorCode ierr;
+    PetscInt   i;
+    PetscReal  xmax[1], xmin[1], h, x, ue, uw, fc, fe, fw,
+               *ag = NULL, *af = NULL;
+    Vec        gcache, fcache;
+    ierr = DMGetBoundingBox(info->da,xmin,xmax); CHKERRQ(ierr);
+    h = (xmax[0] - xmin[0]) / (info->mx - 1);
+    ierr = PoissonCacheGet(info->da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {
+        ierr = DMDAVecGetArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecGetArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    for (i = info->xs; i < info->xs + info->xm; i++) {
+        x = xmin[0] + i * h;
+        if (i==0 || i==info->mx-1) {
+            aF[i] = au[i] - (ag ? ag[i] : user->g_bdry(x,0.0,0.0,user));
+            aF[i] *= user->cx * (2.0 / h);
+        } else {
+            ue = (i+1 == info->mx-1) ? (ag ? ag[i+1] : user->g_bdry(x+h,0.0,0.0,user))
+                                     : au[i+1];
+            uw = (i-1 == 0)          ? (ag ? ag[i-1] : user->g_bdry(x-h,0.0,0.0,user))
+                                     : au[i-1];
+            fc = af ? af[i]   : h * user->f_rhs(x,0.0,0.0,user);
+            fe = af ? af[i+1] : h * user->f_rhs(x+h,0.0,0.0,user);
+            fw = af ? af[i-1] : h * user->f_rhs(x-h,0.0,0.0,user);
+            aF[i] = user->cx * (2.0 * au[i] - uw - ue) / h
+                    - COMPACT_FCENTER(1) * fc - COMPACT_FFACE * (fe + fw);
+        }
+    }
+    if (ag) {
+        ierr = DMDAVecRestoreArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecRestoreArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    ierr = PetscLogFlops(13.0*info->xm);CHKERRQ(ierr);
+    return 0;
+}
+
+// value of u at a stencil neighbor, from g_bdry() if it is a boundary point
+static PetscReal Poisson2DCompactU(DMDALocalInfo *info, PetscReal **au,
+        PetscReal **ag, PetscInt i, PetscInt j, PetscReal x, PetscReal y,
+        PoissonCtx *user) {
+    if (i==0 || i==info->mx-1 || j==0 || j==info->my-1)
+        return ag ? ag[j][i] : user->g_bdry(x,y,0.0,user);
+    return au[j][i];
+}
+
+PetscErrorCode Poisson2DCompactFunctionLocal(DMDALocalInfo *info, PetscReal **au,
+                                             PetscReal **aF, PoissonCtx *user) {
+    PetscErrorCode ierr;
+    PetscInt   i, j, a, b;
+    PetscReal  xymin[2], xymax[2], hx, hy, darea, sc[3], w[3][3][3], x, y,
+               F, fnbr, **ag = NULL, **af = NULL;
+    Vec        gcache, fcache;
+    ierr = DMGetBoundingBox(info->da,xymin,xymax); CHKERRQ(ierr);
+    hx = (xymax[0] - xymin[0]) / (info->mx - 1);
+    hy = (xymax[1] - xymin[1]) / (info->my - 1);
+    darea = hx * hy;
+    ierr = PoissonStencilScalings(info->da,info,user,sc); CHKERRQ(ierr);
+    PoissonCompactWeights(2,sc,w);
+    ierr = PoissonCacheGet(info->da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {
+        ierr = DMDAVecGetArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecGetArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    for (j = info->ys; j < info->ys + info->ym; j++) {
+        y = xymin[1] + j * hy;
+        for (i = info->xs; i < info->xs + info->xm; i++) {
+            x = xymin[0] + i * hx;
+            if (i==0 || i==info->mx-1 || j==0 || j==info->my-1) {
+                aF[j][i] = w[1][1][1] * (au[j][i]
+                           - (ag ? ag[j][i] : user->g_bdry(x,y,0.0,user)));
+                continue;
+            }
+            F = 0.0;
+            for (b = -1; b <= 1; b++) {
+                for (a = -1; a <= 1; a++) {
+                    F += w[1][b+1][a+1] * Poisson2DCompactU(info,au,ag,i+a,j+b,
+                                              x+a*hx,y+b*hy,user);
+                }
+            }
+            if (af) {
+                F -= COMPACT_FCENTER(2) * af[j][i]
+                     + COMPACT_FFACE * (af[j][i-1] + af[j][i+1] + af[j-1][i] + af[j+1][i]);
+            } else {
+                fnbr =   user->f_rhs(x-hx,y,0.0,user) + user->f_rhs(x+hx,y,0.0,user)
+                       + user->f_rhs(x,y-hy,0.0,user) + user->f_rhs(x,y+hy,0.0,user);
+                F -= darea * (COMPACT_FCENTER(2) * user->f_rhs(x,y,0.0,user)
+                              + COMPACT_FFACE * fnbr);
+            }
+            aF[j][i] = F;
+        }
+    }
+    if (ag) {
+        ierr = DMDAVecRestoreArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecRestoreArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    ierr = PetscLogFlops(26.0*info->xm*info->ym);CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscReal Poisson3DCompactU(DMDALocalInfo *info, PetscReal ***au,
+        PetscReal ***ag, PetscInt i, PetscInt j, PetscInt k, PetscReal x,
+        PetscReal y, PetscReal z, PoissonCtx *user) {
+    if (   i==0 || i==info->mx-1
+        || j==0 || j==info->my-1
+        || k==0 || k==info->mz-1)
+        return ag ? ag[k][j][i] : user->g_bdry(x,y,z,user);
+    return au[k][j][i];
+}
+
+PetscErrorCode Poisson3DCompactFunctionLocal(DMDALocalInfo *info, PetscReal ***au,
+                                             PetscReal ***aF, PoissonCtx *user) {
+    PetscErrorCode ierr;
+    PetscInt   i, j, k, a, b, c;
+    PetscReal  xyzmin[3], xyzmax[3], hx, hy, hz, dvol, sc[3], w[3][3][3],
+               x, y, z, F, fnbr, ***ag = NULL, ***af = NULL;
+    Vec        gcache, fcache;
+    ierr = DMGetBoundingBox(info->da,xyzmin,xyzmax); CHKERRQ(ierr);
+    hx = (xyzmax[0] - xyzmin[0]) / (info->mx - 1);
+    hy = (xyzmax[1] - xyzmin[1]) / (info->my - 1);
+    hz = (xyzmax[2] - xyzmin[2]) / (info->mz - 1);
+    dvol = hx * hy * hz;
+    ierr = PoissonStencilScalings(info->da,info,user,sc); CHKERRQ(ierr);
+    PoissonCompactWeights(3,sc,w);
+    ierr = PoissonCacheGet(info->da,&gcache,&fcache); CHKERRQ(ierr);
+    if (gcache && fcache) {
+        ierr = DMDAVecGetArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecGetArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    for (k = info->zs; k < info->zs + info->zm; k++) {
+        z = xyzmin[2] + k * hz;
+        for (j = info->ys; j < info->ys + info->ym; j++) {
+            y = xyzmin[1] + j * hy;
+            for (i = info->xs; i < info->xs + info->xm; i++) {
+                x = xyzmin[0] + i * hx;
+                if (   i==0 || i==info->mx-1
+                    || j==0 || j==info->my-1
+                    || k==0 || k==info->mz-1) {
+                    aF[k][j][i] = w[1][1][1] * (au[k][j][i]
+                                  - (ag ? ag[k][j][i] : user->g_bdry(x,y,z,user)));
+                    continue;
+                }
+                F = 0.0;
+                for (c = -1; c <= 1; c++) {
+                    for (b = -1; b <= 1; b++) {
+                        for (a = -1; a <= 1; a++) {
+                            if (a != 0 && b != 0 && c != 0)  // no cube corners
+                                continue;
+                            F += w[c+1][b+1][a+1]
+                                 * Poisson3DCompactU(info,au,ag,i+a,j+b,k+c,
+                                       x+a*hx,y+b*hy,z+c*hz,user);
+                        }
+                    }
+                }
+                if (af) {
+                    F -= COMPACT_FCENTER(3) * af[k][j][i]
+                         + COMPACT_FFACE * (  af[k][j][i-1] + af[k][j][i+1]
+                                            + af[k][j-1][i] + af[k][j+1][i]
+                                            + af[k-1][j][i] + af[k+1][j][i]);
+                } else {
+                    fnbr =   user->f_rhs(x-hx,y,z,user) + user->f_rhs(x+hx,y,z,user)
+                           + user->f_rhs(x,y-hy,z,user) + user->f_rhs(x,y+hy,z,user)
+                           + user->f_rhs(x,y,z-hz,user) + user->f_rhs(x,y,z+hz,user);
+                    F -= dvol * (COMPACT_FCENTER(3) * user->f_rhs(x,y,z,user)
+                                 + COMPACT_FFACE * fnbr);
+                }
+                aF[k][j][i] = F;
+            }
+        }
+    }
+    if (ag) {
+        ierr = DMDAVecRestoreArrayRead(info->da,gcache,&ag); CHKERRQ(ierr);
+        ierr = DMDAVecRestoreArrayRead(info->da,fcache,&af); CHKERRQ(ierr);
+    }
+    ierr = PetscLogFlops(54.0*info->xm*info->ym*info->zm);CHKERRQ(ierr);
+    return 0;
+}
+#undef COMPACT_FCENTER
+#undef COMPACT_FFACE
+
+PetscErrorCode Poisson2DCompactJacobianLocal(DMDALocalInfo *info, PetscScalar **au,
+                                             Mat J, Mat Jpre, PoissonCtx *user) {
+    PetscErrorCode  ierr;
+    PetscReal   sc[3], w[3][3][3], v[9];
+    PetscInt    i, j, a, b, ncols;
+    MatStencil  col[9], row;
+    StencilCSR  *csr;
+
+    ierr = PoissonStencilScalings(info->da,info,user,sc); CHKERRQ(ierr);
+    PoissonCompactWeights(2,sc,w);
+    ierr = StencilCSRBegin(info->da,Jpre,&csr); CHKERRQ(ierr);
+    for (j = info->ys; j < info->ys+info->ym; j++) {
+        row.j = j;
+        for (i = info->xs; i < info->xs+info->xm; i++) {
+            row.i = i;
+            if (i==0 || i==info->mx-1 || j==0 || j==info->my-1) {
+                col[0].j = j;  col[0].i = i;  v[0] = w[1][1][1];
+                ncols = 1;
+            } else {
+                ncols = 0;
+                for (b = -1; b <= 1; b++) {
+                    if (j+b == 0 || j+b == info->my-1)
+                        continue;
+                    for (a = -1; a <= 1; a++) {
+                        if (i+a == 0 || i+a == info->mx-1)
+                            continue;
+                        col[ncols].j = j+b;  col[ncols].i = i+a;
+                        v[ncols++] = w[1][b+1][a+1];
+                    }
+                }
+            }
+            ierr = StencilCSRSetValues(csr,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
+        }
+    }
+
+    ierr = StencilCSREnd(csr); CHKERRQ(ierr);
+    ierr = MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    if (J != Jpre) {
+        ierr = MatAssemblyBegin(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+        ierr = MatAssemblyEnd(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PetscErrorCode Poisson3DCompactJacobianLocal(DMDALocalInfo *info, PetscScalar ***au,
+                                             Mat J, Mat Jpre, PoissonCtx *user) {
+    PetscErrorCode  ierr;
+    PetscReal   sc[3], w[3][3][3], v[19];
+    PetscInt    i, j, k, a, b, c, ncols;
+    MatStencil  col[19], row;
+    StencilCSR  *csr;
+
+    ierr = PoissonStencilScalings(info->da,info,user,sc); CHKERRQ(ierr);
+    PoissonCompactWeights(3,sc,w);
+    ierr = StencilCSRBegin(info->da,Jpre,&csr); CHKERRQ(ierr);
+    for (k = info->zs; k < info->zs+info->zm; k++) {
+        row.k = k;
+        for (j = info->ys; j < info->ys+info->ym; j++) {
+            row.j = j;
+            for (i = info->xs; i < info->xs+info->xm; i++) {
+                row.i = i;
+                if (   i==0 || i==info->mx-1
+                    || j==0 || j==info->my-1
+                    || k==0 || k==info->mz-1) {
+                    col[0].k = k;  col[0].j = j;  col[0].i = i;  v[0] = w[1][1][1];
+                    ncols = 1;
+                } else {
+                    ncols = 0;
+                    for (c = -1; c <= 1; c++) {
+                        if (k+c == 0 || k+c == info->mz-1)
+                            continue;
+                        for (b = -1; b <= 1; b++) {
+                            if (j+b == 0 || j+b == info->my-1)
+                                continue;
+                            for (a = -1; a <= 1; a++) {
+                                if (i+a == 0 || i+a == info->mx-1)
+                                    continue;
+                                if (a != 0 && b != 0 && c != 0)
+                                    continue;
+                                col[ncols].k = k+c;  col[ncols].j = j+b;  col[ncols].i = i+a;
+                                v[ncols++] = w[c+1][b+1][a+1];
+                            }
+                        }
+                    }
+                }
+                ierr = StencilCSRSetValues(csr,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
+            }
+        }
+    }
+
+    ierr = StencilCSREnd(csr); CHKERRQ(ierr);
+    ierr = MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    if (J != Jpre) {
+        ierr = MatAssemblyBegin(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+        ierr = MatAssemblyEnd(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+// context for the PCSHELL from PoissonPCShellSetBlockSmoother()
+typedef struct {
+    PoissonSweepType type;
+    PetscInt   sweeps, tile,
+               width,       // ghost width of dadeep, = stages per round
+               bsize;       // allocated length of each tile buffer
+    PetscReal  omega,
+               sc[3];       // from PoissonStencilScalings()
+    DM         da,          // not referenced; from the operator
+               dadeep;      // same layout as da but BOX stencil of width
+    Vec        yloc, rloc;  // local Vecs on dadeep
+    PetscReal  *ya, *yb, *rb;  // tile buffers
+} BlockSmoother;
+
+static PetscErrorCode BlockSmootherReset(BlockSmoother *bs) {
+    PetscErrorCode ierr;
+    ierr = VecDestroy(&(bs->yloc)); CHKERRQ(ierr);
+    ierr = VecDestroy(&(bs->rloc)); CHKERRQ(ierr);
+    ierr = DMDestroy(&(bs->dadeep)); CHKERRQ(ierr);
+    ierr = PetscFree3(bs->ya,bs->yb,bs->rb); CHKERRQ(ierr);
+    bs->bsize = 0;
+    return 0;
+}
+
+static PetscErrorCode BlockSmootherSetUp(PC pc) {
+    PetscErrorCode ierr;
+    BlockSmoother  *bs;
+    Mat            P;
+    DM             da;
+    PoissonCtx     *user;
+    DMDALocalInfo  info;
+    const PetscInt *lx, *ly, *lz;
+    PetscInt       m, n, p, stages, w, ext[3], d;
+    MPI_Comm       comm;
+
+    ierr = PCShellGetContext(pc,(void**)&bs); CHKERRQ(ierr);
+    ierr = PCGetOperators(pc,NULL,&P); CHKERRQ(ierr);
+    ierr = MatGetDM(P,&da); CHKERRQ(ierr);
+    if (!da) {
+        ierr = PCGetDM(pc,&da); CHKERRQ(ierr);
+    }
+    if (!da) {
+        SETERRQ(PETSC_COMM_SELF,7,"block smoother needs a DMDA from the operator or the PC\n");
+    }
+    ierr = BlockSmootherReset(bs); CHKERRQ(ierr);
+    bs->da = da;
+    ierr = DMGetApplicationContext(da,&user); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = PoissonStencilScalings(da,&info,user,bs->sc); CHKERRQ(ierr);
+
+    // one stage shrinks the valid region by one layer; red-black sweeps
+    // are two stages; width is reduced if a process owns too few points
+    stages = (bs->type == SWEEP_REDBLACK) ? 2 * bs->sweeps : bs->sweeps;
+    w = PetscMin(stages,info.xm);
+    if (info.dim > 1)  w = PetscMin(w,info.ym);
+    if (info.dim > 2)  w = PetscMin(w,info.zm);
+    ierr = PetscObjectGetComm((PetscObject)da,&comm); CHKERRQ(ierr);
+    ierr = MPI_Allreduce(MPI_IN_PLACE,&w,1,MPIU_INT,MPI_MIN,comm); CHKERRQ(ierr);
+    bs->width = PetscMax(w,1);
+
+    ierr = DMDAGetInfo(da,NULL,NULL,NULL,NULL,&m,&n,&p,
+                       NULL,NULL,NULL,NULL,NULL,NULL); CHKERRQ(ierr);
+    ierr = DMDAGetOwnershipRanges(da,&lx,&ly,&lz); CHKERRQ(ierr);
+    switch (info.dim) {
+        case 1:
+            ierr = DMDACreate1d(comm,DM_BOUNDARY_NONE,info.mx,1,bs->width,
+                                lx,&(bs->dadeep)); CHKERRQ(ierr);
+            break;
+        case 2:
+            ierr = DMDACreate2d(comm,DM_BOUNDARY_NONE,DM_BOUNDARY_NONE,
+                                DMDA_STENCIL_BOX,info.mx,info.my,m,n,1,bs->width,
+                                lx,ly,&(bs->dadeep)); CHKERRQ(ierr);
+            break;
+        case 3:
+            ierr = DMDACreate3d(comm,DM_BOUNDARY_NONE,DM_BOUNDARY_NONE,
+                                DM_BOUNDARY_NONE,DMDA_STENCIL_BOX,
+                                info.mx,info.my,info.mz,m,n,p,1,bs->width,
+                                lx,ly,lz,&(bs->dadeep)); CHKERRQ(ierr);
+            break;
+        default:
+            SETERRQ(PETSC_COMM_SELF,6,"invalid dim from DMDALocalInfo\n");
+    }
+    ierr = DMSetUp(bs->dadeep); CHKERRQ(ierr);
+    ierr = DMCreateLocalVector(bs->dadeep,&(bs->yloc)); CHKERRQ(ierr);
+    ierr = VecDuplicate(bs->yloc,&(bs->rloc)); CHKERRQ(ierr);
+
+    // a tile is whole x-rows by (at most) tile points in y and z, plus
+    // width ghosts and one zero padding layer on each side
+    ext[0] = info.xm;  ext[1] = 1;  ext[2] = 1;
+    if (info.dim > 1)  ext[1] = PetscMin(bs->tile,info.ym);
+    if (info.dim > 2)  ext[2] = PetscMin(bs->tile,info.zm);
+    bs->bsize = 1;
+    for (d = 0; d < 3; d++) {
+        bs->bsize *= ext[d] + 2 + ((d < info.dim) ? 2 * bs->width : 0);
+    }
+    ierr = PetscMalloc3(bs->bsize,&(bs->ya),bs->bsize,&(bs->yb),
+                        bs->bsize,&(bs->rb)); CHKERRQ(ierr);
+    return 0;
+}
+
+/* One round of the smoother on one tile T = [t0[d],t1[d]), within the owned
+range, does ns stages in cache-resident buffers.  The buffers hold the
+region R_0, which is T expanded by ns in each direction and clipped to the
+grid, plus one padding layer.  Stage t updates the interior (non-boundary)
+points of T expanded by ns-t, so the last stage updates T itself.  Boundary
+points are zero in the buffers because the operator has no coupling to them;
+their (decoupled) values are set at the end.                              */
+static PetscErrorCode BlockSmootherTile(BlockSmoother *bs, DMDALocalInfo *info,
+        DMDALocalInfo *deep, PetscInt ns, PetscInt stage0, PetscBool zeroinit,
+        const PetscReal *ay, const PetscReal *ar, PetscReal *aynew,
+        const PetscInt t0[3], const PetscInt t1[3]) {
+    const PetscInt  M[3] = {info->mx, info->my, info->mz},
+                    g0[3] = {deep->gxs, deep->gys, deep->gzs},
+                    gm[3] = {deep->gxm, deep->gym, deep->gzm},
+                    o0[3] = {info->xs, info->ys, info->zs},
+                    om[3] = {info->xm, info->ym, info->zm};
+    const PetscReal scx = bs->sc[0], scy = bs->sc[1], scz = bs->sc[2],
+                    diag = 2.0 * (scx + scy + scz), om1 = bs->omega / diag;
+    PetscErrorCode ierr;
+    PetscInt  R0[3], R1[3], lo[3], hi[3], bx, bxy, i, j, k, t, d, q, c;
+    PetscReal *src = bs->ya, *dst = bs->yb, *tmp, bfactor;
+
+    for (d = 0; d < 3; d++) {
+        if (d < info->dim) {
+            R0[d] = PetscMax(t0[d] - ns, 0);
+            R1[d] = PetscMin(t1[d] + ns, M[d]);
+        } else {
+            R0[d] = 0;  R1[d] = 1;
+        }
+    }
+    bx = R1[0] - R0[0] + 2;
+    bxy = bx * (R1[1] - R0[1] + 2);
+#define BIDX(i,j,k) ((((k)-R0[2]+1)*bxy) + (((j)-R0[1]+1)*bx) + ((i)-R0[0]+1))
+#define GIDX(i,j,k) ((((k)-g0[2])*gm[1] + ((j)-g0[1]))*gm[0] + ((i)-g0[0]))
+#define OIDX(i,j,k) ((((k)-o0[2])*om[1] + ((j)-o0[1]))*om[0] + ((i)-o0[0]))
+#define ISBDRY(i,j,k) (   (i)==0 || (i)==M[0]-1 \
+                       || (info->dim > 1 && ((j)==0 || (j)==M[1]-1)) \
+                       || (info->dim > 2 && ((k)==0 || (k)==M[2]-1)))
+
+    // load R_0; padding and boundary points are zero
+    ierr = PetscArrayzero(src,bxy * (R1[2] - R0[2] + 2)); CHKERRQ(ierr);
+    ierr = PetscArrayzero(bs->rb,bxy * (R1[2] - R0[2] + 2)); CHKERRQ(ierr);
+    for (k = R0[2]; k < R1[2]; k++) {
+        for (j = R0[1]; j < R1[1]; j++) {
+            for (i = R0[0]; i < R1[0]; i++) {
+                bs->rb[BIDX(i,j,k)] = ar[GIDX(i,j,k)];
+                if (!zeroinit && !ISBDRY(i,j,k))
+                    src[BIDX(i,j,k)] = ay[GIDX(i,j,k)];
+            }
+        }
+    }
+    if (bs->type == SWEEP_JACOBI) {
+        ierr = PetscArraycpy(dst,src,bxy * (R1[2] - R0[2] + 2)); CHKERRQ(ierr);
+    }
+
+    for (t = 1; t <= ns; t++) {
+        for (d = 0; d < 3; d++) {
+            if (d < info->dim) {
+                lo[d] = PetscMax(t0[d] - (ns - t), 1);
+                hi[d] = PetscMin(t1[d] + (ns - t), M[d] - 1);
+            } else {
+                lo[d] = 0;  hi[d] = 1;
+            }
+        }
+        if (bs->type == SWEEP_JACOBI) {
+            for (k = lo[2]; k < hi[2]; k++) {
+                for (j = lo[1]; j < hi[1]; j++) {
+                    const PetscInt  b = BIDX(lo[0],j,k), n = hi[0] - lo[0];
+                    const PetscReal *PETSC_RESTRICT s = src + b,
+                                    *PETSC_RESTRICT r = bs->rb + b;
+                    PetscReal       *PETSC_RESTRICT y = dst + b;
+                    PetscPragmaSIMD
+                    for (i = 0; i < n; i++) {
+                        y[i] = (1.0 - bs->omega) * s[i]
+                               + om1 * (r[i] + scx * (s[i-1] + s[i+1])
+                                             + scy * (s[i-bx] + s[i+bx])
+                                             + scz * (s[i-bxy] + s[i+bxy]));
+                    }
+                }
+            }
+            tmp = src;  src = dst;  dst = tmp;
+        } else {
+            c = (stage0 + t - 1) % 2;  // color updated in this stage
+            for (k = lo[2]; k < hi[2]; k++) {
+                for (j = lo[1]; j < hi[1]; j++) {
+                    i = lo[0] + ((lo[0] + j + k + c) % 2);
+                    for (; i < hi[0]; i += 2) {
+                        q = BIDX(i,j,k);
+                        src[q] = (bs->rb[q] + scx * (src[q-1] + src[q+1])
+                                            + scy * (src[q-bx] + src[q+bx])
+                                            + scz * (src[q-bxy] + src[q+bxy]))
+                                 / diag;
+                    }
+                }
+            }
+        }
+    }
+
+    // write T; a boundary row is  diag y = r  with nothing else, so after
+    // ns Jacobi stages  y - r/diag  is reduced by (1-omega)^ns
+    bfactor = (bs->type == SWEEP_JACOBI) ? PetscPowReal(1.0 - bs->omega,(PetscReal)ns)
+                                         : 0.0;
+    for (k = t0[2]; k < t1[2]; k++) {
+        for (j = t0[1]; j < t1[1]; j++) {
+            for (i = t0[0]; i < t1[0]; i++) {
+                if (ISBDRY(i,j,k)) {
+                    const PetscReal y0 = zeroinit ? 0.0 : ay[GIDX(i,j,k)],
+                                    ystar = ar[GIDX(i,j,k)] / diag;
+                    aynew[OIDX(i,j,k)] = ystar + bfactor * (y0 - ystar);
+                } else
+                    aynew[OIDX(i,j,k)] = src[BIDX(i,j,k)];
+            }
+        }
+    }
+#undef BIDX
+#undef GIDX
+#undef OIDX
+#undef ISBDRY
+    return 0;
+}
+
+// y = B r  where B is sweeps of the smoother from y=0
+static PetscErrorCode BlockSmootherApply(PC pc, Vec r, Vec y) {
+    PetscErrorCode  ierr;
+    BlockSmoother   *bs;
+    DMDALocalInfo   info, deep;
+    PetscInt        stages, done, ns, t0[3], t1[3], tilej, tilek, j, k;
+    const PetscReal *ay, *ar;
+    PetscReal       *aynew;
+
+    ierr = PCShellGetContext(pc,(void**)&bs); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(bs->da,&info); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(bs->dadeep,&deep); CHKERRQ(ierr);
+    if (info.dim < 3) {
+        info.zs = 0;  info.zm = 1;  info.mz = 1;
+        deep.gzs = 0;  deep.gzm = 1;
+    }
+    if (info.dim < 2) {
+        info.ys = 0;  info.ym = 1;  info.my = 1;
+        deep.gys = 0;  deep.gym = 1;
+    }
+    tilej = (info.dim > 1) ? bs->tile : 1;
+    tilek = (info.dim > 2) ? bs->tile : 1;
+    stages = (bs->type == SWEEP_REDBLACK) ? 2 * bs->sweeps : bs->sweeps;
+    ierr = DMGlobalToLocalBegin(bs->dadeep,r,INSERT_VALUES,bs->rloc); CHKERRQ(ierr);
+    ierr = DMGlobalToLocalEnd(bs->dadeep,r,INSERT_VALUES,bs->rloc); CHKERRQ(ierr);
+    ierr = VecGetArrayRead(bs->rloc,&ar); CHKERRQ(ierr);
+    // each round needs one ghost update, of depth width, for y
+    for (done = 0; done < stages; done += ns) {
+        ns = PetscMin(bs->width,stages - done);
+        if (done > 0) {
+            ierr = DMGlobalToLocalBegin(bs->dadeep,y,INSERT_VALUES,bs->yloc); CHKERRQ(ierr);
+            ierr = DMGlobalToLocalEnd(bs->dadeep,y,INSERT_VALUES,bs->yloc); CHKERRQ(ierr);
+        }
+        ierr = VecGetArrayRead(bs->yloc,&ay); CHKERRQ(ierr);
+        ierr = VecGetArray(y,&aynew); CHKERRQ(ierr);
+        t0[0] = info.xs;  t1[0] = info.xs + info.xm;
+        for (k = info.zs; k < info.zs + info.zm; k += tilek) {
+            t0[2] = k;  t1[2] = PetscMin(k + tilek,info.zs + info.zm);
+            for (j = info.ys; j < info.ys + info.ym; j += tilej) {
+                t0[1] = j;  t1[1] = PetscMin(j + tilej,info.ys + info.ym);
+                ierr = BlockSmootherTile(bs,&info,&deep,ns,done,(done == 0),
+                                         ay,ar,aynew,t0,t1); CHKERRQ(ierr);
+            }
+        }
+        ierr = VecRestoreArray(y,&aynew); CHKERRQ(ierr);
+        ierr = VecRestoreArrayRead(bs->yloc,&ay); CHKERRQ(ierr);
+    }
+    ierr = VecRestoreArrayRead(bs->rloc,&ar); CHKERRQ(ierr);
+    ierr = PetscLogFlops((2.0*info.dim+5.0)*stages*info.xm*info.ym*info.zm); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode BlockSmootherDestroy(PC pc) {
+    PetscErrorCode ierr;
+    BlockSmoother  *bs;
+    ierr = PCShellGetContext(pc,(void**)&bs); CHKERRQ(ierr);
+    ierr = BlockSmootherReset(bs); CHKERRQ(ierr);
+    ierr = PetscFree(bs); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode PoissonPCShellSetBlockSmoother(PC pc, PoissonSweepType type,
+        PetscInt sweeps, PetscReal omega, PetscInt tile) {
+    PetscErrorCode ierr;
+    BlockSmoother  *bs;
+    if (sweeps < 1 || tile < 1) {
+        SETERRQ(PETSC_COMM_SELF,8,"block smoother needs sweeps >= 1 and tile >= 1\n");
+    }
+    ierr = PetscNew(&bs); CHKERRQ(ierr);
+    bs->type = type;
+    bs->sweeps = sweeps;
+    bs->omega = omega;
+    bs->tile = tile;
+    ierr = PCSetType(pc,PCSHELL); CHKERRQ(ierr);
+    ierr = PCShellSetContext(pc,bs); CHKERRQ(ierr);
+    ierr = PCShellSetName(pc,"Poisson block smoother"); CHKERRQ(ierr);
+    ierr = PCShellSetSetUp(pc,BlockSmootherSetUp); CHKERRQ(ierr);
+    ierr = PCShellSetApply(pc,BlockSmootherApply); CHKERRQ(ierr);
+    ierr = PCShellSetDestroy(pc,BlockSmootherDestroy); CHKERRQ(ierr);
+    return 0;
+}
+
+// DST-I of length n:  X_k = sum_{j=1}^n x_j sin(pi j k / (n+1)),  k=1..n
+typedef struct {
+    PetscInt   n,
+               L;           // = 2(n+1) if power of two, else 0
+    PetscReal  *sines,      // n x n table if L == 0
+               *wr, *wi,    // FFT twiddles if L > 0
+               *re, *im,    // work, length max(L,n)
+               *ev;         // eigenvalue contributions, length n
+} DSTPlan;
+
+static PetscErrorCode DSTPlanCreate(PetscInt n, PetscReal sc, DSTPlan *plan) {
+    PetscErrorCode ierr;
+    PetscInt  j, k, N = n + 1, lwork;
+    plan->n = n;
+    plan->L = ((N & (N - 1)) == 0) ? 2 * N : 0;
+    lwork = PetscMax(plan->L,n);
+    plan->sines = NULL;
+    plan->wr = NULL;
+    plan->wi = NULL;
+    ierr = PetscMalloc3(lwork,&(plan->re),lwork,&(plan->im),n,&(plan->ev)); CHKERRQ(ierr);
+    if (plan->L > 0) {
+        ierr = PetscMalloc2(N,&(plan->wr),N,&(plan->wi)); CHKERRQ(ierr);
+        for (k = 0; k < N; k++) {
+            plan->wr[k] =   PetscCosReal(PETSC_PI * k / N);  // exp(-2 pi i k / L)
+            plan->wi[k] = - PetscSinReal(PETSC_PI * k / N);
+        }
+    } else {
+        ierr = PetscInfo2(NULL,"DST-I length %d: %d is not a power of two, so using O(n^2) sums and an n x n table of sines\n",
+                          n,N); CHKERRQ(ierr);
+        ierr = PetscMalloc1(n*n,&(plan->sines)); CHKERRQ(ierr);
+        for (k = 1; k <= n; k++)
+            for (j = 1; j <= n; j++)
+                plan->sines[(k-1)*n + (j-1)] = PetscSinReal(PETSC_PI * j * k / N);
+    }
+    // eigenvalues of  sc * tridiag(-1,2,-1)  for the DST-I eigenvectors
+    for (k = 1; k <= n; k++)
+        plan->ev[k-1] = 2.0 * sc * (1.0 - PetscCosReal(PETSC_PI * k / N));
+    return 0;
+}
+
+static PetscErrorCode DSTPlanDestroy(DSTPlan *plan) {
+    PetscErrorCode ierr;
+    ierr = PetscFree3(plan->re,plan->im,plan->ev); CHKERRQ(ierr);
+    ierr = PetscFree2(plan->wr,plan->wi); CHKERRQ(ierr);
+    ierr = PetscFree(plan->sines); CHKERRQ(ierr);
+    return 0;
+}
+
+// in-place iterative radix-2 complex FFT of length plan->L
+static void DSTFFT(DSTPlan *plan) {
+    const PetscInt L = plan->L;
+    PetscReal *re = plan->re, *im = plan->im, tr, ti;
+    PetscInt  i, j, k, bit, len, half, step;
+    for (i = 1, j = 0; i < L; i++) {  // bit-reversal permutation
+        for (bit = L >> 1; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            tr = re[i];  re[i] = re[j];  re[j] = tr;
+            ti = im[i];  im[i] = im[j];  im[j] = ti;
+        }
+    }
+    for (len = 2; len <= L; len <<= 1) {
+        half = len / 2;
+        step = L / len;
+        for (i = 0; i < L; i += len) {
+            for (k = 0; k < half; k++) {
+                const PetscReal wr = plan->wr[k*step], wi = plan->wi[k*step],
+                                vr = re[i+k+half] * wr - im[i+k+half] * wi,
+                                vi = re[i+k+half] * wi + im[i+k+half] * wr;
+                re[i+k+half] = re[i+k] - vr;
+                im[i+k+half] = im[i+k] - vi;
+                re[i+k] += vr;
+                im[i+k] += vi;
+            }
+        }
+    }
+}
+
+// x[1..n] <- DST-I of x[1..n]; x[0] and x[n+1] are not used
+static void DSTLine(DSTPlan *plan, PetscReal *x) {
+    const PetscInt n = plan->n;
+    PetscInt  j, k;
+    if (plan->L > 0) {
+        // odd extension  [0, x_1..x_n, 0, -x_n..-x_1]  has FFT  -2i X_k
+        const PetscInt N = n + 1;
+        for (j = 0; j < plan->L; j++)
+            plan->im[j] = 0.0;
+        plan->re[0] = 0.0;
+        plan->re[N] = 0.0;
+        for (j = 1; j <= n; j++) {
+            plan->re[j] = x[j];
+            plan->re[2*N - j] = - x[j];
+        }
+        DSTFFT(plan);
+        for (k = 1; k <= n; k++)
+            x[k] = - 0.5 * plan->im[k];
+    } else {
+        for (k = 0; k < n; k++) {
+            plan->re[k] = 0.0;
+            for (j = 0; j < n; j++)
+                plan->re[k] += plan->sines[k*n + j] * x[j+1];
+        }
+        for (k = 1; k <= n; k++)
+            x[k] = plan->re[k-1];
+    }
+}
+
+/* Context for the PCSHELL from PoissonPCShellSetDST().  For each direction
+d there is a "pencil" Vec in which each process owns complete grid lines in
+direction d, and a VecScatter to it from the DMDA global Vec.            */
+typedef struct {
+    DM         da;                // not referenced; from the operator
+    PetscInt   dim, m[3],         // grid is m[0] x m[1] x m[2]
+               lstart[3], lend[3];  // owned lines in each pencil Vec
+    PetscReal  diag;
+    DSTPlan    plan[3];
+    Vec        pencil[3];
+    VecScatter scatter[3];
+} DSTSolver;
+
+static PetscErrorCode DSTSolverReset(DSTSolver *dst) {
+    PetscErrorCode ierr;
+    PetscInt d;
+    for (d = 0; d < dst->dim; d++) {
+        ierr = DSTPlanDestroy(&(dst->plan[d])); CHKERRQ(ierr);
+        ierr = VecDestroy(&(dst->pencil[d])); CHKERRQ(ierr);
+        ierr = VecScatterDestroy(&(dst->scatter[d])); CHKERRQ(ierr);
+    }
+    dst->dim = 0;
+    return 0;
+}
+
+// the two directions other than d, and the coordinates of line l
+static void DSTLineCoords(DSTSolver *dst, PetscInt d, PetscInt l,
+                          PetscInt *o1, PetscInt *o2, PetscInt c[3]) {
+    *o1 = (d == 0) ? 1 : 0;
+    *o2 = (d == 2) ? 1 : 2;
+    c[*o1] = l % dst->m[*o1];
+    c[*o2] = l / dst->m[*o1];
+    c[d] = 0;
+}
+
+// lines through boundary points hold only boundary values; skip them
+static PetscBool DSTLineIsInterior(DSTSolver *dst, PetscInt o1, PetscInt o2,
+                                   const PetscInt c[3]) {
+    if (o1 < dst->dim && (c[o1] == 0 || c[o1] == dst->m[o1]-1))
+        return PETSC_FALSE;
+    if (o2 < dst->dim && (c[o2] == 0 || c[o2] == dst->m[o2]-1))
+        return PETSC_FALSE;
+    return PETSC_TRUE;
+}
+
+static PetscErrorCode DSTSolverSetUp(PC pc) {
+    PetscErrorCode ierr;
+    DSTSolver      *dst;
+    Mat            P;
+    DM             da;
+    AO             ao;
+    PoissonCtx     *user;
+    DMDALocalInfo  info;
+    Vec            g;
+    IS             is;
+    MPI_Comm       comm;
+    PetscMPIInt    rank, size;
+    PetscInt       d, nlines, l, t, o1, o2, c[3], *idx, q;
+    PetscReal      sc[3];
+
+    ierr = PCShellGetContext(pc,(void**)&dst); CHKERRQ(ierr);
+    ierr = PCGetOperators(pc,NULL,&P); CHKERRQ(ierr);
+    ierr = MatGetDM(P,&da); CHKERRQ(ierr);
+    if (!da) {
+        ierr = PCGetDM(pc,&da); CHKERRQ(ierr);
+    }
+    if (!da) {
+        SETERRQ(PETSC_COMM_SELF,7,"DST solver needs a DMDA from the operator or the PC\n");
+    }
+    ierr = DSTSolverReset(dst); CHKERRQ(ierr);
+    dst->da = da;
+    ierr = DMGetApplicationContext(da,&user); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = PoissonStencilScalings(da,&info,user,sc); CHKERRQ(ierr);
+    dst->diag = 2.0 * (sc[0] + sc[1] + sc[2]);
+    dst->m[0] = info.mx;
+    dst->m[1] = (info.dim > 1) ? info.my : 1;
+    dst->m[2] = (info.dim > 2) ? info.mz : 1;
+    ierr = PetscObjectGetComm((PetscObject)da,&comm); CHKERRQ(ierr);
+    ierr = MPI_Comm_rank(comm,&rank); CHKERRQ(ierr);
+    ierr = MPI_Comm_size(comm,&size); CHKERRQ(ierr);
+    ierr = DMDAGetAO(da,&ao); CHKERRQ(ierr);
+    ierr = DMGetGlobalVector(da,&g); CHKERRQ(ierr);
+    for (d = 0; d < info.dim; d++) {
+        ierr = DSTPlanCreate(dst->m[d]-2,sc[d],&(dst->plan[d])); CHKERRQ(ierr);
+        // lines are split evenly over processes
+        nlines = dst->m[0] * dst->m[1] * dst->m[2] / dst->m[d];
+        dst->lstart[d] = (nlines / size) * rank + PetscMin(rank,nlines % size);
+        dst->lend[d] = dst->lstart[d] + nlines / size + ((rank < nlines % size) ? 1 : 0);
+        ierr = PetscMalloc1((dst->lend[d] - dst->lstart[d]) * dst->m[d],&idx); CHKERRQ(ierr);
+        q = 0;
+        for (l = dst->lstart[d]; l < dst->lend[d]; l++) {
+            DSTLineCoords(dst,d,l,&o1,&o2,c);
+            for (t = 0; t < dst->m[d]; t++) {
+                c[d] = t;
+                idx[q++] = c[0] + dst->m[0] * (c[1] + dst->m[1] * c[2]);  // natural
+            }
+        }
+        ierr = AOApplicationToPetsc(ao,q,idx); CHKERRQ(ierr);
+        ierr = ISCreateGeneral(comm,q,idx,PETSC_OWN_POINTER,&is); CHKERRQ(ierr);
+        ierr = VecCreateMPI(comm,q,PETSC_DETERMINE,&(dst->pencil[d])); CHKERRQ(ierr);
+        ierr = VecScatterCreate(g,is,dst->pencil[d],NULL,&(dst->scatter[d])); CHKERRQ(ierr);
+        ierr = ISDestroy(&is); CHKERRQ(ierr);
+    }
+    dst->dim = info.dim;
+    ierr = DMRestoreGlobalVector(da,&g); CHKERRQ(ierr);
+    return 0;
+}
+
+// DST-I of all interior lines in pencil d; if divide then also apply the
+// inverse eigenvalues (with DST normalization) and transform again
+static PetscErrorCode DSTSolverPencil(DSTSolver *dst, PetscInt d,
+                                      PetscBool divide) {
+    PetscErrorCode ierr;
+    PetscInt   l, t, e, o1, o2, c[3];
+    PetscReal  *ap, *x, norm = 1.0, lam;
+    for (e = 0; e < dst->dim; e++)
+        norm *= 2.0 / (dst->m[e] - 1);
+    ierr = VecGetArray(dst->pencil[d],&ap); CHKERRQ(ierr);
+    for (l = dst->lstart[d]; l < dst->lend[d]; l++) {
+        DSTLineCoords(dst,d,l,&o1,&o2,c);
+        if (!DSTLineIsInterior(dst,o1,o2,c))
+            continue;
+        x = ap + (l - dst->lstart[d]) * dst->m[d];
+        DSTLine(&(dst->plan[d]),x);
+        if (divide) {
+            for (t = 1; t < dst->m[d] - 1; t++) {
+                c[d] = t;
+                lam = 0.0;
+                for (e = 0; e < dst->dim; e++)
+                    lam += dst->plan[e].ev[c[e]-1];
+                x[t] *= norm / lam;
+            }
+            DSTLine(&(dst->plan[d]),x);
+        }
+    }
+    ierr = VecRestoreArray(dst->pencil[d],&ap); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode DSTSolverApply(PC pc, Vec r, Vec y) {
+    PetscErrorCode  ierr;
+    DSTSolver       *dst;
+    DMDALocalInfo   info;
+    PetscInt        d, i, j, k, q;
+    const PetscReal *ar;
+    PetscReal       *ay, flops = 0.0;
+
+    ierr = PCShellGetContext(pc,(void**)&dst); CHKERRQ(ierr);
+    ierr = VecCopy(r,y); CHKERRQ(ierr);
+    // transform in directions 0,...,dim-1, divide, transform back
+    for (d = 0; d < dst->dim; d++) {
+        ierr = VecScatterBegin(dst->scatter[d],y,dst->pencil[d],
+                               INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+        ierr = VecScatterEnd(dst->scatter[d],y,dst->pencil[d],
+                             INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+        ierr = DSTSolverPencil(dst,d,(d == dst->dim-1)); CHKERRQ(ierr);
+        ierr = VecScatterBegin(dst->scatter[d],dst->pencil[d],y,
+                               INSERT_VALUES,SCATTER_REVERSE); CHKERRQ(ierr);
+        ierr = VecScatterEnd(dst->scatter[d],dst->pencil[d],y,
+                             INSERT_VALUES,SCATTER_REVERSE); CHKERRQ(ierr);
+    }
+    for (d = dst->dim-2; d >= 0; d--) {
+        ierr = VecScatterBegin(dst->scatter[d],y,dst->pencil[d],
+                               INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+        ierr = VecScatterEnd(dst->scatter[d],y,dst->pencil[d],
+                             INSERT_VALUES,SCATTER_FORWARD); CHKERRQ(ierr);
+        ierr = DSTSolverPencil(dst,d,PETSC_FALSE); CHKERRQ(ierr);
+        ierr = VecScatterBegin(dst->scatter[d],dst->pencil[d],y,
+                               INSERT_VALUES,SCATTER_REVERSE); CHKERRQ(ierr);
+        ierr = VecScatterEnd(dst->scatter[d],dst->pencil[d],y,
+                             INSERT_VALUES,SCATTER_REVERSE); CHKERRQ(ierr);
+    }
+    // boundary rows are  diag y = r
+    ierr = DMDAGetLocalInfo(dst->da,&info); CHKERRQ(ierr);
+    ierr = VecGetArrayRead(r,&ar); CHKERRQ(ierr);
+    ierr = VecGetArray(y,&ay); CHKERRQ(ierr);
+    q = 0;
+    for (k = info.zs; k < info.zs + ((info.dim > 2) ? info.zm : 1); k++) {
+        for (j = info.ys; j < info.ys + ((info.dim > 1) ? info.ym : 1); j++) {
+            for (i = info.xs; i < info.xs + info.xm; i++) {
+                if (   i == 0 || i == dst->m[0]-1
+                    || (info.dim > 1 && (j == 0 || j == dst->m[1]-1))
+                    || (info.dim > 2 && (k == 0 || k == dst->m[2]-1)))
+                    ay[q] = ar[q] / dst->diag;
+                q++;
+            }
+        }
+    }
+    ierr = VecRestoreArray(y,&ay); CHKERRQ(ierr);
+    ierr = VecRestoreArrayRead(r,&ar); CHKERRQ(ierr);
+    // two transforms per line, each roughly 5 L log2(L) with L = 2 m
+    for (d = 0; d < dst->dim; d++) {
+        flops += 2.0 * (dst->lend[d] - dst->lstart[d])
+                 * 10.0 * dst->m[d] * PetscLog2Real(2.0 * dst->m[d]);
+    }
+    ierr = PetscLogFlops(flops); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode DSTSolverDestroy(PC pc) {
+    PetscErrorCode ierr;
+    DSTSolver      *dst;
+    ierr = PCShellGetContext(pc,(void**)&dst); CHKERRQ(ierr);
+    ierr = DSTSolverReset(dst); CHKERRQ(ierr);
+    ierr = PetscFree(dst); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode PoissonPCShellSetDST(PC pc) {
+    PetscErrorCode ierr;
+    DSTSolver      *dst;
+    ierr = PetscNew(&dst); CHKERRQ(ierr);
+    ierr = PCSetType(pc,PCSHELL); CHKERRQ(ierr);
+    ierr = PCShellSetContext(pc,dst); CHKERRQ(ierr);
+    ierr = PCShellSetName(pc,"Poisson DST direct solver"); CHKERRQ(ierr);
+    ierr = PCShellSetSetUp(pc,DSTSolverSetUp); CHKERRQ(ierr);
+    ierr = PCShellSetApply(pc,DSTSolverApply); CHKERRQ(ierr);
+    ierr = PCShellSetDestroy(pc,DSTSolverDestroy); CHKERRQ(ierr);
+    return 0;
+}
+
+/* One level of the single-precision multigrid from
+PoissonPCShellSetSinglePrecisionMG().  Arrays are float, with the ghosted
+layout of the DMDA, and are indexed with strides off[].  Coordinates in
+unused dimensions are always zero, and there off[d] = 0 and sc[d] = 0, so
+the stencil formulas need no special cases for dim < 3.                  */
+typedef struct {
+    DM          da;
+    PetscInt    M[3], s[3], m[3],    // grid size, owned range
+                gs[3], gm[3],        // ghosted range
+                lo[3], hi[3],        // owned interior (non-boundary) range
+                off[3];              // strides in ghosted arrays
+    PetscReal   sc[3];               // from PoissonStencilScalings()
+    PetscMPIInt nbr[6];              // face neighbors -x,+x,-y,+y,-z,+z
+    float       *u, *f, *r, *buf;    // buf holds two ghost planes
+    PetscInt    plane;               // max ghost plane size
+} SPLevel;
+
+// coarsest grids with more points per direction are solved only approximately
+#define SPMG_MAXCOARSEM      32
+#define SPMG_MAXCOARSESWEEPS (4 * SPMG_MAXCOARSEM * SPMG_MAXCOARSEM)
+
+typedef struct {
+    PetscInt   dim, maxlevels, nlevels, sweeps, coarsesweeps;
+    PetscReal  omega;
+    SPLevel    *lev;                 // lev[0] is finest
+} SPMG;
+
+static PetscErrorCode SPMGReset(SPMG *sp) {
+    PetscErrorCode ierr;
+    PetscInt l;
+    for (l = 0; l < sp->nlevels; l++) {
+        ierr = DMDestroy(&(sp->lev[l].da)); CHKERRQ(ierr);
+        ierr = PetscFree4(sp->lev[l].u,sp->lev[l].f,sp->lev[l].r,sp->lev[l].buf); CHKERRQ(ierr);
+    }
+    ierr = PetscFree(sp->lev); CHKERRQ(ierr);
+    sp->nlevels = 0;
+    return 0;
+}
+
+static PetscErrorCode SPLevelCreate(DM da, SPLevel *lv) {
+    PetscErrorCode  ierr;
+    DMDALocalInfo   info;
+    PoissonCtx      *user;
+    const PetscMPIInt *nb;
+    PetscInt        d, n, center, stride;
+
+    lv->da = da;
+    ierr = DMGetApplicationContext(da,&user); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = PoissonStencilScalings(da,&info,user,lv->sc); CHKERRQ(ierr);
+    lv->M[0] = info.mx;   lv->M[1] = info.my;   lv->M[2] = info.mz;
+    lv->s[0] = info.xs;   lv->s[1] = info.ys;   lv->s[2] = info.zs;
+    lv->m[0] = info.xm;   lv->m[1] = info.ym;   lv->m[2] = info.zm;
+    lv->gs[0] = info.gxs; lv->gs[1] = info.gys; lv->gs[2] = info.gzs;
+    lv->gm[0] = info.gxm; lv->gm[1] = info.gym; lv->gm[2] = info.gzm;
+    for (d = info.dim; d < 3; d++) {
+        lv->M[d] = 1;  lv->s[d] = 0;  lv->m[d] = 1;  lv->gs[d] = 0;  lv->gm[d] = 1;
+    }
+    // DMDAGetNeighbors() gives 3^dim ranks, x fastest, and -1 if none
+    ierr = DMDAGetNeighbors(da,&nb); CHKERRQ(ierr);
+    center = (info.dim == 1) ? 1 : ((info.dim == 2) ? 4 : 13);
+    n = 1;
+    for (d = 0; d < 3; d++) {
+        lv->off[d] = (d < info.dim) ? n : 0;
+        n *= lv->gm[d];
+        if (d < info.dim) {
+            stride = (d == 0) ? 1 : ((d == 1) ? 3 : 9);
+            lv->nbr[2*d]   = (nb[center - stride] < 0) ? MPI_PROC_NULL : nb[center - stride];
+            lv->nbr[2*d+1] = (nb[center + stride] < 0) ? MPI_PROC_NULL : nb[center + stride];
+            lv->lo[d] = PetscMax(lv->s[d],1);
+            lv->hi[d] = PetscMin(lv->s[d] + lv->m[d],lv->M[d] - 1);
+        } else {
+            lv->nbr[2*d] = MPI_PROC_NULL;  lv->nbr[2*d+1] = MPI_PROC_NULL;
+            lv->lo[d] = 0;  lv->hi[d] = 1;
+        }
+    }
+    lv->plane = PetscMax(PetscMax(lv->gm[1]*lv->gm[2],lv->gm[0]*lv->gm[2]),
+                         lv->gm[0]*lv->gm[1]);
+    ierr = PetscCalloc4(n,&(lv->u),n,&(lv->f),n,&(lv->r),2*lv->plane,&(lv->buf)); CHKERRQ(ierr);
+    return 0;
+}
+
+#define SPIDX(lv,i,j,k) (((k)-(lv)->gs[2])*(lv)->gm[0]*(lv)->gm[1] \
+                         + ((j)-(lv)->gs[1])*(lv)->gm[0] + ((i)-(lv)->gs[0]))
+
+// copy the ghost plane c[d] = p to or from buf, over all ghosted c[e], e != d
+static void SPPlane(SPLevel *lv, float *a, PetscInt d, PetscInt p,
+                    float *buf, PetscBool pack) {
+    PetscInt c[3], q = 0;
+    for (c[2] = lv->gs[2]; c[2] < lv->gs[2] + lv->gm[2]; c[2]++) {
+        if (d == 2 && c[2] != p)  continue;
+        for (c[1] = lv->gs[1]; c[1] < lv->gs[1] + lv->gm[1]; c[1]++) {
+            if (d == 1 && c[1] != p)  continue;
+            for (c[0] = lv->gs[0]; c[0] < lv->gs[0] + lv->gm[0]; c[0]++) {
+                if (d == 0 && c[0] != p)  continue;
+                if (pack)
+                    buf[q++] = a[SPIDX(lv,c[0],c[1],c[2])];
+                else
+                    a[SPIDX(lv,c[0],c[1],c[2])] = buf[q++];
+            }
+        }
+    }
+}
+
+/* Update ghosts of a, in single precision, by face exchanges one direction
+at a time; because each exchange includes the ghosts of earlier directions,
+edge and corner ghosts are also correct.                                   */
+static PetscErrorCode SPGhostUpdate(SPLevel *lv, float *a) {
+    PetscErrorCode ierr;
+    MPI_Comm       comm;
+    PetscInt       d, np;
+    float          *sbuf = lv->buf, *rbuf = lv->buf + lv->plane;
+    ierr = PetscObjectGetComm((PetscObject)(lv->da),&comm); CHKERRQ(ierr);
+    for (d = 0; d < 3; d++) {
+        if (lv->off[d] == 0)
+            continue;
+        np = lv->gm[0] * lv->gm[1] * lv->gm[2] / lv->gm[d];
+        // send low owned plane down, receive high ghost plane from above
+        SPPlane(lv,a,d,lv->s[d],sbuf,PETSC_TRUE);
+        ierr = MPI_Sendrecv(sbuf,np,MPI_FLOAT,lv->nbr[2*d],0,
+                            rbuf,np,MPI_FLOAT,lv->nbr[2*d+1],0,
+                            comm,MPI_STATUS_IGNORE); CHKERRQ(ierr);
+        if (lv->nbr[2*d+1] != MPI_PROC_NULL)
+            SPPlane(lv,a,d,lv->s[d]+lv->m[d],rbuf,PETSC_FALSE);
+        // send high owned plane up, receive low ghost plane from below
+        SPPlane(lv,a,d,lv->s[d]+lv->m[d]-1,sbuf,PETSC_TRUE);
+        ierr = MPI_Sendrecv(sbuf,np,MPI_FLOAT,lv->nbr[2*d+1],1,
+                            rbuf,np,MPI_FLOAT,lv->nbr[2*d],1,
+                            comm,MPI_STATUS_IGNORE); CHKERRQ(ierr);
+        if (lv->nbr[2*d] != MPI_PROC_NULL)
+            SPPlane(lv,a,d,lv->s[d]-1,rbuf,PETSC_FALSE);
+    }
+    return 0;
+}
+
+// r = f - A u on the owned interior; boundary values of u are zero
+static PetscErrorCode SPResidual(SPLevel *lv) {
+    PetscErrorCode ierr;
+    const PetscInt  ox = lv->off[0], oy = lv->off[1], oz = lv->off[2];
+    const float     sx = lv->sc[0], sy = lv->sc[1], sz = lv->sc[2],
+                    diag = 2.0 * (sx + sy + sz);
+    const PetscInt  nx = lv->hi[0] - lv->lo[0];
+    PetscInt        i, j, k, q;
+    ierr = SPGhostUpdate(lv,lv->u); CHKERRQ(ierr);
+    for (k = lv->lo[2]; k < lv->hi[2]; k++) {
+        for (j = lv->lo[1]; j < lv->hi[1]; j++) {
+            const float *PETSC_RESTRICT u = lv->u,
+                        *PETSC_RESTRICT f = lv->f;
+            float       *PETSC_RESTRICT r = lv->r;
+            const PetscInt q0 = SPIDX(lv,lv->lo[0],j,k);
+            PetscPragmaSIMD
+            for (i = 0; i < nx; i++) {
+                q = q0 + i;
+                r[q] = f[q] - diag * u[q] + sx * (u[q-ox] + u[q+ox])
+                       + sy * (u[q-oy] + u[q+oy]) + sz * (u[q-oz] + u[q+oz]);
+            }
+        }
+    }
+    return 0;
+}
+
+// weighted Jacobi sweeps  u <- u + omega D^-1 (f - A u)
+static PetscErrorCode SPSmooth(SPLevel *lv, PetscInt sweeps, PetscReal omega) {
+    PetscErrorCode ierr;
+    const float  w = omega / (2.0 * (lv->sc[0] + lv->sc[1] + lv->sc[2]));
+    const PetscInt nx = lv->hi[0] - lv->lo[0];
+    PetscInt     n, i, j, k;
+    for (n = 0; n < sweeps; n++) {
+        ierr = SPResidual(lv); CHKERRQ(ierr);
+        for (k = lv->lo[2]; k < lv->hi[2]; k++) {
+            for (j = lv->lo[1]; j < lv->hi[1]; j++) {
+                const float *PETSC_RESTRICT r = lv->r + SPIDX(lv,lv->lo[0],j,k);
+                float       *PETSC_RESTRICT u = lv->u + SPIDX(lv,lv->lo[0],j,k);
+                PetscPragmaSIMD
+                for (i = 0; i < nx; i++)
+                    u[i] += w * r[i];
+            }
+        }
+    }
+    return 0;
+}
+
+// f_c = P^T r_f  for linear interpolation P; boundary residuals are zero
+static PetscErrorCode SPRestrict(SPLevel *fine, SPLevel *coarse) {
+    PetscErrorCode ierr;
+    PetscInt  i, j, k, a, b, c, nd[3], q;
+    PetscReal v, wb, wc;
+    for (q = 0; q < 3; q++)
+        nd[q] = (fine->off[q] > 0) ? 1 : 0;
+    // the residual is only computed on the owned interior
+    for (k = fine->gs[2]; k < fine->gs[2] + fine->gm[2]; k++)
+        for (j = fine->gs[1]; j < fine->gs[1] + fine->gm[1]; j++)
+            for (i = fine->gs[0]; i < fine->gs[0] + fine->gm[0]; i++)
+                if (   i < fine->lo[0] || i >= fine->hi[0]
+                    || j < fine->lo[1] || j >= fine->hi[1]
+                    || k < fine->lo[2] || k >= fine->hi[2])
+                    fine->r[SPIDX(fine,i,j,k)] = 0.0;
+    ierr = SPGhostUpdate(fine,fine->r); CHKERRQ(ierr);
+    for (k = coarse->lo[2]; k < coarse->hi[2]; k++) {
+        for (j = coarse->lo[1]; j < coarse->hi[1]; j++) {
+            for (i = coarse->lo[0]; i < coarse->hi[0]; i++) {
+                v = 0.0;
+                for (c = -nd[2]; c <= nd[2]; c++) {
+                    wc = (c == 0) ? 1.0 : 0.5;
+                    for (b = -nd[1]; b <= nd[1]; b++) {
+                        wb = wc * ((b == 0) ? 1.0 : 0.5);
+                        for (a = -nd[0]; a <= nd[0]; a++) {
+                            v += wb * ((a == 0) ? 1.0 : 0.5)
+                                 * fine->r[SPIDX(fine,2*i+a,2*j+b,2*k+c)];
+                        }
+                    }
+                }
+                coarse->f[SPIDX(coarse,i,j,k)] = v;
+            }
+        }
+    }
+    return 0;
+}
+
+// u_f += P u_c  for linear interpolation P
+static PetscErrorCode SPInterpolate(SPLevel *coarse, SPLevel *fine) {
+    PetscErrorCode ierr;
+    PetscInt  c[3], d, np[3], par[3][2], a, b, e;
+    PetscReal wt[3][2], v;
+    ierr = SPGhostUpdate(coarse,coarse->u); CHKERRQ(ierr);
+    for (c[2] = fine->lo[2]; c[2] < fine->hi[2]; c[2]++) {
+        for (c[1] = fine->lo[1]; c[1] < fine->hi[1]; c[1]++) {
+            for (c[0] = fine->lo[0]; c[0] < fine->hi[0]; c[0]++) {
+                for (d = 0; d < 3; d++) {
+                    if (c[d] % 2 == 0) {
+                        np[d] = 1;  par[d][0] = c[d] / 2;  wt[d][0] = 1.0;
+                    } else {
+                        np[d] = 2;
+                        par[d][0] = (c[d] - 1) / 2;  wt[d][0] = 0.5;
+                        par[d][1] = (c[d] + 1) / 2;  wt[d][1] = 0.5;
+                    }
+                }
+                v = 0.0;
+                for (e = 0; e < np[2]; e++)
+                    for (b = 0; b < np[1]; b++)
+                        for (a = 0; a < np[0]; a++)
+                            v += wt[0][a] * wt[1][b] * wt[2][e]
+                                 * coarse->u[SPIDX(coarse,par[0][a],par[1][b],par[2][e])];
+                fine->u[SPIDX(fine,c[0],c[1],c[2])] += v;
+            }
+        }
+    }
+    return 0;
+}
+
+static PetscErrorCode SPVCycle(SPMG *sp, PetscInt l) {
+    PetscErrorCode ierr;
+    SPLevel  *lv = &(sp->lev[l]);
+    PetscInt n = lv->gm[0] * lv->gm[1] * lv->gm[2];
+    ierr = PetscArrayzero(lv->u,n); CHKERRQ(ierr);
+    if (l == sp->nlevels - 1) {
+        ierr = SPSmooth(lv,sp->coarsesweeps,sp->omega); CHKERRQ(ierr);
+        return 0;
+    }
+    ierr = SPSmooth(lv,sp->sweeps,sp->omega); CHKERRQ(ierr);
+    ierr = SPResidual(lv); CHKERRQ(ierr);
+    ierr = SPRestrict(lv,&(sp->lev[l+1])); CHKERRQ(ierr);
+    ierr = SPVCycle(sp,l+1); CHKERRQ(ierr);
+    ierr = SPInterpolate(&(sp->lev[l+1]),lv); CHKERRQ(ierr);
+    ierr = SPSmooth(lv,sp->sweeps,sp->omega); CHKERRQ(ierr);
+    return 0;
+}
+
+/* Coarsening stops when a direction has an even number of intervals, or
+fewer than four, or when the coarse ownership from DMCoarsen() would need
+fine points outside of the fine ghosted range.                            */
+static PetscErrorCode SPMGSetUp(PC pc) {
+    PetscErrorCode ierr;
+    SPMG           *sp;
+    Mat            P;
+    DM             da, dac;
+    PetscInt       d, l, ok;
+    SPLevel        *fine, *coarse;
+    PetscReal      maxM;
+
+    ierr = PCShellGetContext(pc,(void**)&sp); CHKERRQ(ierr);
+    ierr = PCGetOperators(pc,NULL,&P); CHKERRQ(ierr);
+    ierr = MatGetDM(P,&da); CHKERRQ(ierr);
+    if (!da) {
+        ierr = PCGetDM(pc,&da); CHKERRQ(ierr);
+    }
+    if (!da) {
+        SETERRQ(PETSC_COMM_SELF,7,"single-precision MG needs a DMDA from the operator or the PC\n");
+    }
+    if (sp->nlevels > 0 && sp->lev[0].da == da)  // same grid as before,
+        return 0;                                // e.g. next Newton step
+    ierr = SPMGReset(sp); CHKERRQ(ierr);
+    ierr = PetscCalloc1(sp->maxlevels,&(sp->lev)); CHKERRQ(ierr);
+    // keep a reference so that the check above cannot match a new DM
+    ierr = PetscObjectReference((PetscObject)da); CHKERRQ(ierr);
+    ierr = SPLevelCreate(da,&(sp->lev[0])); CHKERRQ(ierr);
+    sp->nlevels = 1;
+    ierr = DMGetDimension(da,&(sp->dim)); CHKERRQ(ierr);
+    for (l = 1; l < sp->maxlevels; l++) {
+        fine = &(sp->lev[l-1]);
+        ok = 1;
+        for (d = 0; d < 3; d++) {
+            if (fine->off[d] > 0 && ((fine->M[d] - 1) % 2 != 0 || fine->M[d] < 5))
+                ok = 0;
+        }
+        ierr = MPI_Allreduce(MPI_IN_PLACE,&ok,1,MPIU_INT,MPI_MIN,
+                             PetscObjectComm((PetscObject)da)); CHKERRQ(ierr);
+        if (!ok)
+            break;
+        ierr = DMCoarsen(fine->da,PetscObjectComm((PetscObject)da),&dac); CHKERRQ(ierr);
+        coarse = &(sp->lev[l]);
+        ierr = SPLevelCreate(dac,coarse); CHKERRQ(ierr);
+        sp->nlevels++;
+        for (d = 0; d < 3; d++) {
+            if (fine->off[d] == 0)
+                continue;
+            // restriction reads fine points 2i-1,...,2i+1
+            if (coarse->lo[d] < coarse->hi[d]
+                && (   2 * coarse->lo[d] - 1 < fine->gs[d]
+                    || 2 * coarse->hi[d] - 1 > fine->gs[d] + fine->gm[d] - 1))
+                ok = 0;
+            // interpolation reads coarse points floor(i/2),...,ceil(i/2)
+            if (fine->lo[d] < fine->hi[d]
+                && (   fine->lo[d] / 2 < coarse->gs[d]
+                    || fine->hi[d] / 2 > coarse->gs[d] + coarse->gm[d] - 1))
+                ok = 0;
+        }
+        ierr = MPI_Allreduce(MPI_IN_PLACE,&ok,1,MPIU_INT,MPI_MIN,
+                             PetscObjectComm((PetscObject)da)); CHKERRQ(ierr);
+        if (!ok) {
+            SETERRQ(PetscObjectComm((PetscObject)da),9,
+                    "coarse grid ownership not aligned with fine; use fewer levels or processes\n");
+        }
+    }
+    // enough Jacobi sweeps on the coarsest grid to converge well, but capped
+    // because coarsening may stop early (m-1 odd, or maxlevels) at a grid
+    // where O(m^2) sweeps would cost far more than the rest of the V-cycle
+    coarse = &(sp->lev[sp->nlevels-1]);
+    maxM = PetscMax(PetscMax(coarse->M[0],coarse->M[1]),coarse->M[2]);
+    if (maxM > SPMG_MAXCOARSEM) {
+        ierr = PetscInfo2(pc,"coarsest grid has %d points per direction; "
+                          "capping its Jacobi sweeps at %d\n",
+                          (int)maxM,(int)SPMG_MAXCOARSESWEEPS); CHKERRQ(ierr);
+    }
+    sp->coarsesweeps = (PetscInt)(4.0 * PetscMin(maxM,SPMG_MAXCOARSEM)
+                                      * PetscMin(maxM,SPMG_MAXCOARSEM));
+    return 0;
+}
+
+static PetscErrorCode SPMGApply(PC pc, Vec r, Vec y) {
+    PetscErrorCode  ierr;
+    SPMG            *sp;
+    SPLevel         *lv;
+    const PetscReal *ar;
+    PetscReal       *ay, diag;
+    PetscInt        i, j, k, q, l;
+    PetscBool       bdry;
+
+    ierr = PCShellGetContext(pc,(void**)&sp); CHKERRQ(ierr);
+    lv = &(sp->lev[0]);
+    diag = 2.0 * (lv->sc[0] + lv->sc[1] + lv->sc[2]);
+    ierr = VecGetArrayRead(r,&ar); CHKERRQ(ierr);
+    q = 0;
+    for (k = lv->s[2]; k < lv->s[2] + lv->m[2]; k++)
+        for (j = lv->s[1]; j < lv->s[1] + lv->m[1]; j++)
+            for (i = lv->s[0]; i < lv->s[0] + lv->m[0]; i++)
+                lv->f[SPIDX(lv,i,j,k)] = (float)ar[q++];
+    ierr = SPVCycle(sp,0); CHKERRQ(ierr);
+    // boundary rows are  diag y = r
+    ierr = VecGetArray(y,&ay); CHKERRQ(ierr);
+    q = 0;
+    for (k = lv->s[2]; k < lv->s[2] + lv->m[2]; k++) {
+        for (j = lv->s[1]; j < lv->s[1] + lv->m[1]; j++) {
+            for (i = lv->s[0]; i < lv->s[0] + lv->m[0]; i++) {
+                bdry = (   i < lv->lo[0] || i >= lv->hi[0]
+                        || j < lv->lo[1] || j >= lv->hi[1]
+                        || k < lv->lo[2] || k >= lv->hi[2]);
+                ay[q] = bdry ? ar[q] / diag : (PetscReal)lv->u[SPIDX(lv,i,j,k)];
+                q++;
+            }
+        }
+    }
+    ierr = VecRestoreArray(y,&ay); CHKERRQ(ierr);
+    ierr = VecRestoreArrayRead(r,&ar); CHKERRQ(ierr);
+    // roughly, each residual is 2 dim + 3 flops per point, and restriction
+    // and interpolation together cost about as much as one residual
+    for (l = 0; l < sp->nlevels; l++) {
+        lv = &(sp->lev[l]);
+        ierr = PetscLogFlops((l == sp->nlevels - 1 ? sp->coarsesweeps : 2 * sp->sweeps + 2)
+                             * (2.0 * sp->dim + 5.0) * lv->m[0] * lv->m[1] * lv->m[2]); CHKERRQ(ierr);
+    }
+    return 0;
+}
+#undef SPIDX
+
+static PetscErrorCode SPMGDestroy(PC pc) {
+    PetscErrorCode ierr;
+    SPMG           *sp;
+    ierr = PCShellGetContext(pc,(void**)&sp); CHKERRQ(ierr);
+    ierr = SPMGReset(sp); CHKERRQ(ierr);
+    ierr = PetscFree(sp); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode PoissonPCShellSetSinglePrecisionMG(PC pc, PetscInt maxlevels,
+                                                  PetscInt sweeps, PetscReal omega) {
+    PetscErrorCode ierr;
+    SPMG           *sp;
+    if (maxlevels < 1 || sweeps < 1) {
+        SETERRQ(PETSC_COMM_SELF,8,"single-precision MG needs maxlevels >= 1 and sweeps >= 1\n");
+    }
+    ierr = PetscNew(&sp); CHKERRQ(ierr);
+    sp->maxlevels = maxlevels;
+    sp->sweeps = sweeps;
+    sp->omega = omega;
+    ierr = PCSetType(pc,PCSHELL); CHKERRQ(ierr);
+    ierr = PCShellSetContext(pc,sp); CHKERRQ(ierr);
+    ierr = PCShellSetName(pc,"Poisson single-precision MG V-cycle"); CHKERRQ(ierr);
+    ierr = PCShellSetSetUp(pc,SPMGSetUp); CHKERRQ(ierr);
+    ierr = PCShellSetApply(pc,SPMGApply); CHKERRQ(ierr);
+    ierr = PCShellSetDestroy(pc,SPMGDestroy); CHKERRQ(ierr);
+    return 0;
+}
+
+// Philox-2x32-10 counter-based generator (Salmon et al. 2011):  ten rounds
+// of a 32x32->64 bit multiply and xor with a Weyl-sequence key scramble the
+// 64 bit counter.  The result, uniform in [0,1) with 53 random bits,
+// depends only on the counter and the key, so there is no state.
+#define PHILOX_M    0xD256D193U
+#define PHILOX_W    0x9E3779B9U
+#define PHILOX_KEY  0x5EEDF15AU
+
+PETSC_STATIC_INLINE PetscReal PhiloxUniform(uint64_t ctr) {
+    uint32_t c0 = (uint32_t)ctr, c1 = (uint32_t)(ctr >> 32),
+             key = PHILOX_KEY;
+    uint64_t prod;
+    int      r;
+    for (r = 0; r < 10; r++) {
+        prod = (uint64_t)PHILOX_M * c0;
+        c0 = (uint32_t)(prod >> 32) ^ key ^ c1;
+        c1 = (uint32_t)prod;
+        key += PHILOX_W;
+    }
+    return ((c0 >> 5) * 67108864.0 + (c1 >> 6)) / 9007199254740992.0;
+}
+
+// Fill u with uniform [0,1) values keyed on the global grid index of each
+// point, so the values do not depend on the parallel decomposition, unlike
+// VecSetRandom().  The inner loops have no dependences and vectorize.
+static PetscErrorCode InitialRandom(DM da, Vec u) {
+    PetscErrorCode ierr;
+    DMDALocalInfo  info;
+    PetscInt       i, j, k;
+    uint64_t       row;
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    switch (info.dim) {
+        case 1:
+        {
+            PetscReal *au;
+            ierr = DMDAVecGetArray(da, u, &au); CHKERRQ(ierr);
+            PetscPragmaSIMD
+            for (i = info.xs; i < info.xs + info.xm; i++)
+                au[i] = PhiloxUniform((uint64_t)i);
+            ierr = DMDAVecRestoreArray(da, u, &au); CHKERRQ(ierr);
+            break;
+        }
+        case 2:
+        {
+            PetscReal **au;
+            ierr = DMDAVecGetArray(da, u, &au); CHKERRQ(ierr);
+            for (j = info.ys; j < info.ys + info.ym; j++) {
+                row = (uint64_t)j * info.mx;
+                PetscPragmaSIMD
+                for (i = info.xs; i < info.xs + info.xm; i++)
+                    au[j][i] = PhiloxUniform(row + i);
+            }
+            ierr = DMDAVecRestoreArray(da, u, &au); CHKERRQ(ierr);
+            break;
+        }
+        case 3:
+        {
+            PetscReal ***au;
+            ierr = DMDAVecGetArray(da, u, &au); CHKERRQ(ierr);
+            for (k = info.zs; k < info.zs + info.zm; k++) {
+                for (j = info.ys; j < info.ys + info.ym; j++) {
+                    row = ((uint64_t)k * info.my + j) * info.mx;
+                    PetscPragmaSIMD
+                    for (i = info.xs; i < info.xs + info.xm; i++)
+                        au[k][j][i] = PhiloxUniform(row + i);
+                }
+            }
+            ierr = DMDAVecRestoreArray(da, u, &au); CHKERRQ(ierr);
+            break;
+        }
+        default:
+            SETERRQ(PETSC_COMM_SELF,5,"invalid dim from DMDALocalInfo\n");
+    }
+    return 0;
+}
+
 PetscErrorCode InitialState(DM da, InitialType it, PetscBool gbdry,
                             Vec u, PoissonCtx *user) {
     PetscErrorCode ierr;
     DMDALocalInfo  info;
-    PetscRandom    rctx;
     switch (it) {
         case ZEROS:
             ierr = VecSet(u,0.0); CHKERRQ(ierr);
             break;
         case RANDOM:
-            ierr = PetscRandomCreate(PETSC_COMM_WORLD,&rctx); CHKERRQ(ierr);
-            ierr = VecSetRandom(u,rctx); CHKERRQ(ierr);
-            ierr = PetscRandomDestroy(&rctx); CHKERRQ(ierr);
+            ierr = InitialRandom(da,u); CHKERRQ(ierr);
             break;
         default:
             SETERRQ(PETSC_COMM_SELF,4,"invalid InitialType ... how did I get here?\n");
@@ -63,6 +63,18 @@ PetscErrorCode Poisson3DFunctionLocal(DMDALocalInfo *info,
     PetscReal ***au, PetscReal ***aF, PoissonCtx *user);
 //ENDDECLARE
 
+/* These compute the same residuals as Poisson2DFunctionLocal() and
+Poisson3DFunctionLocal().  Points whose stencil neighbors are all interior
+points are swept along unit-stride rows with no branches or calls, so that
+the compiler can vectorize; the remaining strips near the boundary are
+done pointwise.  The results agree with the above functions up to
+rounding.  See fish.c option -fsh_split.                                 */
+PetscErrorCode Poisson2DFunctionLocalSplit(DMDALocalInfo *info,
+    PetscReal **au, PetscReal **aF, PoissonCtx *user);
+
+PetscErrorCode Poisson3DFunctionLocalSplit(DMDALocalInfo *info,
+    PetscReal ***au, PetscReal ***aF, PoissonCtx *user);
+
 /* This generates a tridiagonal sparse matrix.  If cx=1 then it has 2 on the
 diagonal and -1 or zero in off-diagonal positions.  For example,
     ./fish -fsh_dim 1 -mat_view ::ascii_dense -da_refine N                */
@@ -83,11 +95,115 @@ sparse matrix.  For example,
 PetscErrorCode Poisson3DJacobianLocal(DMDALocalInfo *info, PetscReal ***au,
                                       Mat J, Mat Jpre, PoissonCtx *user);
 
+/* These are fourth-order alternatives to the above residual and Jacobian
+functions, using compact stencils:  9-point in 2D and 19-point in 3D
+("Mehrstellen"), which need a DMDA_STENCIL_BOX DMDA.  The right side f is
+replaced by a weighted average of f at the point and its face neighbors,
+which is the correction that makes the scheme O(h^4) accurate for any cell
+aspect ratio and any cx,cy,cz.  In 1D the only change is the right side,
+so the Jacobian is Poisson1DJacobianLocal().  Boundary rows are diagonal,
+as above, with the same value as the interior diagonal.  Without caches
+(see PoissonCacheCreate()) f_rhs() is called 2 dim + 1 times per point.
+See -fsh_order 4 in fish.c.                                              */
+PetscErrorCode Poisson1DCompactFunctionLocal(DMDALocalInfo *info,
+    PetscReal *au, PetscReal *aF, PoissonCtx *user);
+
+PetscErrorCode Poisson2DCompactFunctionLocal(DMDALocalInfo *info,
+    PetscReal **au, PetscReal **aF, PoissonCtx *user);
+
+PetscErrorCode Poisson3DCompactFunctionLocal(DMDALocalInfo *info,
+    PetscReal ***au, PetscReal ***aF, PoissonCtx *user);
+
+PetscErrorCode Poisson2DCompactJacobianLocal(DMDALocalInfo *info, PetscReal **au,
+                                             Mat J, Mat Jpre, PoissonCtx *user);
+
+PetscErrorCode Poisson3DCompactJacobianLocal(DMDALocalInfo *info, PetscReal ***au,
+                                             Mat J, Mat Jpre, PoissonCtx *user);
+
+/* This creates a MATSHELL for the same operator as is assembled by
+PoissonXDJacobianLocal() on the grid of the DMDA, which must have a
+PoissonCtx as its application context.  MatMult() applies the stencil to
+local (ghosted) arrays and MatGetDiagonal() is supported, so the Mat can be
+used with smoothers like Chebyshev and Jacobi, but not with SOR or with
+factorizations.  See -fsh_matfree in fish.c.                             */
+PetscErrorCode PoissonMatCreateShell(DM da, Mat *A);
+
+/* This makes PC into a PCSHELL smoother for the operator of
+PoissonXDJacobianLocal(), usually on one level of PCMG.  Applying it does
+the given number of weighted (by omega) Jacobi sweeps, or red-black
+Gauss-Seidel sweeps, from a zero initial iterate.  It is blocked in space
+and time:  the grid owned by a process is cut into tiles of whole x-rows by
+tile points in y and z, and all sweeps are done on one tile, including on
+a shrinking overlap of ghost points which are computed redundantly, before
+the next tile.  Only one ghost exchange (of depth = number of sweeps,
+doubled for red-black) is done per application, unless processes own
+fewer points than that depth, in which case there are several rounds.  The
+DMDA comes from the operator (see PoissonMatCreateShell()) or the PC.  The
+sweeps use the second-order 5/7-point stencil even if the system operator
+is the compact fourth-order one (fish.c -fsh_order 4).                    */
+typedef enum {SWEEP_JACOBI, SWEEP_REDBLACK} PoissonSweepType;
+
+PetscErrorCode PoissonPCShellSetBlockSmoother(PC pc, PoissonSweepType type,
+                   PetscInt sweeps, PetscReal omega, PetscInt tile);
+
+/* This makes PC into an exact solver for the operator of
+PoissonXDJacobianLocal(), usable with KSPPREONLY or as a PCMG coarse
+solver.  The interior equations are diagonalized by discrete sine
+transforms (DST-I) in each direction, done by a built-in FFT when m-1 is a
+power of two for an m point direction (as it is with -da_refine).
+Otherwise each transform is an O(m^2) sum using an m x m table of sines
+per direction, so both the work and the memory grow quadratically; use
+such grids only if m is small, and see the -info output, which reports
+this fallback.  For each direction the grid is redistributed so that
+each process owns complete lines ("pencils") in that direction.  The
+boundary equations are just diagonal.  It does not solve the compact
+fourth-order operator, so fish.c rejects it with -fsh_order 4.           */
+PetscErrorCode PoissonPCShellSetDST(PC pc);
+
+/* This makes PC into one geometric multigrid V-cycle for the operator of
+PoissonXDJacobianLocal() which is done entirely in single precision (float),
+so it moves half as many bytes as a double-precision PCMG.  The levels come
+from DMCoarsen() of the DMDA, up to maxlevels of them, and each has the
+rediscretized operator.  Smoothing is by the given number of weighted Jacobi
+sweeps before and after the coarse correction, restriction is the transpose
+of linear interpolation, and the coarsest grid gets enough sweeps to solve
+well, 4 m^2 of them, if it has m <= 32 points in each direction.
+
+Coarsening stops as soon as m-1 is odd, for an m point direction, or m < 5.
+Grids with m = 2^k+1, as from -da_refine, coarsen fully.  Other grids give
+shallow hierarchies:  if m-1 = 2^j q with q odd then there are at most j+1
+levels, so for example m = 100 gives only one level.  The coarsest grid is
+then large, its sweeps are capped at 4096, and the V-cycle is weak;
+-info reports this.  There is no redundant coarse solve.
+
+Use this inside a double-precision Krylov method, for example
+    ./fish -fsh_spmg -ksp_type fgmres -ksp_rtol 1.0e-12 -da_refine N
+which recovers double-precision accuracy, as in iterative refinement.
+Because of rounding this PC is not exactly linear or symmetric, so CG can
+stall at tight tolerances; FGMRES and Richardson are robust.  All levels
+use the second-order 5/7-point stencil, so for the compact fourth-order
+operator (fish.c -fsh_order 4) this only preconditions.                   */
+PetscErrorCode PoissonPCShellSetSinglePrecisionMG(PC pc, PetscInt maxlevels,
+                   PetscInt sweeps, PetscReal omega);
+
+/* Optionally the values of g_bdry() and of f_rhs(), the latter multiplied
+by the cell volume (e.g. hx*hy in 2D), can be computed once on the grid of
+a DMDA and stored with it, including ghosts, so that PoissonXDFunctionLocal()
+reads these values instead of calling the functions.  For example, this
+saves the many exp() calls of the fish.c -fsh_problem manuexp case.  Grids
+which are later created from the DMDA by DMCoarsen() (e.g. by PCMG) or
+DMRefine() (e.g. by -snes_grid_sequence) get their own caches.  The cached
+values are not updated if g_bdry, f_rhs, or the coefficients change.      */
+PetscErrorCode PoissonCacheCreate(DM da, PoissonCtx *user);
+
 /* The following function generates an initial iterate using either
   * zero
   * a random function (white noise; *no* smoothness)
-In addition, one can initialize either using the boundary function g for
-the boundary locations in the initial state, or not.                      */
+The random values are uniform in [0,1) and come from a counter-based
+generator keyed on the global grid index, so they are the same for any
+number of processes.  In addition, one can initialize either using the
+boundary function g for the boundary locations in the initial state, or
+not.                                                                      */
 
 typedef enum {ZEROS, RANDOM} InitialType;
 
@@ -0,0 +1,30 @@
+#!/bin/bash
+set -e
+
+# compares the usual point smoothers on the 3D Poisson problem against the
+# space-time blocked smoother from PoissonPCShellSetBlockSmoother(), which
+# is used by -mg_levels_pc_type shell; each smoother application does
+# -fsh_blk_sweeps sweeps on cache-sized tiles with one deep ghost exchange
+
+# use PETSC_ARCH with --with-debugging=0; run as
+#   ./blocksmooth.sh &> blocksmooth.txt
+# and compare iterations and the PCApply time
+
+COMMON="-fsh_dim 3 -fsh_problem manupoly -ksp_rtol 1.0e-10 -ksp_converged_reason -pc_type mg -mg_levels_ksp_type richardson -mg_levels_ksp_max_it 1 -log_view"
+
+function runcase() {
+    CMD="../fish $COMMON $1"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "KSP Solve converged" tmp.txt
+    grep "^PCApply" tmp.txt
+}
+
+for LEV in 4 5 6; do      # 33^3 to 129^3 grids
+    runcase "-da_refine $LEV -mg_levels_pc_type jacobi -mg_levels_ksp_max_it 2 -mg_levels_ksp_richardson_scale 0.6667"
+    runcase "-da_refine $LEV -mg_levels_pc_type shell -fsh_blk_type jacobi -fsh_blk_sweeps 2"
+    runcase "-da_refine $LEV -mg_levels_pc_type shell -fsh_blk_type jacobi -fsh_blk_sweeps 4 -fsh_blk_tile 8"
+    runcase "-da_refine $LEV -mg_levels_pc_type shell -fsh_blk_type redblack -fsh_blk_sweeps 1"
+    runcase "-da_refine $LEV -mg_levels_pc_type shell -fsh_blk_type jacobi -fsh_blk_sweeps 2 -fsh_matfree"
+done
@@ -0,0 +1,33 @@
+#!/bin/bash
+set -e
+
+# compares the DST direct solver from PoissonPCShellSetDST() (i.e.
+# -pc_type shell with KSPPREONLY) against CG+MG, and then uses it as the
+# PCMG coarse solver on a relatively fine coarse grid; also shows an
+# anisotropic case where DST is unaffected
+
+# use PETSC_ARCH with --with-debugging=0; run as
+#   ./dstsolve.sh &> dstsolve.txt
+
+COMMON="-fsh_problem manupoly -log_view"
+
+function runcase() {
+    CMD="../fish $COMMON $1"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "error |u-uexact|_inf" tmp.txt
+    grep "^KSPSolve" tmp.txt
+}
+
+for LEV in 6 7 8 9; do      # 129^2 to 1025^2 grids
+    runcase "-fsh_dim 2 -da_refine $LEV -ksp_rtol 1.0e-10 -pc_type mg"
+    runcase "-fsh_dim 2 -da_refine $LEV -ksp_type preonly -pc_type shell"
+    runcase "-fsh_dim 2 -da_refine $LEV -fsh_cx 0.01 -ksp_type preonly -pc_type shell"
+done
+
+for LEV in 3 4 5 6; do      # 17^3 to 129^3 grids
+    runcase "-fsh_dim 3 -da_refine $LEV -ksp_rtol 1.0e-10 -pc_type mg"
+    runcase "-fsh_dim 3 -da_refine $LEV -ksp_type preonly -pc_type shell"
+    runcase "-fsh_dim 3 -da_refine $LEV -ksp_rtol 1.0e-10 -pc_type mg -pc_mg_levels 3 -mg_coarse_pc_type shell"
+done
@@ -0,0 +1,27 @@
+#!/bin/bash
+set -e
+
+# compares assembled and matrix-free (-fsh_matfree) operators in 3D
+# multigrid; in the matrix-free case only the coarsest level is assembled,
+# so the smoother must need only MatMult() and MatGetDiagonal(); compare
+# the maximum PetscMalloc()ed space and the KSPSolve time
+
+# use PETSC_ARCH with --with-debugging=0; run as
+#   ./matfree.sh &> matfree.txt
+
+COMMON="-fsh_dim 3 -fsh_problem manupoly -ksp_rtol 1.0e-10 -ksp_converged_reason -pc_type mg -mg_levels_ksp_type chebyshev -mg_levels_pc_type jacobi -log_view -memory_view"
+
+function runcase() {
+    CMD="../fish $COMMON $1"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "KSP Solve converged" tmp.txt
+    grep "space PetscMalloc()ed" tmp.txt
+    grep "KSPSolve" tmp.txt
+}
+
+for LEV in 3 4 5 6; do      # 17^3 to 129^3 grids
+    runcase "-da_refine $LEV"
+    runcase "-da_refine $LEV -fsh_matfree"
+done
@@ -0,0 +1,30 @@
+#!/bin/bash
+set -e
+
+# convergence of the second-order (-fsh_order 2) and compact fourth-order
+# (-fsh_order 4) discretizations in 2D and 3D, including an anisotropic
+# case on a non-square domain; the fourth-order errors decrease by about
+# 16 per refinement, so the same error is reached on much coarser grids
+
+# run as
+#   ./order4.sh &> order4.txt
+
+COMMON="-fsh_problem manupoly -ksp_rtol 1.0e-14 -pc_type mg"
+
+function runcase() {
+    CMD="../fish $COMMON $1"
+    echo "COMMAND:  $CMD"
+    $CMD | grep "error |u-uexact|_inf"
+}
+
+for ORDER in 2 4; do
+    for LEV in 2 3 4 5 6 7; do
+        runcase "-fsh_dim 2 -fsh_order $ORDER -da_refine $LEV"
+    done
+    for LEV in 2 3 4 5 6 7; do
+        runcase "-fsh_dim 2 -fsh_order $ORDER -fsh_cx 1 -fsh_cy 0.1 -fsh_Ly 2 -da_refine $LEV"
+    done
+    for LEV in 1 2 3 4 5; do
+        runcase "-fsh_dim 3 -fsh_order $ORDER -da_refine $LEV"
+    done
+done
@@ -0,0 +1,32 @@
+#!/bin/bash
+set -e
+
+# measures the flop rate of the residual evaluations Poisson{2,3}DFunctionLocal()
+# and, with -fsh_split, Poisson{2,3}DFunctionLocalSplit() in
+# ../poissonfunctions.c; under -snes_mf with no preconditioner each Krylov
+# iteration is one residual evaluation, so SNESFunctionEval dominates -log_view
+
+# use PETSC_ARCH with --with-debugging=0; run as
+#   ./residualrate.sh &> residualrate.txt
+# and compare the last (Mflop/s) column of the SNESFunctionEval lines for
+# each grid without and with -fsh_split; both versions log the same flops
+
+COMMON="-fsh_problem manupoly -snes_mf -pc_type none -ksp_type cg -ksp_rtol 0.0 -ksp_max_it 200 -ksp_converged_reason -log_view"
+
+function runcase() {
+    for SPLIT in "" "-fsh_split"; do
+        CMD="../fish $COMMON $1 $SPLIT"
+        echo "COMMAND:  $CMD"
+        rm -rf tmp.txt
+        $CMD &> tmp.txt
+        grep "SNESFunctionEval" tmp.txt
+    done
+}
+
+for LEV in 6 7 8 9; do      # 129^2 to 1025^2 grids
+    runcase "-fsh_dim 2 -da_refine $LEV"
+done
+
+for LEV in 3 4 5 6; do      # 17^3 to 129^3 grids
+    runcase "-fsh_dim 3 -da_refine $LEV"
+done
@@ -0,0 +1,45 @@
+#!/bin/bash
+set -e
+
+# compares a double-precision PCMG V-cycle, with weighted Jacobi smoothing,
+# against the same V-cycle done in single precision by
+# PoissonPCShellSetSinglePrecisionMG() (option -fsh_spmg) inside an FGMRES
+# outer iteration in double precision; the final numerical error and the
+# tight -ksp_rtol show that full double-precision accuracy is recovered
+
+# use PETSC_ARCH with --with-debugging=0; run as
+#   ./spmg.sh &> spmg.txt
+# and compare iterations, errors, and the PCApply time
+
+COMMON="-fsh_problem manupoly -ksp_type fgmres -ksp_rtol 1.0e-12 -ksp_converged_reason -log_view"
+MGDOUBLE="-pc_type mg -mg_levels_ksp_type richardson -mg_levels_ksp_richardson_scale 0.6667 -mg_levels_ksp_max_it 2 -mg_levels_pc_type jacobi"
+
+function runcase() {
+    CMD="../fish $COMMON $1"
+    echo "COMMAND:  $CMD"
+    rm -rf tmp.txt
+    $CMD &> tmp.txt
+    grep "KSP Solve converged" tmp.txt
+    grep "error |u-uexact|_inf" tmp.txt
+    grep "^PCApply" tmp.txt
+}
+
+for LEV in 7 8 9; do      # 257^2 to 1025^2 grids
+    runcase "-fsh_dim 2 -da_refine $LEV $MGDOUBLE -pc_mg_levels $((LEV+1))"
+    runcase "-fsh_dim 2 -da_refine $LEV -fsh_spmg"
+done
+
+for LEV in 4 5 6; do      # 33^3 to 129^3 grids
+    runcase "-fsh_dim 3 -da_refine $LEV $MGDOUBLE -pc_mg_levels $((LEV+1))"
+    runcase "-fsh_dim 3 -da_refine $LEV -fsh_spmg"
+done
+
+# for the minimal surface equation the V-cycle preconditions the Poisson
+# Jacobian inside -snes_mf_operator
+for LEV in 5 6 7; do
+    CMD="../../ch7/minimal -snes_converged_reason -ksp_converged_reason -snes_mf_operator -ksp_type fgmres -da_refine $LEV"
+    echo "COMMAND:  $CMD -pc_type mg"
+    $CMD -pc_type mg | grep "converged\|done"
+    echo "COMMAND:  $CMD -ms_spmg"
+    $CMD -ms_spmg | grep "converged\|done"
+done
@@ -16,9 +16,13 @@ static char help[] =
 "with multigrid as the preconditioner for the diagonal blocks:\n"
 "   -fieldsplit_v_pc_type mg|gamg -fieldsplit_u_pc_type mg|gamg\n"
 "(GMG requires setting levels and Galerkin coarsening.)  One can also do\n"
-"monolithic multigrid (-pc_type mg|gamg).\n\n";
+"monolithic multigrid (-pc_type mg|gamg).  Option prefix bh_.  With\n"
+"-bh_matfree the operator is a MATSHELL which applies both Laplacian\n"
+"blocks in one pass, and the fieldsplit blocks are Poisson MATSHELLs; add\n"
+"-bh_spmg to precondition them by single-precision multigrid V-cycles.\n\n";
 
 #include <petsc.h>
+#include "../ch6/poissonfunctions.h"
 
 typedef struct {
     PetscReal  v, u;
@@ -56,6 +60,10 @@ extern PetscErrorCode FormExactWLocal(DMDALocalInfo*, Field**, BiharmCtx*);
 extern PetscErrorCode FormFunctionLocal(DMDALocalInfo*, Field**, Field **FF, BiharmCtx*);
 extern PetscErrorCode FormJacobianLocal(DMDALocalInfo*, Field**, Mat, Mat, BiharmCtx*);
 
+// for -bh_matfree; see CreateMatrixMF()
+static PetscErrorCode CreateMatrixMF(DM, Mat*);
+static PetscErrorCode JacobianMF(DMDALocalInfo*, Field**, Mat, Mat, BiharmCtx*);
+
 int main(int argc,char **argv) {
     PetscErrorCode ierr;
     DM             da;
@@ -65,10 +73,25 @@ int main(int argc,char **argv) {
     Field          **aW;
     PetscReal      normv, normu, errv, erru;
     DMDALocalInfo  info;
+    PetscBool      matfree = PETSC_FALSE,
+                   spmg = PETSC_FALSE;
 
     ierr = PetscInitialize(&argc,&argv,NULL,help); if (ierr) return ierr;
 
     user.f = &f_fcn;
+    ierr = PetscOptionsBegin(PETSC_COMM_WORLD,"bh_",
+                             "biharmonic equation solver options",""); CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-matfree",
+                            "apply the operator as a fused two-field stencil MATSHELL",
+                            "biharm.c",matfree,&matfree,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-spmg",
+                            "with -bh_matfree and -pc_type fieldsplit, precondition blocks by single-precision MG",
+                            "biharm.c",spmg,&spmg,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsEnd(); CHKERRQ(ierr);
+    if (spmg && !matfree) {
+        SETERRQ(PETSC_COMM_SELF,1,"-bh_spmg requires -bh_matfree\n");
+    }
+
     ierr = DMDACreate2d(PETSC_COMM_WORLD,
                         DM_BOUNDARY_NONE, DM_BOUNDARY_NONE, DMDA_STENCIL_STAR,
                         3,3,PETSC_DECIDE,PETSC_DECIDE,
@@ -80,15 +103,62 @@ int main(int argc,char **argv) {
     ierr = DMDASetUniformCoordinates(da,0.0,1.0,0.0,1.0,-1.0,-1.0); CHKERRQ(ierr);
     ierr = DMDASetFieldName(da,0,"v"); CHKERRQ(ierr);
     ierr = DMDASetFieldName(da,1,"u"); CHKERRQ(ierr);
+    if (matfree) {
+        ierr = DMDASetGetMatrix(da,CreateMatrixMF); CHKERRQ(ierr);
+    }
 
     ierr = SNESCreate(PETSC_COMM_WORLD,&snes); CHKERRQ(ierr);
     ierr = SNESSetDM(snes,da); CHKERRQ(ierr);
     ierr = DMDASNESSetFunctionLocal(da,INSERT_VALUES,
                (DMDASNESFunction)FormFunctionLocal,&user); CHKERRQ(ierr);
     ierr = DMDASNESSetJacobianLocal(da,
-               (DMDASNESJacobian)FormJacobianLocal,&user); CHKERRQ(ierr);
+               (DMDASNESJacobian)(matfree ? JacobianMF : FormJacobianLocal),
+               &user); CHKERRQ(ierr);
     ierr = SNESSetType(snes,SNESKSPONLY); CHKERRQ(ierr);
     ierr = SNESSetFromOptions(snes); CHKERRQ(ierr);
+    if (matfree) {
+        // BiharmMatCreateSubMatrix() gives only diagonal blocks and row blocks
+        KSP             ksp;
+        PC              pc;
+        PetscBool       isfs;
+        PCCompositeType ctype;
+        ierr = SNESGetKSP(snes,&ksp); CHKERRQ(ierr);
+        ierr = KSPGetPC(ksp,&pc); CHKERRQ(ierr);
+        ierr = PetscObjectTypeCompare((PetscObject)pc,PCFIELDSPLIT,&isfs); CHKERRQ(ierr);
+        if (isfs) {
+            ierr = PCFieldSplitGetType(pc,&ctype); CHKERRQ(ierr);
+            if (ctype != PC_COMPOSITE_ADDITIVE && ctype != PC_COMPOSITE_MULTIPLICATIVE
+                    && ctype != PC_COMPOSITE_SYMMETRIC_MULTIPLICATIVE) {
+                SETERRQ(PETSC_COMM_SELF,3,
+                        "-bh_matfree requires -pc_fieldsplit_type additive, multiplicative, or symmetric_multiplicative\n");
+            }
+        }
+    }
+    if (spmg) {
+        // set up the fieldsplit now, so that its blocks exist, and make the
+        // block PCs into PoissonPCShellSetSinglePrecisionMG() V-cycles
+        KSP       ksp, *subksp;
+        PC        pc, subpc;
+        Mat       J;
+        PetscInt  nsplit, k;
+        PetscBool isfs;
+        ierr = SNESGetKSP(snes,&ksp); CHKERRQ(ierr);
+        ierr = KSPGetPC(ksp,&pc); CHKERRQ(ierr);
+        ierr = PetscObjectTypeCompare((PetscObject)pc,PCFIELDSPLIT,&isfs); CHKERRQ(ierr);
+        if (!isfs) {
+            SETERRQ(PETSC_COMM_SELF,2,"-bh_spmg requires -pc_type fieldsplit\n");
+        }
+        ierr = SNESSetUp(snes); CHKERRQ(ierr);
+        ierr = SNESGetJacobian(snes,&J,NULL,NULL,NULL); CHKERRQ(ierr);
+        ierr = KSPSetOperators(ksp,J,J); CHKERRQ(ierr);
+        ierr = KSPSetUp(ksp); CHKERRQ(ierr);
+        ierr = PCFieldSplitGetSubKSP(pc,&nsplit,&subksp); CHKERRQ(ierr);
+        for (k = 0; k < nsplit; k++) {
+            ierr = KSPGetPC(subksp[k],&subpc); CHKERRQ(ierr);
+            ierr = PoissonPCShellSetSinglePrecisionMG(subpc,20,2,2.0/3.0); CHKERRQ(ierr);
+        }
+        ierr = PetscFree(subksp); CHKERRQ(ierr);
+    }
 
     ierr = DMGetGlobalVector(da,&w_initial); CHKERRQ(ierr);
     ierr = VecSet(w_initial,0.0); CHKERRQ(ierr);
@@ -241,3 +311,257 @@ PetscErrorCode FormJacobianLocal(DMDALocalInfo *info, Field **aW,
     return 0;
 }
 
+
+/* For -bh_matfree the DMDA creates this MATSHELL instead of an AIJ matrix.
+MatMult() applies both Laplacian blocks, and the -I coupling, in one pass
+over the interleaved Field arrays, so the stencil is not stored, twice, as
+matrix entries.  For PCFIELDSPLIT, MatCreateSubMatrix() gives, for a
+diagonal block, a Poisson MATSHELL from PoissonMatCreateShell() on a scalar
+DMDA with the same parallel layout, and, for the rows of one field (as
+used by multiplicative fieldsplit), a MATSHELL which applies the full
+operator and extracts that field.  Off-diagonal blocks are not supported,
+so neither is -pc_fieldsplit_type schur.  The block PCs must be matrix-free,
+e.g. -fieldsplit_v_pc_type jacobi or -bh_spmg. */
+typedef struct {
+    DM         da1;    // scalar DMDA for the diagonal blocks; NULL until needed
+    PoissonCtx pctx;   // its application context; cx = cy = 1
+} BiharmMF;
+
+typedef struct {
+    Mat        A;      // the full operator; not referenced
+    PetscInt   c;      // the field of the rows
+    Vec        work;   // full-size product
+} BiharmRows;
+
+static void BiharmMultLocal(DMDALocalInfo *info, PetscReal hx, PetscReal hy,
+                            Field **aX, Field **aY) {
+    const PetscReal darea = hx * hy, scx = hy / hx, scy = hx / hy,
+                    scdiag = 2.0 * (scx + scy);
+    PetscInt   i, j;
+    PetscReal  ve, vw, vn, vs, ue, uw, un, us;
+    for (j = info->ys; j < info->ys + info->ym; j++) {
+        for (i = info->xs; i < info->xs + info->xm; i++) {
+            if (i==0 || i==info->mx-1 || j==0 || j==info->my-1) {
+                aY[j][i].v = scdiag * aX[j][i].v;
+                aY[j][i].u = scdiag * aX[j][i].u;
+                continue;
+            }
+            // boundary values do not enter interior rows; see FormJacobianLocal()
+            if (i+1 == info->mx-1) { ve = 0.0;  ue = 0.0; }
+            else                   { ve = aX[j][i+1].v;  ue = aX[j][i+1].u; }
+            if (i-1 == 0)          { vw = 0.0;  uw = 0.0; }
+            else                   { vw = aX[j][i-1].v;  uw = aX[j][i-1].u; }
+            if (j+1 == info->my-1) { vn = 0.0;  un = 0.0; }
+            else                   { vn = aX[j+1][i].v;  un = aX[j+1][i].u; }
+            if (j-1 == 0)          { vs = 0.0;  us = 0.0; }
+            else                   { vs = aX[j-1][i].v;  us = aX[j-1][i].u; }
+            aY[j][i].v = scdiag * aX[j][i].v - scx * (vw + ve) - scy * (vs + vn);
+            aY[j][i].u = - darea * aX[j][i].v
+                         + scdiag * aX[j][i].u - scx * (uw + ue) - scy * (us + un);
+        }
+    }
+}
+
+static PetscErrorCode BiharmMatMult(Mat A, Vec x, Vec y) {
+    PetscErrorCode ierr;
+    DM             da;
+    DMDALocalInfo  info;
+    Vec            xloc;
+    Field          **aX, **aY;
+    PetscReal      xymin[2], xymax[2], hx, hy;
+
+    ierr = MatGetDM(A,&da); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = DMGetBoundingBox(da,xymin,xymax); CHKERRQ(ierr);
+    hx = (xymax[0] - xymin[0]) / (info.mx - 1);
+    hy = (xymax[1] - xymin[1]) / (info.my - 1);
+    ierr = DMGetLocalVector(da,&xloc); CHKERRQ(ierr);
+    ierr = DMGlobalToLocalBegin(da,x,INSERT_VALUES,xloc); CHKERRQ(ierr);
+    ierr = DMGlobalToLocalEnd(da,x,INSERT_VALUES,xloc); CHKERRQ(ierr);
+    ierr = DMDAVecGetArrayRead(da,xloc,&aX); CHKERRQ(ierr);
+    ierr = DMDAVecGetArray(da,y,&aY); CHKERRQ(ierr);
+    BiharmMultLocal(&info,hx,hy,aX,aY);
+    ierr = DMDAVecRestoreArrayRead(da,xloc,&aX); CHKERRQ(ierr);
+    ierr = DMDAVecRestoreArray(da,y,&aY); CHKERRQ(ierr);
+    ierr = DMRestoreLocalVector(da,&xloc); CHKERRQ(ierr);
+    ierr = PetscLogFlops(16.0*info.xm*info.ym); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode BiharmMatGetDiagonal(Mat A, Vec d) {
+    PetscErrorCode ierr;
+    DM             da;
+    DMDALocalInfo  info;
+    PetscReal      xymin[2], xymax[2], hx, hy;
+    ierr = MatGetDM(A,&da); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = DMGetBoundingBox(da,xymin,xymax); CHKERRQ(ierr);
+    hx = (xymax[0] - xymin[0]) / (info.mx - 1);
+    hy = (xymax[1] - xymin[1]) / (info.my - 1);
+    ierr = VecSet(d,2.0 * (hy / hx + hx / hy)); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode BiharmMatDestroy(Mat A) {
+    PetscErrorCode ierr;
+    BiharmMF       *mf;
+    ierr = MatShellGetContext(A,&mf); CHKERRQ(ierr);
+    ierr = DMDestroy(&(mf->da1)); CHKERRQ(ierr);
+    ierr = PetscFree(mf); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode BiharmRowsMult(Mat B, Vec x, Vec y) {
+    PetscErrorCode ierr;
+    BiharmRows     *rows;
+    ierr = MatShellGetContext(B,&rows); CHKERRQ(ierr);
+    ierr = MatMult(rows->A,x,rows->work); CHKERRQ(ierr);
+    ierr = VecStrideGather(rows->work,rows->c,y,INSERT_VALUES); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode BiharmRowsDestroy(Mat B) {
+    PetscErrorCode ierr;
+    BiharmRows     *rows;
+    ierr = MatShellGetContext(B,&rows); CHKERRQ(ierr);
+    ierr = VecDestroy(&(rows->work)); CHKERRQ(ierr);
+    ierr = PetscFree(rows); CHKERRQ(ierr);
+    return 0;
+}
+
+// the scalar DMDA has the ownership ranges and coordinates of the two-field one
+static PetscErrorCode BiharmScalarDM(DM da, BiharmMF *mf) {
+    PetscErrorCode ierr;
+    PetscInt       mx, my, px, py;
+    const PetscInt *lx, *ly;
+    PetscReal      xymin[2], xymax[2];
+    if (mf->da1)
+        return 0;
+    ierr = DMDAGetInfo(da,NULL,&mx,&my,NULL,&px,&py,NULL,
+                       NULL,NULL,NULL,NULL,NULL,NULL); CHKERRQ(ierr);
+    ierr = DMDAGetOwnershipRanges(da,&lx,&ly,NULL); CHKERRQ(ierr);
+    ierr = DMGetBoundingBox(da,xymin,xymax); CHKERRQ(ierr);
+    ierr = DMDACreate2d(PetscObjectComm((PetscObject)da),
+                        DM_BOUNDARY_NONE, DM_BOUNDARY_NONE, DMDA_STENCIL_STAR,
+                        mx,my,px,py,1,1,lx,ly,&(mf->da1)); CHKERRQ(ierr);
+    ierr = DMSetUp(mf->da1); CHKERRQ(ierr);
+    ierr = DMDASetUniformCoordinates(mf->da1,xymin[0],xymax[0],xymin[1],xymax[1],
+                                     -1.0,-1.0); CHKERRQ(ierr);
+    mf->pctx.Lx = xymax[0] - xymin[0];
+    mf->pctx.Ly = xymax[1] - xymin[1];
+    mf->pctx.Lz = 1.0;
+    mf->pctx.cx = 1.0;
+    mf->pctx.cy = 1.0;
+    mf->pctx.cz = 1.0;
+    mf->pctx.f_rhs = NULL;
+    mf->pctx.g_bdry = NULL;
+    mf->pctx.addctx = NULL;
+    ierr = DMSetApplicationContext(mf->da1,&(mf->pctx)); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode BiharmMatCreateSubMatrix(Mat A, IS isrow, IS iscol,
+                                               MatReuse reuse, Mat *B) {
+    PetscErrorCode ierr;
+    MPI_Comm       comm;
+    DM             da;
+    BiharmMF       *mf;
+    BiharmRows     *rows;
+    IS             isc;
+    PetscInt       c, rstart, cstart, n, N, ncol, first, step;
+    PetscBool      flg = PETSC_FALSE, lall, allcols = PETSC_TRUE;
+
+    if (reuse == MAT_REUSE_MATRIX)
+        return 0;  // the operator is linear and never changes
+    ierr = PetscObjectGetComm((PetscObject)A,&comm); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRange(A,&rstart,NULL); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRangeColumn(A,&cstart,NULL); CHKERRQ(ierr);
+    ierr = MatGetLocalSize(A,&n,NULL); CHKERRQ(ierr);
+    ierr = MatGetSize(A,&N,NULL); CHKERRQ(ierr);
+    for (c = 0; c < 2; c++) {
+        ierr = ISCreateStride(comm,n/2,rstart+c,2,&isc); CHKERRQ(ierr);
+        ierr = ISEqual(isrow,isc,&flg); CHKERRQ(ierr);
+        ierr = ISDestroy(&isc); CHKERRQ(ierr);
+        if (flg)
+            break;
+    }
+    if (!flg) {
+        SETERRQ(comm,PETSC_ERR_SUP,"-bh_matfree submatrices must have the rows of one field\n");
+    }
+    // MatCreateSubMatrix() replaces a NULL iscol by a stride IS of all the
+    // columns; multiplicative PCFIELDSPLIT asks for such row blocks
+    if (iscol) {
+        lall = PETSC_FALSE;
+        ierr = PetscObjectTypeCompare((PetscObject)iscol,ISSTRIDE,&flg); CHKERRQ(ierr);
+        if (flg) {
+            ierr = ISGetLocalSize(iscol,&ncol); CHKERRQ(ierr);
+            ierr = ISStrideGetInfo(iscol,&first,&step); CHKERRQ(ierr);
+            lall = (ncol == n && (ncol == 0 || (first == cstart && step == 1)))
+                   ? PETSC_TRUE : PETSC_FALSE;
+        }
+        ierr = MPI_Allreduce(&lall,&allcols,1,MPIU_BOOL,MPI_LAND,comm); CHKERRQ(ierr);
+    }
+    if (!allcols) {
+        ierr = ISEqual(isrow,iscol,&flg); CHKERRQ(ierr);
+        if (!flg) {
+            SETERRQ(comm,PETSC_ERR_SUP,"-bh_matfree supports only diagonal blocks\n");
+        }
+        ierr = MatGetDM(A,&da); CHKERRQ(ierr);
+        ierr = MatShellGetContext(A,&mf); CHKERRQ(ierr);
+        ierr = BiharmScalarDM(da,mf); CHKERRQ(ierr);
+        ierr = PoissonMatCreateShell(mf->da1,B); CHKERRQ(ierr);
+    } else {
+        ierr = PetscNew(&rows); CHKERRQ(ierr);
+        rows->A = A;
+        rows->c = c;
+        ierr = MatCreateVecs(A,NULL,&(rows->work)); CHKERRQ(ierr);
+        ierr = MatCreateShell(comm,n/2,n,N/2,N,rows,B); CHKERRQ(ierr);
+        ierr = MatShellSetOperation(*B,MATOP_MULT,
+                                    (void(*)(void))BiharmRowsMult); CHKERRQ(ierr);
+        ierr = MatShellSetOperation(*B,MATOP_DESTROY,
+                                    (void(*)(void))BiharmRowsDestroy); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+static PetscErrorCode CreateMatrixMF(DM da, Mat *A) {
+    PetscErrorCode ierr;
+    BiharmMF       *mf;
+    Vec            v;
+    PetscInt       n, N;
+    ierr = DMGetGlobalVector(da,&v); CHKERRQ(ierr);
+    ierr = VecGetLocalSize(v,&n); CHKERRQ(ierr);
+    ierr = VecGetSize(v,&N); CHKERRQ(ierr);
+    ierr = DMRestoreGlobalVector(da,&v); CHKERRQ(ierr);
+    ierr = PetscNew(&mf); CHKERRQ(ierr);
+    ierr = MatCreateShell(PetscObjectComm((PetscObject)da),n,n,N,N,mf,A); CHKERRQ(ierr);
+    ierr = MatSetDM(*A,da); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A,MATOP_MULT,
+                                (void(*)(void))BiharmMatMult); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A,MATOP_GET_DIAGONAL,
+                                (void(*)(void))BiharmMatGetDiagonal); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A,MATOP_CREATE_SUBMATRIX,
+                                (void(*)(void))BiharmMatCreateSubMatrix); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A,MATOP_DESTROY,
+                                (void(*)(void))BiharmMatDestroy); CHKERRQ(ierr);
+    return 0;
+}
+
+// a MATSHELL needs no filling because the problem is linear
+static PetscErrorCode JacobianMF(DMDALocalInfo *info, Field **aW,
+                                 Mat J, Mat Jpre, BiharmCtx *user) {
+    PetscErrorCode ierr;
+    PetscBool      isshell;
+    ierr = PetscObjectTypeCompare((PetscObject)Jpre,MATSHELL,&isshell); CHKERRQ(ierr);
+    if (!isshell) {
+        ierr = FormJacobianLocal(info,aW,J,Jpre,user); CHKERRQ(ierr);
+        return 0;
+    }
+    ierr = MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    if (J != Jpre) {
+        ierr = MatAssemblyBegin(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+        ierr = MatAssemblyEnd(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    }
+    return 0;
+}
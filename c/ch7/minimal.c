@@ -6,14 +6,17 @@ static char help[] =
 "conditions u = g(x,y).  Power q defaults to -1/2 but can be set (by -ms_q).\n"
 "Catenoid and tent boundary conditions are implemented; catenoid is an exact\n"
 "solution.  The discretization is structured-grid (DMDA) finite differences.\n"
-"We re-use the Jacobian from the Poisson equation, but it is suitable only\n"
-"for low-amplitude g, or as preconditioning material in -snes_mf_operator.\n"
-"Options -snes_fd_color and -snes_grid_sequence are recommended.\n"
+"The Jacobian is exact.  Option -ms_poisson_jacobian re-uses the Jacobian\n"
+"from the Poisson equation instead, which is suitable only for low-amplitude\n"
+"g, or as preconditioning material in -snes_mf_operator.\n"
+"Option -snes_grid_sequence is recommended.  A nonlinear Gauss-Seidel\n"
+"smoother is implemented, so matrix-free -snes_type fas also works.\n"
 "This code is multigrid (GMG) capable.\n\n";
 
 #include <petsc.h>
 #include "../ch6/poissonfunctions.h"
 #include "../interlude/quadrature.h"
+#include "../interlude/stencilcsr.h"
 
 typedef struct {
     PetscReal q,          // the exponent in the diffusivity;
@@ -47,6 +50,11 @@ static PetscReal DD(PetscReal w, PetscReal q) {
     return pow(1.0 + w,q);
 }
 
+// derivative of DD(w,q) with respect to w
+static PetscReal dDD(PetscReal w, PetscReal q) {
+    return q * pow(1.0 + w,q - 1.0);
+}
+
 typedef enum {TENT, CATENOID} ProblemType;
 static const char* ProblemTypes[] = {"tent","catenoid",
                                      "ProblemType", "", NULL};
@@ -54,6 +62,9 @@ static const char* ProblemTypes[] = {"tent","catenoid",
 extern PetscErrorCode FormExactFromG(DMDALocalInfo*, Vec, PoissonCtx*);
 extern PetscErrorCode FormFunctionLocal(DMDALocalInfo*, PetscReal**,
                                         PetscReal **FF, PoissonCtx*);
+extern PetscErrorCode FormJacobianLocal(DMDALocalInfo*, PetscReal**,
+                                        Mat, Mat, PoissonCtx*);
+extern PetscErrorCode NonlinearGS(SNES, Vec, Vec, void*);
 extern PetscErrorCode MSEMonitor(SNES, int, PetscReal, void*);
 
 int main(int argc, char **argv) {
@@ -64,7 +75,9 @@ int main(int argc, char **argv) {
     PoissonCtx     user;
     MinimalCtx     mctx;
     PetscBool      monitor = PETSC_FALSE,
-                   exact_init = PETSC_FALSE;
+                   exact_init = PETSC_FALSE,
+                   poisson_jacobian = PETSC_FALSE,
+                   spmg = PETSC_FALSE;
     DMDALocalInfo  info;
     ProblemType    problem = CATENOID;
 
@@ -89,6 +102,9 @@ int main(int argc, char **argv) {
     ierr = PetscOptionsBool("-monitor",
                             "print surface area and diffusivity bounds at each SNES iteration",
                             "minimal.c",monitor,&(monitor),NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-poisson_jacobian",
+                            "use the (approximate) Jacobian of the Poisson equation",
+                            "minimal.c",poisson_jacobian,&(poisson_jacobian),NULL);CHKERRQ(ierr);
     ierr = PetscOptionsReal("-q",
                             "power of (1+|grad u|^2) in diffusivity",
                             "minimal.c",mctx.q,&(mctx.q),NULL); CHKERRQ(ierr);
@@ -99,6 +115,9 @@ int main(int argc, char **argv) {
                             "problem type determines boundary conditions",
                             "minimal.c",ProblemTypes,(PetscEnum)problem,(PetscEnum*)&problem,
                             NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-spmg",
+                            "precondition by single-precision MG V-cycle on the Poisson Jacobian",
+                            "minimal.c",spmg,&(spmg),NULL);CHKERRQ(ierr);
     ierr = PetscOptionsReal("-tent_H",
                             "'door' height for problem tent",
                             "minimal.c",mctx.tent_H,&(mctx.tent_H),NULL); CHKERRQ(ierr);
@@ -140,14 +159,28 @@ int main(int argc, char **argv) {
     ierr = SNESSetDM(snes,da); CHKERRQ(ierr);
     ierr = DMDASNESSetFunctionLocal(da,INSERT_VALUES,
                (DMDASNESFunction)FormFunctionLocal,&user); CHKERRQ(ierr);
-    // this is the Jacobian of the Poisson equation, thus ONLY APPROXIMATE;
-    //     generally use -snes_fd_color or -snes_mf_operator
-    ierr = DMDASNESSetJacobianLocal(da,
-               (DMDASNESJacobian)Poisson2DJacobianLocal,&user); CHKERRQ(ierr);
+    ierr = SNESSetNGS(snes,NonlinearGS,&user); CHKERRQ(ierr);
+    if (poisson_jacobian) {
+        // this is the Jacobian of the Poisson equation, thus ONLY APPROXIMATE;
+        //     generally use -snes_fd_color or -snes_mf_operator
+        ierr = DMDASNESSetJacobianLocal(da,
+                   (DMDASNESJacobian)Poisson2DJacobianLocal,&user); CHKERRQ(ierr);
+    } else {
+        ierr = DMDASNESSetJacobianLocal(da,
+                   (DMDASNESJacobian)FormJacobianLocal,&user); CHKERRQ(ierr);
+    }
     if (monitor) {
         ierr = SNESMonitorSet(snes,MSEMonitor,&user,NULL); CHKERRQ(ierr);
     }
     ierr = SNESSetFromOptions(snes); CHKERRQ(ierr);
+    if (spmg) {
+        // see PoissonPCShellSetSinglePrecisionMG() in ../ch6/poissonfunctions.h
+        KSP ksp;
+        PC  pc;
+        ierr = SNESGetKSP(snes,&ksp); CHKERRQ(ierr);
+        ierr = KSPGetPC(ksp,&pc); CHKERRQ(ierr);
+        ierr = PoissonPCShellSetSinglePrecisionMG(pc,20,2,2.0/3.0); CHKERRQ(ierr);
+    }
 
     ierr = DMGetGlobalVector(da,&u_initial); CHKERRQ(ierr);
     if ((problem == CATENOID) && (mctx.q == -0.5) && (exact_init)) {
@@ -208,78 +241,368 @@ PetscErrorCode FormExactFromG(DMDALocalInfo *info, Vec uexact,
     return 0;
 }
 
+// assign neighbor values of interior point (i,j) with either boundary
+// condition or current u at that point (==> symmetric matrix)
+static void Neighbors(DMDALocalInfo *info, PetscReal **au,
+                      PetscInt i, PetscInt j, PetscReal x, PetscReal y,
+                      PetscReal hx, PetscReal hy, PoissonCtx *user,
+                      PetscReal *ue, PetscReal *uw, PetscReal *un, PetscReal *us,
+                      PetscReal *une, PetscReal *unw, PetscReal *use, PetscReal *usw) {
+    *ue  = (i+1 == info->mx-1) ? user->g_bdry(x+hx,y,0.0,user)
+                               : au[j][i+1];
+    *uw  = (i-1 == 0)          ? user->g_bdry(x-hx,y,0.0,user)
+                               : au[j][i-1];
+    *un  = (j+1 == info->my-1) ? user->g_bdry(x,y+hy,0.0,user)
+                               : au[j+1][i];
+    *us  = (j-1 == 0)          ? user->g_bdry(x,y-hy,0.0,user)
+                               : au[j-1][i];
+    if (i+1 == info->mx-1 || j+1 == info->my-1) {
+        *une = user->g_bdry(x+hx,y+hy,0.0,user);
+    } else {
+        *une = au[j+1][i+1];
+    }
+    if (i-1 == 0 || j+1 == info->my-1) {
+        *unw = user->g_bdry(x-hx,y+hy,0.0,user);
+    } else {
+        *unw = au[j+1][i-1];
+    }
+    if (i+1 == info->mx-1 || j-1 == 0) {
+        *use = user->g_bdry(x+hx,y-hy,0.0,user);
+    } else {
+        *use = au[j-1][i+1];
+    }
+    if (i-1 == 0 || j-1 == 0) {
+        *usw = user->g_bdry(x-hx,y-hy,0.0,user);
+    } else {
+        *usw = au[j-1][i-1];
+    }
+}
+
+// D[k] = DD(w[k],q) for a row of faces; q = -1/2 (minimal surface) and
+// q = 0 (Laplace) avoid pow() and vectorize
+static void DDVec(PetscInt n, const PetscReal *w, PetscReal q, PetscReal *D) {
+    PetscInt k;
+    if (q == -0.5) {
+        PetscPragmaSIMD
+        for (k = 0; k < n; k++)
+            D[k] = 1.0 / PetscSqrtReal(1.0 + w[k]);
+    } else if (q == 0.0) {
+        for (k = 0; k < n; k++)
+            D[k] = 1.0;
+    } else {
+        for (k = 0; k < n; k++)
+            D[k] = DD(w[k],q);
+    }
+}
+
+// The residual is computed in two passes over each row.  First the face
+// fluxes  D (u_E - u_P)  are computed once for each face, into row buffers,
+// using copies ub of the nodal values in which boundary values come from g.
+// Then the residual at each node is the divergence of the four face fluxes.
+// Thus each face diffusivity is evaluated once, not twice.
 PetscErrorCode FormFunctionLocal(DMDALocalInfo *info, PetscReal **au,
                                  PetscReal **FF, PoissonCtx *user) {
     PetscErrorCode ierr;
     MinimalCtx *mctx = (MinimalCtx*)(user->addctx);
-    PetscInt   i, j;
+    PetscInt   i, j, k, i0, i1, j0, j1, bw, nx;
+    PetscReal  xymin[2], xymax[2], hx, hy, hxhy, hyhx, x, y, dux, duy,
+               *ub, *w, *fx, *fy, *fs, *fn, *tmp;
+    ierr = DMGetBoundingBox(info->da,xymin,xymax); CHKERRQ(ierr);
+    hx = (xymax[0] - xymin[0]) / (info->mx - 1);
+    hy = (xymax[1] - xymin[1]) / (info->my - 1);
+    hxhy = hx / hy;
+    hyhx = hy / hx;
+    // owned interior nodes are i0 <= i < i1, j0 <= j < j1
+    i0 = PetscMax(info->xs,1);
+    i1 = PetscMin(info->xs + info->xm,info->mx-1);
+    j0 = PetscMax(info->ys,1);
+    j1 = PetscMin(info->ys + info->ym,info->my-1);
+    nx = i1 - i0;
+    // ub holds owned and ghost nodes, with UB(i,j) at global (i,j)
+    bw = info->xm + 2;
+    ierr = PetscMalloc4(bw * (info->ym + 2),&ub,bw,&w,bw,&fx,2 * bw,&fy); CHKERRQ(ierr);
+#define UB(i,j) ub[((j) - info->ys + 1) * bw + (i) - info->xs + 1]
+    for (j = PetscMax(info->ys-1,0); j < PetscMin(info->ys+info->ym+1,info->my); j++) {
+        y = j * hy;
+        for (i = PetscMax(info->xs-1,0); i < PetscMin(info->xs+info->xm+1,info->mx); i++) {
+            if (j==0 || i==0 || i==info->mx-1 || j==info->my-1) {
+                x = i * hx;
+                UB(i,j) = user->g_bdry(x,y,0.0,user);
+            } else
+                UB(i,j) = au[j][i];
+        }
+    }
+    // boundary residuals
+    for (j = info->ys; j < info->ys + info->ym; j++) {
+        for (i = info->xs; i < info->xs + info->xm; i++) {
+            if (j==0 || i==0 || i==info->mx-1 || j==info->my-1)
+                FF[j][i] = au[j][i] - UB(i,j);
+        }
+    }
+    if (nx <= 0 || j1 <= j0) {
+        ierr = PetscFree4(ub,w,fx,fy); CHKERRQ(ierr);
+        return 0;
+    }
+    // fs[i-i0] is the flux through the south face (i,j-1/2), fn[i-i0]
+    //   through the north face (i,j+1/2)
+    fs = fy;
+    fn = fy + bw;
+    for (j = j0 - 1; j < j1; j++) {
+        // north faces of row j, which are south faces of row j+1
+        PetscPragmaSIMD
+        for (i = i0; i < i1; i++) {
+            dux = (UB(i+1,j) + UB(i+1,j+1) - UB(i-1,j) - UB(i-1,j+1)) / (4.0 * hx);
+            duy = (UB(i,j+1) - UB(i,j)) / hy;
+            w[i-i0] = dux * dux + duy * duy;
+        }
+        DDVec(nx,w,mctx->q,fn);
+        for (i = i0; i < i1; i++)
+            fn[i-i0] *= UB(i,j+1) - UB(i,j);
+        if (j >= j0) {
+            // east faces (k+1/2,j) for k = i0-1,...,i1-1
+            PetscPragmaSIMD
+            for (k = i0 - 1; k < i1; k++) {
+                dux = (UB(k+1,j) - UB(k,j)) / hx;
+                duy = (UB(k,j+1) + UB(k+1,j+1) - UB(k,j-1) - UB(k+1,j-1)) / (4.0 * hy);
+                w[k-i0+1] = dux * dux + duy * duy;
+            }
+            DDVec(nx+1,w,mctx->q,fx);
+            for (k = i0 - 1; k < i1; k++)
+                fx[k-i0+1] *= UB(k+1,j) - UB(k,j);
+            // divergence of fluxes
+            for (i = i0; i < i1; i++)
+                FF[j][i] = - hyhx * (fx[i-i0+1] - fx[i-i0])
+                           - hxhy * (fn[i-i0] - fs[i-i0]);
+        }
+        tmp = fs;  fs = fn;  fn = tmp;
+    }
+#undef UB
+    ierr = PetscFree4(ub,w,fx,fy); CHKERRQ(ierr);
+    return 0;
+}
+
+// The exact Jacobian of FormFunctionLocal().  Each face diffusivity, e.g.
+// De = DD(We,q), depends on the gradient at the face, which uses the corner
+// neighbors, so the stencil has 9 points.  For the east face the residual
+// term is  - hyhx De (ue - u), with derivative
+//     - hyhx [ dDD(We,q) dWe/dv (ue - u) + De d(ue - u)/dv ]
+// with respect to a stencil value v, where  dWe/dv = 2 (dux ddux/dv + duy
+// dduy/dv).  As with the Poisson Jacobian, boundary rows are diagonal and
+// interior rows have no entries for boundary values.
+PetscErrorCode FormJacobianLocal(DMDALocalInfo *info, PetscReal **au,
+                                 Mat J, Mat Jpre, PoissonCtx *user) {
+    PetscErrorCode ierr;
+    MinimalCtx *mctx = (MinimalCtx*)(user->addctx);
+    PetscInt   i, j, di, dj, ii, jj, ncols;
     PetscReal  xymin[2], xymax[2], hx, hy, hxhy, hyhx, x, y,
                ue, uw, un, us, une, use, unw, usw,
-               dux, duy, De, Dw, Dn, Ds;
+               dux, duy, a, b, c, v[9], w[3][3];
+    MatStencil col[9], row;
+    StencilCSR *csr;
+
     ierr = DMGetBoundingBox(info->da,xymin,xymax); CHKERRQ(ierr);
     hx = (xymax[0] - xymin[0]) / (info->mx - 1);
     hy = (xymax[1] - xymin[1]) / (info->my - 1);
     hxhy = hx / hy;
     hyhx = hy / hx;
+    ierr = StencilCSRBegin(info->da,Jpre,&csr); CHKERRQ(ierr);
     for (j = info->ys; j < info->ys + info->ym; j++) {
         y = j * hy;
+        row.j = j;
         for (i = info->xs; i < info->xs + info->xm; i++) {
             x = i * hx;
+            row.i = i;
             if (j==0 || i==0 || i==info->mx-1 || j==info->my-1) {
-                FF[j][i] = au[j][i] - user->g_bdry(x,y,0.0,user);
-            } else {
-                // assign neighbor values with either boundary condition or
-                //     current u at that point (==> symmetric matrix)
-                ue  = (i+1 == info->mx-1) ? user->g_bdry(x+hx,y,0.0,user)
-                                          : au[j][i+1];
-                uw  = (i-1 == 0)          ? user->g_bdry(x-hx,y,0.0,user)
-                                          : au[j][i-1];
-                un  = (j+1 == info->my-1) ? user->g_bdry(x,y+hy,0.0,user)
-                                          : au[j+1][i];
-                us  = (j-1 == 0)          ? user->g_bdry(x,y-hy,0.0,user)
-                                          : au[j-1][i];
-                if (i+1 == info->mx-1 || j+1 == info->my-1) {
-                    une = user->g_bdry(x+hx,y+hy,0.0,user);
-                } else {
-                    une = au[j+1][i+1];
-                }
-                if (i-1 == 0 || j+1 == info->my-1) {
-                    unw = user->g_bdry(x-hx,y+hy,0.0,user);
-                } else {
-                    unw = au[j+1][i-1];
-                }
-                if (i+1 == info->mx-1 || j-1 == 0) {
-                    use = user->g_bdry(x+hx,y-hy,0.0,user);
-                } else {
-                    use = au[j-1][i+1];
+                v[0] = 1.0;
+                ierr = StencilCSRSetValues(csr,&row,1,&row,v,INSERT_VALUES); CHKERRQ(ierr);
+                continue;
+            }
+            Neighbors(info,au,i,j,x,y,hx,hy,user,
+                      &ue,&uw,&un,&us,&une,&unw,&use,&usw);
+            // w[dj+1][di+1] is the derivative with respect to au[j+dj][i+di]
+            for (dj = 0; dj < 3; dj++)
+                for (di = 0; di < 3; di++)
+                    w[dj][di] = 0.0;
+            // east face  (i+1/2,j):  - hyhx De (ue - u)
+            dux = (ue - au[j][i]) / hx;
+            duy = (un + une - us - use) / (4.0 * hy);
+            a = - hyhx * 2.0 * dDD(dux * dux + duy * duy, mctx->q) * (ue - au[j][i]);
+            b = - hyhx * DD(dux * dux + duy * duy, mctx->q);
+            c = a * dux / hx + b;
+            w[1][2] += c;  w[1][1] -= c;
+            c = a * duy / (4.0 * hy);
+            w[2][1] += c;  w[2][2] += c;  w[0][1] -= c;  w[0][2] -= c;
+            // west face  (i-1/2,j):  + hyhx Dw (u - uw)
+            dux = (au[j][i] - uw) / hx;
+            duy = (unw + un - usw - us) / (4.0 * hy);
+            a = hyhx * 2.0 * dDD(dux * dux + duy * duy, mctx->q) * (au[j][i] - uw);
+            b = hyhx * DD(dux * dux + duy * duy, mctx->q);
+            c = a * dux / hx + b;
+            w[1][1] += c;  w[1][0] -= c;
+            c = a * duy / (4.0 * hy);
+            w[2][0] += c;  w[2][1] += c;  w[0][0] -= c;  w[0][1] -= c;
+            // north face  (i,j+1/2):  - hxhy Dn (un - u)
+            dux = (ue + une - uw - unw) / (4.0 * hx);
+            duy = (un - au[j][i]) / hy;
+            a = - hxhy * 2.0 * dDD(dux * dux + duy * duy, mctx->q) * (un - au[j][i]);
+            b = - hxhy * DD(dux * dux + duy * duy, mctx->q);
+            c = a * duy / hy + b;
+            w[2][1] += c;  w[1][1] -= c;
+            c = a * dux / (4.0 * hx);
+            w[1][2] += c;  w[2][2] += c;  w[1][0] -= c;  w[2][0] -= c;
+            // south face  (i,j-1/2):  + hxhy Ds (u - us)
+            dux = (ue + use - uw - usw) / (4.0 * hx);
+            duy = (au[j][i] - us) / hy;
+            a = hxhy * 2.0 * dDD(dux * dux + duy * duy, mctx->q) * (au[j][i] - us);
+            b = hxhy * DD(dux * dux + duy * duy, mctx->q);
+            c = a * duy / hy + b;
+            w[1][1] += c;  w[0][1] -= c;
+            c = a * dux / (4.0 * hx);
+            w[1][2] += c;  w[0][2] += c;  w[1][0] -= c;  w[0][0] -= c;
+            // columns for interior points only
+            ncols = 0;
+            for (dj = -1; dj <= 1; dj++) {
+                jj = j + dj;
+                if (jj == 0 || jj == info->my-1)
+                    continue;
+                for (di = -1; di <= 1; di++) {
+                    ii = i + di;
+                    if (ii == 0 || ii == info->mx-1)
+                        continue;
+                    col[ncols].j = jj;
+                    col[ncols].i = ii;
+                    v[ncols++] = w[dj+1][di+1];
                 }
-                if (i-1 == 0 || j-1 == 0) {
-                    usw = user->g_bdry(x-hx,y-hy,0.0,user);
+            }
+            ierr = StencilCSRSetValues(csr,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
+        }
+    }
+    ierr = StencilCSREnd(csr); CHKERRQ(ierr);
+    ierr = MatAssemblyBegin(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(Jpre,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    if (J != Jpre) {
+        ierr = MatAssemblyBegin(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+        ierr = MatAssemblyEnd(J,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+// the residual at an interior point as a function of the value u there,
+// with the neighbor values fixed, and its derivative with respect to u;
+// the formulas are those of FormFunctionLocal() and FormJacobianLocal()
+static PetscReal PointResidual(PetscReal u, PetscReal ue, PetscReal uw,
+                               PetscReal un, PetscReal us,
+                               PetscReal une, PetscReal unw,
+                               PetscReal use, PetscReal usw,
+                               PetscReal hx, PetscReal hy, PetscReal q,
+                               PetscReal *dFdu) {
+    const PetscReal hxhy = hx / hy, hyhx = hy / hx;
+    PetscReal dux, duy, W, D, F;
+    // east face  (i+1/2,j)
+    dux = (ue - u) / hx;
+    duy = (un + une - us - use) / (4.0 * hy);
+    W = dux * dux + duy * duy;
+    D = DD(W,q);
+    F = - hyhx * D * (ue - u);
+    *dFdu = hyhx * (2.0 * dDD(W,q) * (ue - u) * dux / hx + D);
+    // west face  (i-1/2,j)
+    dux = (u - uw) / hx;
+    duy = (unw + un - usw - us) / (4.0 * hy);
+    W = dux * dux + duy * duy;
+    D = DD(W,q);
+    F += hyhx * D * (u - uw);
+    *dFdu += hyhx * (2.0 * dDD(W,q) * (u - uw) * dux / hx + D);
+    // north face  (i,j+1/2)
+    dux = (ue + une - uw - unw) / (4.0 * hx);
+    duy = (un - u) / hy;
+    W = dux * dux + duy * duy;
+    D = DD(W,q);
+    F -= hxhy * D * (un - u);
+    *dFdu += hxhy * (2.0 * dDD(W,q) * (un - u) * duy / hy + D);
+    // south face  (i,j-1/2)
+    dux = (ue + use - uw - usw) / (4.0 * hx);
+    duy = (u - us) / hy;
+    W = dux * dux + duy * duy;
+    D = DD(W,q);
+    F += hxhy * D * (u - us);
+    *dFdu += hxhy * (2.0 * dDD(W,q) * (u - us) * duy / hy + D);
+    return F;
+}
+
+// do nonlinear Gauss-Seidel (processor-block) sweeps on
+//     F(u) = b
+// using pointwise Newton iterations; compare NonlinearGS() in solns/bratu2D.c
+PetscErrorCode NonlinearGS(SNES snes, Vec u, Vec b, void *ctx) {
+    PetscErrorCode ierr;
+    PetscInt       i, j, k, maxits, sweeps, l, totalits = 0;
+    PetscReal      atol, rtol, stol, xymin[2], xymax[2], hx, hy, x, y,
+                   **au, **ab, bij, uu, phi0, phi, dphidu, s,
+                   ue, uw, un, us, une, use, unw, usw;
+    DM             da;
+    DMDALocalInfo  info;
+    PoissonCtx     *user = (PoissonCtx*)(ctx);
+    MinimalCtx     *mctx = (MinimalCtx*)(user->addctx);
+    Vec            uloc;
+
+    ierr = SNESNGSGetSweeps(snes,&sweeps);CHKERRQ(ierr);
+    ierr = SNESNGSGetTolerances(snes,&atol,&rtol,&stol,&maxits);CHKERRQ(ierr);
+    ierr = SNESGetDM(snes,&da);CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    ierr = DMGetBoundingBox(da,xymin,xymax); CHKERRQ(ierr);
+    hx = (xymax[0] - xymin[0]) / (info.mx - 1);
+    hy = (xymax[1] - xymin[1]) / (info.my - 1);
+
+    ierr = DMGetLocalVector(da,&uloc);CHKERRQ(ierr);
+    if (b) {
+        ierr = DMDAVecGetArrayRead(da,b,&ab); CHKERRQ(ierr);
+    }
+    for (l=0; l<sweeps; l++) {
+        ierr = DMGlobalToLocalBegin(da,u,INSERT_VALUES,uloc);CHKERRQ(ierr);
+        ierr = DMGlobalToLocalEnd(da,u,INSERT_VALUES,uloc);CHKERRQ(ierr);
+        ierr = DMDAVecGetArray(da,uloc,&au);CHKERRQ(ierr);
+        for (j = info.ys; j < info.ys + info.ym; j++) {
+            y = j * hy;
+            for (i = info.xs; i < info.xs + info.xm; i++) {
+                x = i * hx;
+                if (j==0 || i==0 || i==info.mx-1 || j==info.my-1) {
+                    au[j][i] = user->g_bdry(x,y,0.0,user);
                 } else {
-                    usw = au[j-1][i-1];
+                    bij = (b) ? ab[j][i] : 0.0;
+                    // neighbors are fixed, including already-updated ones
+                    Neighbors(&info,au,i,j,x,y,hx,hy,user,
+                              &ue,&uw,&un,&us,&une,&unw,&use,&usw);
+                    // do pointwise Newton iterations on scalar function
+                    //   phi(u) = F_ij(u) - bij
+                    uu = au[j][i];
+                    phi0 = 0.0;
+                    for (k = 0; k < maxits; k++) {
+                        phi = PointResidual(uu,ue,uw,un,us,une,unw,use,usw,
+                                            hx,hy,mctx->q,&dphidu) - bij;
+                        if (k == 0)
+                             phi0 = phi;
+                        s = - phi / dphidu;     // Newton step
+                        uu += s;
+                        totalits++;
+                        if (   atol > PetscAbsReal(phi)
+                            || rtol*PetscAbsReal(phi0) > PetscAbsReal(phi)
+                            || stol*PetscAbsReal(uu) > PetscAbsReal(s)    ) {
+                            break;
+                        }
+                    }
+                    au[j][i] = uu;
                 }
-                // gradient  (dux,duy)   at east point  (i+1/2,j):
-                dux = (ue - au[j][i]) / hx;
-                duy = (un + une - us - use) / (4.0 * hy);
-                De = DD(dux * dux + duy * duy, mctx->q);
-                // ...                   at west point  (i-1/2,j):
-                dux = (au[j][i] - uw) / hx;
-                duy = (unw + un - usw - us) / (4.0 * hy);
-                Dw = DD(dux * dux + duy * duy, mctx->q);
-                // ...                  at north point  (i,j+1/2):
-                dux = (ue + une - uw - unw) / (4.0 * hx);
-                duy = (un - au[j][i]) / hy;
-                Dn = DD(dux * dux + duy * duy, mctx->q);
-                // ...                  at south point  (i,j-1/2):
-                dux = (ue + use - uw - usw) / (4.0 * hx);
-                duy = (au[j][i] - us) / hy;
-                Ds = DD(dux * dux + duy * duy, mctx->q);
-                // evaluate residual
-                FF[j][i] = - hyhx * (De * (ue - au[j][i]) - Dw * (au[j][i] - uw))
-                           - hxhy * (Dn * (un - au[j][i]) - Ds * (au[j][i] - us));
             }
         }
+        ierr = DMDAVecRestoreArray(da,uloc,&au);CHKERRQ(ierr);
+        ierr = DMLocalToGlobalBegin(da,uloc,INSERT_VALUES,u);CHKERRQ(ierr);
+        ierr = DMLocalToGlobalEnd(da,uloc,INSERT_VALUES,u);CHKERRQ(ierr);
+    }
+    if (b) {
+        ierr = DMDAVecRestoreArrayRead(da,b,&ab);CHKERRQ(ierr);
     }
+    ierr = DMRestoreLocalVector(da,&uloc);CHKERRQ(ierr);
+    // PointResidual() costs about 25 flops per face, plus the Newton step
+    ierr = PetscLogFlops(103.0 * totalits); CHKERRQ(ierr);
     return 0;
 }
 
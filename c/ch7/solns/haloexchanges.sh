@@ -0,0 +1,33 @@
+#!/bin/bash
+set -e
+
+# summary:   Compare NGS ghost exchanges, and time, for -lb_halo 1,2,3 in FAS
+# with NGS smoothing on 4 processes.  With -lb_halo h the fine levels
+# exchange once per h sweeps; coarse levels, where a process owns fewer
+# than h points in a direction, fall back to a shallower halo (see HaloDM()
+# in bratu2D.c), so the counts do not fall by exactly a factor of h.
+
+# use --with-debugging=0 build for timing; run as
+#   ./haloexchanges.sh &> haloexchanges.txt
+
+OPTIONS="-snes_converged_reason -lb_showcounts -da_refine 8 -snes_type fas -fas_levels_snes_type ngs -fas_coarse_snes_type ngs -fas_levels_snes_ngs_sweeps 3"
+
+for HALO in 1 2 3; do
+    CMD="mpiexec -n 4 ./bratu2D $OPTIONS -lb_halo $HALO"
+    echo $CMD
+    /usr/bin/time --portability -f "real %e"  $CMD
+done
+
+# expected NGS ghost exchanges (as counted by -lb_showcounts) per FAS V-cycle;
+# these are DERIVED from the code, not measured: on 4 processes the 513x513
+# grid has 9 levels, each smoothing level does one pre- and one post-smoothing
+# NGS call of 3 sweeps, and a level with a FAS right-hand side scatters it
+# once per cycle when the halo is deeper than 1; the 5x5 level, where a
+# process owns 2 points per direction, uses halo min(h,2), and the 3x3
+# coarse-level NGS uses halo 1 and is not included
+#
+#   level          -lb_halo 1   -lb_halo 2   -lb_halo 3
+#   513x513 (fine)      6            4            2
+#   9x9 ... 257x257     6            5            3       (each of 6 levels)
+#   5x5                 6            5            5
+#   total              48           39           25
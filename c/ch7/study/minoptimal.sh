@@ -2,7 +2,7 @@
 set -e
 
 # demonstrates optimality of minimal surface equation Newton-Krylov solver
-# with grid sequencing, -snes_fd_color, GMRES, and GMG preconditioning
+# with grid sequencing, the exact Jacobian, GMRES, and GMG preconditioning
 
 # main concern is issue iii), the smoothness of solutions, so we vary H in tent
 # and c in catenoid
@@ -14,7 +14,7 @@ set -e
 # results & figure-generation:  see p4pdes-book/figs/minoptimal.txt|py
 
 function runcase() {
-    CMD="../minimal -snes_fd_color -pc_type mg -snes_converged_reason -log_view -snes_grid_sequence $1 -mse_problem $2 $3"
+    CMD="../minimal -pc_type mg -snes_converged_reason -log_view -snes_grid_sequence $1 -mse_problem $2 $3"
     echo "COMMAND:  $CMD"
     rm -rf tmp.txt
     $CMD &> tmp.txt
@@ -0,0 +1,336 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+/*
+Checkpoint and restart for TS runs.  Call
+
+  ierr = TSCheckpointSetUp(ts,u,"ptn_"); CHKERRQ(ierr);
+
+after TSSetFromOptions() and after the initial state is put in u, just
+before TSSolve().  It reads these options, with the given prefix:
+  -ptn_checkpoint ROOT       write checkpoints to ROOT.A.rank, ROOT.B.rank
+                             and ROOT.index
+  -ptn_checkpoint_every N    write every N steps (default 10)
+  -ptn_restart ROOT          read u, time, step number and step size from
+                             the checkpoint named by ROOT.index
+A checkpoint is the owned part of u on each process, in a native-format
+file per process, with a header holding the step number, the time, and
+the step size the TS (adaptor) chose for the next step.  Thus a restart
+needs the same number of processes and the same grid.  (Internal history,
+e.g. of TSBDF orders, is not saved, so the first steps after a restart may
+differ from the uninterrupted run.)
+
+When PETSc is configured with pthreads the writing is asynchronous:  the
+monitor copies u into a buffer and a thread writes it, so time stepping
+continues during the write.  The next checkpoint, or TSDestroy(), waits
+for the previous write.  Checkpoints alternate between two generations of
+files, A and B.  Only when every process has finished writing a generation
+(checked by an MPI_Allreduce() at that wait) does rank 0 write ROOT.index,
+naming the generation and its step.  The index is written under a
+temporary name and renamed, and the next checkpoint goes to the other
+generation, so a run which dies at any time leaves an index naming a
+complete checkpoint.  Restart reads that one, and checks that every process
+read the indexed step.
+*/
+
+#include <stdio.h>
+#if defined(PETSC_HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
+#define CHECKPOINT_MAGIC 0x54504b4344503450  // "P4PDCKPT"
+
+typedef struct {
+    PetscInt64   magic,
+                 nranks,     // number of processes which wrote
+                 n,          // length of owned part of u
+                 step;
+    PetscReal    time,
+                 dt;         // step size for the next step
+} CheckpointHeader;
+
+typedef struct {
+    PetscInt64   magic,
+                 nranks,
+                 step,
+                 gen;        // 0 for ROOT.A.*, 1 for ROOT.B.*
+} CheckpointIndex;
+
+typedef struct {
+    MPI_Comm         comm;
+    PetscMPIInt      rank;
+    char             root[PETSC_MAX_PATH_LEN],
+                     file[2][PETSC_MAX_PATH_LEN],    // ROOT.A.rank, ROOT.B.rank
+                     tmpfile[PETSC_MAX_PATH_LEN];    // ROOT.X.rank.tmp
+    PetscInt         every,
+                     first,  // step number at start; not written
+                     gen;    // generation being written, or last written
+    PetscBool        pending;  // generation gen is written but not indexed
+    CheckpointHeader hdr;
+    PetscScalar      *buf;   // copy of owned part of u, for the writer
+    int              status; // of the last write; nonzero is failure
+#if defined(PETSC_HAVE_PTHREAD)
+    pthread_t        thread;
+    PetscBool        busy;   // a write is in progress
+#endif
+} TSCheckpoint;
+
+static const char CheckpointGenName[2] = {'A', 'B'};
+
+// runs on the writer thread, so it calls no PETSc functions
+static void* TSCheckpointWrite(void *ctx) {
+    TSCheckpoint *ck = (TSCheckpoint*)ctx;
+    FILE         *fp;
+    size_t       n = (size_t)ck->hdr.n;
+
+    ck->status = 1;
+    fp = fopen(ck->tmpfile,"wb");
+    if (!fp)
+        return NULL;
+    if (fwrite(&(ck->hdr),sizeof(CheckpointHeader),1,fp) == 1
+            && fwrite(ck->buf,sizeof(PetscScalar),n,fp) == n)
+        ck->status = 0;
+    if (fclose(fp) != 0)
+        ck->status = 1;
+    if (ck->status == 0 && rename(ck->tmpfile,ck->file[ck->gen]) != 0)
+        ck->status = 1;
+    return NULL;
+}
+
+// on rank 0, write ROOT.index naming generation ck->gen
+static int TSCheckpointWriteIndex(TSCheckpoint *ck) {
+    CheckpointIndex idx;
+    char            file[PETSC_MAX_PATH_LEN+6], tmpfile[PETSC_MAX_PATH_LEN+10];
+    FILE            *fp;
+    int             status = 1;
+
+    idx.magic = CHECKPOINT_MAGIC;
+    idx.nranks = ck->hdr.nranks;
+    idx.step = ck->hdr.step;
+    idx.gen = ck->gen;
+    snprintf(file,sizeof(file),"%s.index",ck->root);
+    snprintf(tmpfile,sizeof(tmpfile),"%s.index.tmp",ck->root);
+    fp = fopen(tmpfile,"wb");
+    if (!fp)
+        return 1;
+    if (fwrite(&idx,sizeof(CheckpointIndex),1,fp) == 1)
+        status = 0;
+    if (fclose(fp) != 0)
+        status = 1;
+    if (status == 0 && rename(tmpfile,file) != 0)
+        status = 1;
+    return status;
+}
+
+// collective: wait for the write of generation ck->gen on every process,
+// then index it
+PETSC_STATIC_INLINE PetscErrorCode TSCheckpointWait(TSCheckpoint *ck) {
+    PetscErrorCode ierr;
+    int            gstatus, istatus = 0;
+
+#if defined(PETSC_HAVE_PTHREAD)
+    if (ck->busy) {
+        if (pthread_join(ck->thread,NULL)) {
+            SETERRQ(PETSC_COMM_SELF,PETSC_ERR_SYS,"pthread_join() failed\n");
+        }
+        ck->busy = PETSC_FALSE;
+    }
+#endif
+    if (!ck->pending)
+        return 0;
+    ck->pending = PETSC_FALSE;
+    ierr = MPI_Allreduce(&(ck->status),&gstatus,1,MPI_INT,MPI_MAX,ck->comm); CHKERRQ(ierr);
+    if (gstatus) {
+        SETERRQ2(ck->comm,PETSC_ERR_FILE_WRITE,
+                 "could not write checkpoint files %s.%c.*\n",
+                 ck->root,CheckpointGenName[ck->gen]);
+    }
+    if (ck->rank == 0)
+        istatus = TSCheckpointWriteIndex(ck);
+    ierr = MPI_Bcast(&istatus,1,MPI_INT,0,ck->comm); CHKERRQ(ierr);
+    if (istatus) {
+        SETERRQ1(ck->comm,PETSC_ERR_FILE_WRITE,
+                 "could not write checkpoint index %s.index\n",ck->root);
+    }
+    return 0;
+}
+
+PETSC_STATIC_INLINE PetscErrorCode TSCheckpointMonitor(TS ts, PetscInt step,
+                                   PetscReal t, Vec u, void *ctx) {
+    PetscErrorCode    ierr;
+    TSCheckpoint      *ck = (TSCheckpoint*)ctx;
+    const PetscScalar *au;
+
+    if (step == ck->first || step % ck->every != 0)
+        return 0;
+    ierr = TSCheckpointWait(ck); CHKERRQ(ierr);
+    ck->gen = 1 - ck->gen;  // never overwrite the indexed generation
+    ierr = PetscSNPrintf(ck->tmpfile,sizeof(ck->tmpfile),"%s.tmp",
+                         ck->file[ck->gen]); CHKERRQ(ierr);
+    ierr = VecGetArrayRead(u,&au); CHKERRQ(ierr);
+    ierr = PetscArraycpy(ck->buf,au,ck->hdr.n); CHKERRQ(ierr);
+    ierr = VecRestoreArrayRead(u,&au); CHKERRQ(ierr);
+    ck->hdr.step = step;
+    ck->hdr.time = t;
+    ierr = TSGetTimeStep(ts,&(ck->hdr.dt)); CHKERRQ(ierr);
+    ck->pending = PETSC_TRUE;
+#if defined(PETSC_HAVE_PTHREAD)
+    if (pthread_create(&(ck->thread),NULL,TSCheckpointWrite,ck)) {
+        SETERRQ(PETSC_COMM_SELF,PETSC_ERR_SYS,"pthread_create() failed\n");
+    }
+    ck->busy = PETSC_TRUE;
+#else
+    TSCheckpointWrite(ck);
+    ierr = TSCheckpointWait(ck); CHKERRQ(ierr);
+#endif
+    return 0;
+}
+
+PETSC_STATIC_INLINE PetscErrorCode TSCheckpointDestroy(void **ctx) {
+    PetscErrorCode ierr;
+    TSCheckpoint   *ck = *(TSCheckpoint**)ctx;
+    ierr = TSCheckpointWait(ck); CHKERRQ(ierr);
+    ierr = PetscFree(ck->buf); CHKERRQ(ierr);
+    ierr = PetscFree(ck); CHKERRQ(ierr);
+    return 0;
+}
+
+// collective: rank 0 reads ROOT.index; *err is nonzero if there is no
+// valid index for this number of processes
+PETSC_STATIC_INLINE PetscErrorCode TSCheckpointReadIndex(MPI_Comm comm,
+                                   const char *root, CheckpointIndex *idx, int *err) {
+    PetscErrorCode ierr;
+    PetscMPIInt    rank, size;
+    char           file[PETSC_MAX_PATH_LEN];
+    FILE           *fp;
+
+    ierr = MPI_Comm_rank(comm,&rank); CHKERRQ(ierr);
+    ierr = MPI_Comm_size(comm,&size); CHKERRQ(ierr);
+    *err = 0;
+    if (rank == 0) {
+        ierr = PetscSNPrintf(file,sizeof(file),"%s.index",root); CHKERRQ(ierr);
+        fp = fopen(file,"rb");
+        if (!fp
+            || fread(idx,sizeof(CheckpointIndex),1,fp) != 1
+            || idx->magic != CHECKPOINT_MAGIC || idx->nranks != size
+            || idx->gen < 0 || idx->gen > 1)
+            *err = 1;
+        if (fp)
+            fclose(fp);
+    }
+    ierr = MPI_Bcast(err,1,MPI_INT,0,comm); CHKERRQ(ierr);
+    if (*err == 0) {
+        ierr = MPI_Bcast(idx,(PetscMPIInt)sizeof(CheckpointIndex),MPI_BYTE,0,comm); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PETSC_STATIC_INLINE PetscErrorCode TSCheckpointRead(TS ts, Vec u,
+                                                    const char *root) {
+    PetscErrorCode   ierr;
+    MPI_Comm         comm;
+    PetscMPIInt      rank, size;
+    char             file[PETSC_MAX_PATH_LEN];
+    FILE             *fp;
+    CheckpointIndex  idx;
+    CheckpointHeader hdr;
+    PetscScalar      *au;
+    PetscInt         n;
+    int              lerr = 0, gerr;
+
+    ierr = PetscObjectGetComm((PetscObject)u,&comm); CHKERRQ(ierr);
+    ierr = MPI_Comm_rank(comm,&rank); CHKERRQ(ierr);
+    ierr = MPI_Comm_size(comm,&size); CHKERRQ(ierr);
+    ierr = TSCheckpointReadIndex(comm,root,&idx,&lerr); CHKERRQ(ierr);
+    if (lerr) {
+        SETERRQ1(comm,PETSC_ERR_FILE_READ,
+                 "could not read checkpoint index %s.index for this number of processes\n",
+                 root);
+    }
+
+    ierr = VecGetLocalSize(u,&n); CHKERRQ(ierr);
+    ierr = PetscSNPrintf(file,sizeof(file),"%s.%c.%d",
+                         root,CheckpointGenName[idx.gen],rank); CHKERRQ(ierr);
+    ierr = VecGetArray(u,&au); CHKERRQ(ierr);
+    fp = fopen(file,"rb");
+    if (!fp
+        || fread(&hdr,sizeof(CheckpointHeader),1,fp) != 1
+        || hdr.magic != CHECKPOINT_MAGIC || hdr.nranks != size || hdr.n != n
+        || hdr.step != idx.step
+        || fread(au,sizeof(PetscScalar),(size_t)n,fp) != (size_t)n)
+        lerr = 1;
+    if (fp)
+        fclose(fp);
+    ierr = VecRestoreArray(u,&au); CHKERRQ(ierr);
+    ierr = MPI_Allreduce(&lerr,&gerr,1,MPI_INT,MPI_MAX,comm); CHKERRQ(ierr);
+    if (gerr) {
+        SETERRQ3(comm,PETSC_ERR_FILE_READ,
+                 "could not read step %d checkpoint %s.%c.* for this grid and number of processes\n",
+                 (int)idx.step,root,CheckpointGenName[idx.gen]);
+    }
+    ierr = TSSetTime(ts,hdr.time); CHKERRQ(ierr);
+    ierr = TSSetTimeStep(ts,hdr.dt); CHKERRQ(ierr);
+    ierr = TSSetStepNumber(ts,(PetscInt)hdr.step); CHKERRQ(ierr);
+    ierr = PetscPrintf(comm,"restarting from %s.%c.* at step %d, time %g, dt %g\n",
+                       root,CheckpointGenName[idx.gen],(int)hdr.step,
+                       (double)hdr.time,(double)hdr.dt); CHKERRQ(ierr);
+    return 0;
+}
+
+PETSC_STATIC_INLINE PetscErrorCode TSCheckpointSetUp(TS ts, Vec u,
+                                                     const char *prefix) {
+    PetscErrorCode   ierr;
+    MPI_Comm         comm;
+    PetscMPIInt      rank, size;
+    char             ckroot[PETSC_MAX_PATH_LEN] = "",
+                     restartroot[PETSC_MAX_PATH_LEN] = "";
+    PetscInt         every = 10, n, g;
+    CheckpointIndex  idx;
+    int              noindex;
+    PetscBool        ckset = PETSC_FALSE, restartset = PETSC_FALSE;
+    TSCheckpoint     *ck;
+
+    ierr = PetscObjectGetComm((PetscObject)u,&comm); CHKERRQ(ierr);
+    ierr = PetscOptionsBegin(comm,prefix,"checkpoint and restart options",""); CHKERRQ(ierr);
+    ierr = PetscOptionsString("-checkpoint","filename root for checkpoint files",
+           "checkpoint.h",ckroot,ckroot,PETSC_MAX_PATH_LEN,&ckset);CHKERRQ(ierr);
+    ierr = PetscOptionsInt("-checkpoint_every","number of steps between checkpoints",
+           "checkpoint.h",every,&every,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsString("-restart","filename root of checkpoint files to restart from",
+           "checkpoint.h",restartroot,restartroot,PETSC_MAX_PATH_LEN,&restartset);CHKERRQ(ierr);
+    ierr = PetscOptionsEnd(); CHKERRQ(ierr);
+    if (every < 1) {
+        SETERRQ(comm,PETSC_ERR_ARG_OUTOFRANGE,"checkpoint_every must be positive\n");
+    }
+
+    if (restartset) {
+        ierr = TSCheckpointRead(ts,u,restartroot); CHKERRQ(ierr);
+    }
+    if (ckset) {
+        ierr = MPI_Comm_rank(comm,&rank); CHKERRQ(ierr);
+        ierr = MPI_Comm_size(comm,&size); CHKERRQ(ierr);
+        ierr = PetscNew(&ck); CHKERRQ(ierr);
+        ck->comm = comm;
+        ck->rank = rank;
+        ierr = PetscStrncpy(ck->root,ckroot,sizeof(ck->root)); CHKERRQ(ierr);
+        for (g = 0; g < 2; g++) {
+            ierr = PetscSNPrintf(ck->file[g],sizeof(ck->file[g]),"%s.%c.%d",
+                                 ckroot,CheckpointGenName[g],rank); CHKERRQ(ierr);
+        }
+        // the first checkpoint goes to the generation not named by an
+        // existing ROOT.index, e.g. the one being restarted from
+        ierr = TSCheckpointReadIndex(comm,ckroot,&idx,&noindex); CHKERRQ(ierr);
+        ck->gen = noindex ? 1 : (PetscInt)idx.gen;
+        ck->every = every;
+        ierr = TSGetStepNumber(ts,&(ck->first)); CHKERRQ(ierr);
+        ck->hdr.magic = CHECKPOINT_MAGIC;
+        ck->hdr.nranks = size;
+        ierr = VecGetLocalSize(u,&n); CHKERRQ(ierr);
+        ck->hdr.n = n;
+        ierr = PetscMalloc1(ck->hdr.n,&(ck->buf)); CHKERRQ(ierr);
+        ierr = TSMonitorSet(ts,TSCheckpointMonitor,ck,TSCheckpointDestroy); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,327 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+/*
+Time-series output ("snapshots") of the state of a TS on a 1D or 2D DMDA,
+written in the background.  Call
+
+  ierr = TSSnapshotSetUp(ts,u,"ptn_"); CHKERRQ(ierr);
+
+before TSSolve(), and after TSCheckpointSetUp() if there is one.  It reads
+these options, with the given prefix:
+  -ptn_snapshot ROOT          write frames to ROOT.0, ROOT.1, ...
+  -ptn_snapshot_every N       write every N steps, including step 0 (default 1)
+  -ptn_snapshot_float         store values in single precision
+  -ptn_snapshot_buffers K     number of staging buffers (default 4)
+Each process appends frames of its owned part of the grid to its own
+native-format file.  The file starts with a header of ten 64-bit integers
+  magic, mx, my, dof, xs, ys, xm, ym, bytes per value, number of processes
+and each frame is a 64-bit step number, a double time, and xm*ym*dof
+values.  The reader snapshots.py reassembles frames in natural ordering;
+"plotTS.py -snapshot ROOT" uses it.
+
+On a restart (the TS step number is positive at set-up, e.g. after
+-ptn_restart) the existing files are appended to, not truncated.  Frames
+at or after the restart step, written by the interrupted run after its
+checkpoint, are first cut off, as is a partly-written last frame, so the
+files hold one frame per snapshot step.  The grid, the process count and
+-ptn_snapshot_float must match those of the run which wrote the files.
+
+The TS monitor only copies (or converts to float) the state into a free
+staging buffer and queues it; when PETSc has pthreads, a writer thread
+does all file I/O.  The monitor waits only if all K buffers are queued,
+i.e. if the file system falls K frames behind; the number of such waits is
+reported at the end.  Without pthreads frames are written by the monitor.
+*/
+
+#include <stdio.h>
+#if defined(PETSC_HAVE_UNISTD_H)
+#include <unistd.h>    // for ftruncate()
+#endif
+#if defined(PETSC_HAVE_PTHREAD)
+#include <pthread.h>
+#endif
+
+#define SNAPSHOT_MAGIC 0x54414e5344503450  // "P4PDSNAT"
+#define SNAPSHOT_MAXBUFFERS 64
+
+typedef struct {
+    FILE             *fp;          // used only by the writer
+    PetscInt         every,
+                     nbuf,         // number of staging buffers
+                     head,         // next buffer to write
+                     count,        // number of queued buffers
+                     frames,       // number of frames queued so far
+                     waits;        // times the monitor found no free buffer
+    size_t           n,            // values per frame
+                     bytes;        // bytes per value: 4 or 8
+    void             *buf[SNAPSHOT_MAXBUFFERS];
+    PetscInt64       step[SNAPSHOT_MAXBUFFERS];
+    double           time[SNAPSHOT_MAXBUFFERS];
+    int              status;       // nonzero if a write failed; read and
+                                   //   written under lock with pthreads
+#if defined(PETSC_HAVE_PTHREAD)
+    pthread_t        thread;
+    pthread_mutex_t  lock;
+    pthread_cond_t   queued,       // signalled when a buffer is queued
+                     freed;        // signalled when a buffer is written
+    PetscBool        done;         // no more frames
+#endif
+} TSSnapshot;
+
+// write buffer k; returns nonzero on failure; calls no PETSc functions
+static int TSSnapshotWriteFrame(TSSnapshot *sn, PetscInt k) {
+    if (fwrite(&(sn->step[k]),sizeof(PetscInt64),1,sn->fp) != 1
+            || fwrite(&(sn->time[k]),sizeof(double),1,sn->fp) != 1
+            || fwrite(sn->buf[k],sn->bytes,sn->n,sn->fp) != sn->n)
+        return 1;
+    return 0;
+}
+
+#if defined(PETSC_HAVE_PTHREAD)
+static void* TSSnapshotWriter(void *ctx) {
+    TSSnapshot *sn = (TSSnapshot*)ctx;
+    PetscInt   k;
+    int        fail;
+
+    pthread_mutex_lock(&(sn->lock));
+    while (1) {
+        while (sn->count == 0 && !sn->done)
+            pthread_cond_wait(&(sn->queued),&(sn->lock));
+        if (sn->count == 0)
+            break;
+        k = sn->head;
+        pthread_mutex_unlock(&(sn->lock));
+        fail = TSSnapshotWriteFrame(sn,k);   // buffer k is not touched by the monitor
+        pthread_mutex_lock(&(sn->lock));
+        if (fail)
+            sn->status = 1;
+        sn->head = (sn->head + 1) % sn->nbuf;
+        sn->count--;
+        pthread_cond_signal(&(sn->freed));
+    }
+    pthread_mutex_unlock(&(sn->lock));
+    return NULL;
+}
+#endif
+
+PETSC_STATIC_INLINE PetscErrorCode TSSnapshotMonitor(TS ts, PetscInt step,
+                                   PetscReal t, Vec u, void *ctx) {
+    PetscErrorCode    ierr;
+    TSSnapshot        *sn = (TSSnapshot*)ctx;
+    const PetscScalar *au;
+    PetscInt          k;
+    size_t            l;
+    int               status;
+
+    if (step % sn->every != 0)
+        return 0;
+#if defined(PETSC_HAVE_PTHREAD)
+    pthread_mutex_lock(&(sn->lock));
+    if (sn->count == sn->nbuf) {
+        sn->waits++;
+        while (sn->count == sn->nbuf)
+            pthread_cond_wait(&(sn->freed),&(sn->lock));
+    }
+    k = (sn->head + sn->count) % sn->nbuf;   // free, so not used by the writer
+    pthread_mutex_unlock(&(sn->lock));
+#else
+    k = 0;
+#endif
+    ierr = VecGetArrayRead(u,&au); CHKERRQ(ierr);
+    if (sn->bytes == sizeof(float)) {
+        float *b = (float*)(sn->buf[k]);
+        PetscPragmaSIMD
+        for (l = 0; l < sn->n; l++)
+            b[l] = (float)PetscRealPart(au[l]);
+    } else {
+        ierr = PetscArraycpy((PetscScalar*)(sn->buf[k]),au,sn->n); CHKERRQ(ierr);
+    }
+    ierr = VecRestoreArrayRead(u,&au); CHKERRQ(ierr);
+    sn->step[k] = step;
+    sn->time[k] = (double)t;
+    sn->frames++;
+#if defined(PETSC_HAVE_PTHREAD)
+    pthread_mutex_lock(&(sn->lock));
+    sn->count++;
+    pthread_cond_signal(&(sn->queued));
+    status = sn->status;   // of earlier frames
+    pthread_mutex_unlock(&(sn->lock));
+#else
+    if (TSSnapshotWriteFrame(sn,k))
+        sn->status = 1;
+    status = sn->status;
+#endif
+    if (status) {
+        SETERRQ(PETSC_COMM_SELF,PETSC_ERR_FILE_WRITE,"could not write snapshot frame\n");
+    }
+    return 0;
+}
+
+// on a restart at step first, open an existing file for appending after
+// its last complete frame before step first, and cut off the rest; *fp is
+// NULL if there is no file; returns nonzero if the file does not have
+// header hdr, or on failure
+static int TSSnapshotAppend(const char *file, const PetscInt64 *hdr,
+                            size_t framebytes, PetscInt64 first, FILE **fp) {
+    PetscInt64 old[10], step;
+    long       size, off = 10 * sizeof(PetscInt64);
+    int        k;
+
+    *fp = fopen(file,"r+b");
+    if (!*fp)
+        return 0;
+    if (fread(old,sizeof(PetscInt64),10,*fp) != 10)
+        return 1;
+    for (k = 0; k < 10; k++) {
+        if (old[k] != hdr[k])
+            return 1;
+    }
+    if (fseek(*fp,0,SEEK_END) != 0 || (size = ftell(*fp)) < 0)
+        return 1;
+    while (off + (long)framebytes <= size) {
+        if (fseek(*fp,off,SEEK_SET) != 0
+                || fread(&step,sizeof(PetscInt64),1,*fp) != 1)
+            return 1;
+        if (step >= first)
+            break;
+        off += (long)framebytes;
+    }
+    if (off < size) {
+#if defined(PETSC_HAVE_UNISTD_H)
+        if (fflush(*fp) != 0 || ftruncate(fileno(*fp),(off_t)off) != 0)
+            return 1;
+#else
+        return 1;
+#endif
+    }
+    return (fseek(*fp,off,SEEK_SET) != 0);
+}
+
+PETSC_STATIC_INLINE PetscErrorCode TSSnapshotDestroy(void **ctx) {
+    PetscErrorCode ierr;
+    TSSnapshot     *sn = *(TSSnapshot**)ctx;
+    PetscInt       k;
+    int            status;
+
+#if defined(PETSC_HAVE_PTHREAD)
+    pthread_mutex_lock(&(sn->lock));
+    sn->done = PETSC_TRUE;
+    pthread_cond_signal(&(sn->queued));
+    pthread_mutex_unlock(&(sn->lock));
+    pthread_join(sn->thread,NULL);
+    pthread_mutex_destroy(&(sn->lock));
+    pthread_cond_destroy(&(sn->queued));
+    pthread_cond_destroy(&(sn->freed));
+#endif
+    if (fclose(sn->fp) != 0)
+        sn->status = 1;
+    ierr = PetscPrintf(PETSC_COMM_WORLD,
+               "snapshots: %d frames written; monitor waited for a buffer %d times\n",
+               (int)sn->frames,(int)sn->waits); CHKERRQ(ierr);
+    status = sn->status;
+    for (k = 0; k < sn->nbuf; k++) {
+        ierr = PetscFree(sn->buf[k]); CHKERRQ(ierr);
+    }
+    ierr = PetscFree(sn); CHKERRQ(ierr);
+    if (status) {
+        SETERRQ(PETSC_COMM_SELF,PETSC_ERR_FILE_WRITE,"could not write snapshot frames\n");
+    }
+    return 0;
+}
+
+PETSC_STATIC_INLINE PetscErrorCode TSSnapshotSetUp(TS ts, Vec u,
+                                                   const char *prefix) {
+    PetscErrorCode ierr;
+    MPI_Comm       comm;
+    PetscMPIInt    rank, size;
+    DM             da;
+    DMDALocalInfo  info;
+    char           root[PETSC_MAX_PATH_LEN] = "",
+                   file[PETSC_MAX_PATH_LEN];
+    PetscInt       every = 1, nbuf = 4, k, first;
+    PetscInt64     hdr[10];
+    PetscBool      set = PETSC_FALSE, single = PETSC_FALSE;
+    TSSnapshot     *sn;
+
+    ierr = PetscObjectGetComm((PetscObject)u,&comm); CHKERRQ(ierr);
+    ierr = PetscOptionsBegin(comm,prefix,"snapshot options",""); CHKERRQ(ierr);
+    ierr = PetscOptionsString("-snapshot","filename root for snapshot files",
+           "snapshot.h",root,root,PETSC_MAX_PATH_LEN,&set);CHKERRQ(ierr);
+    ierr = PetscOptionsInt("-snapshot_buffers","number of staging buffers",
+           "snapshot.h",nbuf,&nbuf,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsInt("-snapshot_every","number of steps between frames",
+           "snapshot.h",every,&every,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsBool("-snapshot_float","write frames in single precision",
+           "snapshot.h",single,&single,NULL);CHKERRQ(ierr);
+    ierr = PetscOptionsEnd(); CHKERRQ(ierr);
+    if (!set)
+        return 0;
+    if (every < 1) {
+        SETERRQ(comm,PETSC_ERR_ARG_OUTOFRANGE,"snapshot_every must be positive\n");
+    }
+    if (nbuf < 1 || nbuf > SNAPSHOT_MAXBUFFERS) {
+        SETERRQ1(comm,PETSC_ERR_ARG_OUTOFRANGE,
+                 "snapshot_buffers must be in 1,...,%d\n",SNAPSHOT_MAXBUFFERS);
+    }
+
+    ierr = TSGetDM(ts,&da); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da,&info); CHKERRQ(ierr);
+    if (info.dim > 2) {
+        SETERRQ(comm,PETSC_ERR_SUP,"snapshots are for 1D and 2D DMDAs\n");
+    }
+    ierr = MPI_Comm_rank(comm,&rank); CHKERRQ(ierr);
+    ierr = MPI_Comm_size(comm,&size); CHKERRQ(ierr);
+    ierr = PetscNew(&sn); CHKERRQ(ierr);
+    sn->every = every;
+    sn->bytes = single ? sizeof(float) : sizeof(PetscScalar);
+    sn->n = (size_t)(info.xm * info.ym * info.dof);
+#if defined(PETSC_HAVE_PTHREAD)
+    sn->nbuf = nbuf;
+#else
+    sn->nbuf = 1;
+#endif
+    for (k = 0; k < sn->nbuf; k++) {
+        ierr = PetscMalloc(sn->n * sn->bytes,&(sn->buf[k])); CHKERRQ(ierr);
+    }
+    hdr[0] = SNAPSHOT_MAGIC;
+    hdr[1] = info.mx;   hdr[2] = (info.dim > 1) ? info.my : 1;
+    hdr[3] = info.dof;
+    hdr[4] = info.xs;   hdr[5] = (info.dim > 1) ? info.ys : 0;
+    hdr[6] = info.xm;   hdr[7] = (info.dim > 1) ? info.ym : 1;
+    hdr[8] = (PetscInt64)sn->bytes;
+    hdr[9] = size;
+    ierr = PetscSNPrintf(file,sizeof(file),"%s.%d",root,rank); CHKERRQ(ierr);
+    ierr = TSGetStepNumber(ts,&first); CHKERRQ(ierr);
+    sn->fp = NULL;
+    if (first > 0) {
+        if (TSSnapshotAppend(file,hdr,sizeof(PetscInt64) + sizeof(double) + sn->n * sn->bytes,
+                             first,&(sn->fp))) {
+            if (sn->fp)
+                fclose(sn->fp);
+            SETERRQ1(PETSC_COMM_SELF,PETSC_ERR_FILE_UNEXPECTED,
+                     "could not append to %s; was it written by this grid, process count and precision?\n",file);
+        }
+    }
+    if (!sn->fp) {
+        sn->fp = fopen(file,"wb");
+        if (!sn->fp) {
+            SETERRQ1(PETSC_COMM_SELF,PETSC_ERR_FILE_OPEN,"could not open %s\n",file);
+        }
+        if (fwrite(hdr,sizeof(PetscInt64),10,sn->fp) != 10) {
+            SETERRQ1(PETSC_COMM_SELF,PETSC_ERR_FILE_WRITE,"could not write %s\n",file);
+        }
+    }
+#if defined(PETSC_HAVE_PTHREAD)
+    pthread_mutex_init(&(sn->lock),NULL);
+    pthread_cond_init(&(sn->queued),NULL);
+    pthread_cond_init(&(sn->freed),NULL);
+    if (pthread_create(&(sn->thread),NULL,TSSnapshotWriter,sn)) {
+        SETERRQ(PETSC_COMM_SELF,PETSC_ERR_SYS,"pthread_create() failed\n");
+    }
+#endif
+    ierr = TSMonitorSet(ts,TSSnapshotMonitor,sn,TSSnapshotDestroy); CHKERRQ(ierr);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef STENCILCSR_H_
+#define STENCILCSR_H_
+
+/*
+These functions replace MatSetValuesStencil() in Jacobian routines for
+single-d.o.f. DMDAs.  Each call to MatSetValuesStencil() converts the
+stencil indices to global indices and then searches the row for each
+column.  Here that work is done once per matrix:  for each owned row, and
+for each of the 3^dim stencil positions (offsets -1,0,1 in each direction)
+the position of the entry in the AIJ value array is precomputed.  Then
+StencilCSRSetValues() writes the values straight into the arrays of the
+(diagonal and off-diagonal blocks of the) matrix.  Usage is
+
+  StencilCSR *csr;
+  ierr = StencilCSRBegin(info->da,P,&csr); CHKERRQ(ierr);
+  for (...) {
+      ...
+      ierr = StencilCSRSetValues(csr,&row,ncols,col,v,INSERT_VALUES); CHKERRQ(ierr);
+  }
+  ierr = StencilCSREnd(csr); CHKERRQ(ierr);
+  ierr = MatAssemblyBegin(P,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+  ierr = MatAssemblyEnd(P,MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+
+The matrix must already have its nonzero pattern, as it does when it
+comes from DMCreateMatrix() (which inserts zeros for the whole stencil).
+Only owned rows may be set.  The table is composed with the Mat and is
+rebuilt if the nonzero pattern changes.  If the matrix is not MATSEQAIJ
+or MATMPIAIJ, or is not yet assembled, or the DMDA has dof > 1, then
+StencilCSRSetValues() just calls MatSetValuesStencil().
+*/
+
+typedef struct {
+    Mat              A;          // not referenced
+    DM               da;         // not referenced
+    PetscObjectState nzstate;    // nonzero state of A when off[] was built
+    PetscInt         dim,        // number of directions in MatStencil
+                     ns,         // 3^dim stencil positions per row
+                     xs, ys, zs, xm, ym, zm;  // owned range
+    PetscInt         *off;       // length xm*ym*zm*ns; for a row and position:
+                                 //   off >= 0:  index into ad
+                                 //   off <= -2: index -2-off into ao
+                                 //   off = -1:  not in nonzero pattern
+    Mat              Ad, Ao;     // diagonal and off-diagonal SeqAIJ blocks
+    PetscScalar      *ad, *ao;   // their value arrays; ad = NULL means
+                                 //   use MatSetValuesStencil()
+} StencilCSR;
+
+PETSC_STATIC_INLINE PetscErrorCode StencilCSRDestroy(void *ctx) {
+    PetscErrorCode ierr;
+    StencilCSR     *csr = (StencilCSR*)ctx;
+    ierr = PetscFree(csr->off); CHKERRQ(ierr);
+    ierr = PetscFree(csr); CHKERRQ(ierr);
+    return 0;
+}
+
+// find global column g in local row r of the blocks; *off = -1 if absent
+PETSC_STATIC_INLINE PetscErrorCode StencilCSRFind(PetscInt g, PetscInt r,
+        PetscInt cstart, PetscInt cend,
+        const PetscInt *iad, const PetscInt *jad,
+        const PetscInt *iao, const PetscInt *jao,
+        const PetscInt *garray, PetscInt ngarray, PetscInt *off) {
+    PetscErrorCode ierr;
+    PetscInt       loc, gi;
+    *off = -1;
+    if (g < 0)
+        return 0;
+    if (g >= cstart && g < cend) {
+        ierr = PetscFindInt(g - cstart,iad[r+1] - iad[r],jad + iad[r],&loc); CHKERRQ(ierr);
+        if (loc >= 0)
+            *off = iad[r] + loc;
+        return 0;
+    }
+    if (!iao)
+        return 0;
+    ierr = PetscFindInt(g,ngarray,garray,&gi); CHKERRQ(ierr);
+    if (gi < 0)
+        return 0;
+    ierr = PetscFindInt(gi,iao[r+1] - iao[r],jao + iao[r],&loc); CHKERRQ(ierr);
+    if (loc >= 0)
+        *off = -2 - (iao[r] + loc);
+    return 0;
+}
+
+PETSC_STATIC_INLINE PetscErrorCode StencilCSRBuild(StencilCSR *csr) {
+    PetscErrorCode ierr;
+    DMDALocalInfo  info;
+    ISLocalToGlobalMapping ltog;
+    const PetscInt *iad, *jad, *iao = NULL, *jao = NULL, *garray = NULL;
+    PetscInt       n, ngarray = 0, cstart, cend, r, s, d, i, j, k, a[3],
+                   g[27], lidx[27], nb[3], gbeg[3], gend[3];
+    PetscBool      done;
+
+    ierr = DMDAGetLocalInfo(csr->da,&info); CHKERRQ(ierr);
+    ierr = DMGetLocalToGlobalMapping(csr->da,&ltog); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRangeColumn(csr->A,&cstart,&cend); CHKERRQ(ierr);
+    ierr = MatGetRowIJ(csr->Ad,0,PETSC_FALSE,PETSC_FALSE,&n,&iad,&jad,&done); CHKERRQ(ierr);
+    if (csr->Ao) {
+        ierr = MatGetRowIJ(csr->Ao,0,PETSC_FALSE,PETSC_FALSE,&n,&iao,&jao,&done); CHKERRQ(ierr);
+        ierr = MatMPIAIJGetSeqAIJ(csr->A,NULL,NULL,&garray); CHKERRQ(ierr);
+        ierr = MatGetSize(csr->Ao,NULL,&ngarray); CHKERRQ(ierr);
+    }
+    csr->dim = info.dim;
+    csr->ns = (info.dim == 1) ? 3 : ((info.dim == 2) ? 9 : 27);
+    csr->xs = info.xs;  csr->ys = info.ys;  csr->zs = info.zs;
+    csr->xm = info.xm;
+    csr->ym = (info.dim > 1) ? info.ym : 1;
+    csr->zm = (info.dim > 2) ? info.zm : 1;
+    ierr = PetscFree(csr->off); CHKERRQ(ierr);
+    ierr = PetscMalloc1(csr->xm*csr->ym*csr->zm*csr->ns,&(csr->off)); CHKERRQ(ierr);
+    gbeg[0] = info.gxs;  gend[0] = info.gxs + info.gxm;
+    gbeg[1] = info.gys;  gend[1] = info.gys + info.gym;
+    gbeg[2] = info.gzs;  gend[2] = info.gzs + info.gzm;
+    for (d = info.dim; d < 3; d++) {
+        gbeg[d] = 0;  gend[d] = 1;
+    }
+    r = 0;
+    for (k = 0; k < csr->zm; k++) {
+        for (j = 0; j < csr->ym; j++) {
+            for (i = 0; i < csr->xm; i++) {
+                // ghosted local indices of the stencil positions, x fastest
+                for (s = 0; s < csr->ns; s++) {
+                    a[0] = csr->xs + i + (s % 3) - 1;
+                    a[1] = (info.dim > 1) ? csr->ys + j + (s / 3) % 3 - 1 : 0;
+                    a[2] = (info.dim > 2) ? csr->zs + k + s / 9 - 1 : 0;
+                    lidx[s] = 0;
+                    for (d = 2; d >= 0; d--) {
+                        nb[d] = a[d] - gbeg[d];
+                        if (a[d] < gbeg[d] || a[d] >= gend[d]) {
+                            lidx[s] = -1;
+                            break;
+                        }
+                        lidx[s] = lidx[s] * (gend[d] - gbeg[d]) + nb[d];
+                    }
+                }
+                ierr = ISLocalToGlobalMappingApply(ltog,csr->ns,lidx,g); CHKERRQ(ierr);
+                for (s = 0; s < csr->ns; s++) {
+                    csr->off[r*csr->ns + s] = -1;
+                    if (lidx[s] >= 0) {
+                        ierr = StencilCSRFind(g[s],r,cstart,cend,iad,jad,iao,jao,
+                                   garray,ngarray,&(csr->off[r*csr->ns + s])); CHKERRQ(ierr);
+                    }
+                }
+                r++;
+            }
+        }
+    }
+    ierr = MatRestoreRowIJ(csr->Ad,0,PETSC_FALSE,PETSC_FALSE,&n,&iad,&jad,&done); CHKERRQ(ierr);
+    if (csr->Ao) {
+        ierr = MatRestoreRowIJ(csr->Ao,0,PETSC_FALSE,PETSC_FALSE,&n,&iao,&jao,&done); CHKERRQ(ierr);
+    }
+    ierr = MatGetNonzeroState(csr->A,&(csr->nzstate)); CHKERRQ(ierr);
+    return 0;
+}
+
+PETSC_STATIC_INLINE PetscErrorCode StencilCSRBegin(DM da, Mat A, StencilCSR **csr) {
+    PetscErrorCode   ierr;
+    PetscContainer   container;
+    PetscBool        isseq, ismpi, assembled;
+    PetscObjectState nzstate;
+    PetscInt         dof;
+
+    ierr = PetscObjectQuery((PetscObject)A,"StencilCSR",
+                            (PetscObject*)&container); CHKERRQ(ierr);
+    if (container) {
+        ierr = PetscContainerGetPointer(container,(void**)csr); CHKERRQ(ierr);
+    } else {
+        ierr = PetscNew(csr); CHKERRQ(ierr);
+        ierr = PetscContainerCreate(PetscObjectComm((PetscObject)A),&container); CHKERRQ(ierr);
+        ierr = PetscContainerSetPointer(container,*csr); CHKERRQ(ierr);
+        ierr = PetscContainerSetUserDestroy(container,StencilCSRDestroy); CHKERRQ(ierr);
+        ierr = PetscObjectCompose((PetscObject)A,"StencilCSR",
+                                  (PetscObject)container); CHKERRQ(ierr);
+        ierr = PetscContainerDestroy(&container); CHKERRQ(ierr);  // A holds reference
+    }
+    (*csr)->A = A;
+    (*csr)->ad = NULL;
+    (*csr)->ao = NULL;
+    ierr = PetscObjectTypeCompare((PetscObject)A,MATSEQAIJ,&isseq); CHKERRQ(ierr);
+    ierr = PetscObjectTypeCompare((PetscObject)A,MATMPIAIJ,&ismpi); CHKERRQ(ierr);
+    ierr = MatAssembled(A,&assembled); CHKERRQ(ierr);
+    ierr = DMDAGetInfo(da,NULL,NULL,NULL,NULL,NULL,NULL,NULL,
+                       &dof,NULL,NULL,NULL,NULL,NULL); CHKERRQ(ierr);
+    if (!(isseq || ismpi) || !assembled || dof != 1)
+        return 0;  // StencilCSRSetValues() falls back to MatSetValuesStencil()
+    if (ismpi) {
+        ierr = MatMPIAIJGetSeqAIJ(A,&((*csr)->Ad),&((*csr)->Ao),NULL); CHKERRQ(ierr);
+    } else {
+        (*csr)->Ad = A;
+        (*csr)->Ao = NULL;
+    }
+    ierr = MatGetNonzeroState(A,&nzstate); CHKERRQ(ierr);
+    if (!(*csr)->off || (*csr)->da != da || (*csr)->nzstate != nzstate) {
+        (*csr)->da = da;
+        ierr = StencilCSRBuild(*csr); CHKERRQ(ierr);
+    }
+    ierr = MatSeqAIJGetArray((*csr)->Ad,&((*csr)->ad)); CHKERRQ(ierr);
+    if ((*csr)->Ao) {
+        ierr = MatSeqAIJGetArray((*csr)->Ao,&((*csr)->ao)); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+// same arguments and effect as MatSetValuesStencil(A,1,row,ncols,col,v,mode)
+// for the Mat in StencilCSRBegin(); columns must be stencil neighbors
+PETSC_STATIC_INLINE PetscErrorCode StencilCSRSetValues(StencilCSR *csr,
+        const MatStencil *row, PetscInt ncols, const MatStencil *col,
+        const PetscScalar *v, InsertMode mode) {
+    PetscErrorCode ierr;
+    PetscInt       q, s, o, di, dj = 0, dk = 0;
+    const PetscInt *off;
+    PetscScalar    *p;
+
+    if (!csr->ad) {
+        ierr = MatSetValuesStencil(csr->A,1,row,ncols,col,v,mode); CHKERRQ(ierr);
+        return 0;
+    }
+    q = row->i - csr->xs;
+    if (csr->dim > 1)
+        q += csr->xm * (row->j - csr->ys);
+    if (csr->dim > 2)
+        q += csr->xm * csr->ym * (row->k - csr->zs);
+    off = csr->off + q * csr->ns;
+    for (q = 0; q < ncols; q++) {
+        // stencil position, x fastest, as in StencilCSRBuild()
+        di = col[q].i - row->i;
+        s = di + 1;
+        if (csr->dim > 1) {
+            dj = col[q].j - row->j;
+            s += 3 * (dj + 1);
+        }
+        if (csr->dim > 2) {
+            dk = col[q].k - row->k;
+            s += 9 * (dk + 1);
+        }
+        if (PetscAbs(di) > 1 || PetscAbs(dj) > 1 || PetscAbs(dk) > 1) {
+            SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_OUTOFRANGE,
+                    "StencilCSRSetValues() column is not a stencil neighbor\n");
+        }
+        o = off[s];
+        if (o == -1) {
+            SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_OUTOFRANGE,
+                    "StencilCSRSetValues() entry is not in nonzero pattern\n");
+        }
+        p = (o >= 0) ? csr->ad + o : csr->ao + (-2 - o);
+        if (mode == INSERT_VALUES)
+            *p = v[q];
+        else
+            *p += v[q];
+    }
+    return 0;
+}
+
+PETSC_STATIC_INLINE PetscErrorCode StencilCSREnd(StencilCSR *csr) {
+    PetscErrorCode ierr;
+    if (csr->ad) {
+        ierr = MatSeqAIJRestoreArray(csr->Ad,&(csr->ad)); CHKERRQ(ierr);
+        csr->ad = NULL;
+    }
+    if (csr->ao) {
+        ierr = MatSeqAIJRestoreArray(csr->Ao,&(csr->ao)); CHKERRQ(ierr);
+        csr->ao = NULL;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# A script to run regression tests which compare the output of two commands,
+# instead of comparing one command against a stored output/PROGRAM.testN file
+# as testit.sh does.  Use it when the result must not depend on a choice
+# (process count, an optimization option, a restart) which the test varies.
+# Called from the c/chN/ makefiles as follows:
+#    ../testcompare.sh PROGRAM CMD1 CMD2 TESTNUM
+# Each CMD is run with bash, so it may use pipes (e.g. "| grep error") and
+# "mpiexec -n P" itself.  The test passes if the two outputs are identical.
+
+rm -f maketmp tmp tmp2 difftmp
+
+make $1 > maketmp 2>&1;
+
+grep warning maketmp
+
+CURRDIR=${PWD##*/}
+
+bash -c "$2" &> tmp
+bash -c "$3" &> tmp2
+
+diff tmp tmp2 > difftmp
+
+if [[ ! -s tmp ]] ; then
+    echo "FAIL: Test #$4 of $CURRDIR/$1"
+    echo "       command 1 = '$2'"
+    echo "       OUTPUT EMPTY"
+elif [[ -s difftmp ]] ; then
+    echo "FAIL: Test #$4 of $CURRDIR/$1"
+    echo "       command 1 = '$2'"
+    echo "       command 2 = '$3'"
+    echo "       diffs follow:"
+    cat difftmp
+else
+    echo "PASS: Test #$4 of $CURRDIR/$1"
+    rm -f maketmp tmp tmp2 difftmp
+fi